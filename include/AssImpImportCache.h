@@ -0,0 +1,102 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of OGRE
+(Object-oriented Graphics Rendering Engine)
+For the latest info, see http://www.ogre3d.org
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef __AssImpImportCache_H__
+#define __AssImpImportCache_H__
+
+#include "OgrePrerequisites.h"
+#include "hlms_editor_plugin.h"
+
+namespace Ogre
+{
+	/** On-disk cache of imported meshes, shared by all HLMS Editor instances that use the same import path.
+	 *  The key of a cached mesh is a hash of:
+	 *  - the bytes of the imported file
+	 *  - the bytes of the files it references (e.g. the .mtl file of an .obj)
+	 *  - the plugin properties
+	 *  - the plugin version
+	 *  So a cached mesh is never stale; an entry is only removed when the cache exceeds its maximum size
+	 *  (least recently used first). Entries are written to a temporary file first and renamed afterwards,
+	 *  so other instances never see a partially written mesh. The dequantization parameters and the preview of a
+	 *  quantized mesh are cached with it (<key>.quantization.json, <key>.preview); they are stored before the mesh,
+	 *  so the rename of the mesh completes the entry.
+	 */
+	class AssImpImportCache
+	{
+	public:
+		AssImpImportCache(void);
+		virtual ~AssImpImportCache(void);
+
+		// Set the directory of the cache and its maximum size in bytes
+		void setCacheDir(const String& cacheDir, uint64 maxCacheSize);
+
+		/* Calculate the cache key of the file to import. Returns false if the file cannot be read.
+		 */
+		bool calculateKey(const String& fileName, HlmsEditorPluginData* data);
+
+		/* If the mesh is cached, copy it to meshFileName and return true. The dequantization parameters
+		 * and the preview are copied to quantizationFileName and previewFileName if the mesh has them;
+		 * otherwise those files are removed.
+		 */
+		bool fetch(const String& meshFileName, const String& quantizationFileName, const String& previewFileName);
+
+		/* Add the mesh to the cache and evict the least recently used entries if the cache is too large.
+		 * Errors are only logged; a failing cache must never fail the import.
+		 */
+		void store(const String& meshFileName, const String& quantizationFileName, const String& previewFileName);
+
+		const String& getKey(void) const {return mKey;}
+
+		// Names of the regular files in the directory (which ends with a separator); also used by the batch import
+		static StringVector listFiles(const String& dir);
+
+	protected:
+		// Hash the content of the file; returns false if the file cannot be read
+		bool hashFile(const String& fileName, uint64& hash);
+
+		// Files that are loaded by assimp together with the imported file
+		StringVector getReferencedFiles(const String& fileName);
+
+		// Copy the file of the entry with the extension to fileName, or remove fileName if the entry has none
+		bool fetchFile(const String& extension, const String& fileName);
+
+		// Store the file with the extension for the entry, if the file exists
+		bool storeFile(const String& extension, const String& fileName);
+
+		// Remove the least recently used entries until the cache is smaller than mMaxCacheSize
+		void evict(void);
+
+		static uint64 murmurHash64(const void* key, size_t length, uint64 seed);
+		static bool copyFile(const String& sourceFileName, const String& destinationFileName);
+
+		String mCacheDir;
+		uint64 mMaxCacheSize;
+		String mKey;
+	};
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of OGRE
+(Object-oriented Graphics Rendering Engine)
+For the latest info, see http://www.ogre3d.org
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef __AssImpImportProfiler_H__
+#define __AssImpImportProfiler_H__
+
+#include "OgrePrerequisites.h"
+#include "OgreTimer.h"
+#include <mutex>
+
+namespace Ogre
+{
+	/** Wall time, CPU time and bytes produced per stage of an import (ReadFile, parseScene, the write functions of
+	 *  the XmlSerializer, saving the mesh, OgreMeshTool, ...). Stages are timed with a Scope; a stage that is timed
+	 *  more than once (e.g. a write function that runs for every submesh or chunk) is accumulated.
+	 *  The CPU time is the CPU time of the thread that times the stage, so stages that run in parallel on other
+	 *  threads are not counted twice. Work that a stage hands to other threads is not included in that stage; the
+	 *  workers time it in stages of their own (e.g. optimizeMesh, simplifyMesh and writeFaces, per mesh or chunk).
+	 *  The results are written to the Ogre log and optionally to a json report, so they can be compared across
+	 *  versions of the plugin.
+	 */
+	class AssImpImportProfiler
+	{
+	public:
+		struct Stage
+		{
+			String name;
+			uint64 wallMicroseconds;
+			uint64 cpuMicroseconds;
+			uint64 bytes;
+			size_t calls;
+		};
+
+		/** Times a stage from construction until destruction. A null profiler makes the scope a no-op.
+		 */
+		class Scope
+		{
+		public:
+			Scope(AssImpImportProfiler* profiler, const String& stageName);
+			~Scope(void);
+
+			// Bytes produced by the stage
+			void addBytes(uint64 bytes) {mBytes += bytes;}
+
+		protected:
+			AssImpImportProfiler* mProfiler;
+			String mStageName;
+			uint64 mBytes;
+			Timer mTimer;
+			uint64 mStartCpuMicroseconds;
+		};
+
+		AssImpImportProfiler(void);
+		virtual ~AssImpImportProfiler(void);
+
+		// Start profiling the import of a file
+		void reset(const String& fileName);
+
+		// Add the timing of a stage; this may be called by any thread
+		void addStage(const String& stageName, uint64 wallMicroseconds, uint64 cpuMicroseconds, uint64 bytes);
+
+		// The stages in the order in which they were first finished
+		const std::vector<Stage>& getStages(void) const {return mStages;}
+
+		void logStages(void) const;
+
+		/* Write the stages as json. Returns false if the report cannot be written; this is not an import error.
+		 */
+		bool writeReport(const String& reportFileName, bool importResult) const;
+
+		// Size of a file in bytes; 0 if it does not exist
+		static uint64 getFileSize(const String& fileName);
+
+		// CPU time of the calling thread
+		static uint64 getThreadCpuMicroseconds(void);
+
+	protected:
+		static String escapeJson(const String& value);
+
+		String mFileName;
+		std::vector<Stage> mStages;
+		mutable std::mutex mStagesMutex;
+	};
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of OGRE
+(Object-oriented Graphics Rendering Engine)
+For the latest info, see http://www.ogre3d.org
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef __AssImpImportProgress_H__
+#define __AssImpImportProgress_H__
+
+#include "OgrePrerequisites.h"
+#include "hlms_editor_plugin.h"
+#include <assimp/ProgressHandler.hpp>
+#include <atomic>
+
+namespace Ogre
+{
+	/** Progress and cancellation of an import. The import thread sets the stage and progress; any other thread
+	 *  (e.g. the HLMS Editor UI) may read them and cancel the import. The import checks for cancellation between
+	 *  the stages and regularly inside the long loops over faces and vertices.
+	 */
+	class AssImpImportProgress
+	{
+	public:
+		enum Stage
+		{
+			STAGE_IDLE,
+			STAGE_PARSE,			// Assimp reads and post-processes the file
+			STAGE_OPTIMIZE,			// The triangles and vertices are reordered for the GPU
+			STAGE_SIMPLIFY,			// The levels of detail are generated
+			STAGE_CONVERT,			// The assimp scene is converted to xml or to vertex/index buffers
+			STAGE_CREATE_MESH,		// OgreMeshTool runs or the mesh is created and saved
+			STAGE_DONE
+		};
+
+		AssImpImportProgress(void);
+		virtual ~AssImpImportProgress(void);
+
+		// Start a new import
+		void reset(void);
+
+		void setStage(Stage stage);
+		Stage getStage(void) const {return static_cast<Stage>(mStage.load());}
+		const String& getStageName(void) const;
+
+		// Progress of the current stage, between 0 and 1
+		void setProgress(float progress) {mProgress.store(progress);}
+		float getProgress(void) const {return mProgress.load();}
+
+		void cancel(void) {mCancelled.store(true);}
+		bool isCancelled(void) const {return mCancelled.load() || (mParent && mParent->isCancelled());}
+
+		/* The progress of one file in a batch import; cancelling the parent (the whole batch) also cancels this import.
+		 * The parent is not owned.
+		 */
+		void setParent(const AssImpImportProgress* parent) {mParent = parent;}
+
+		// If the import is cancelled, set the error text and return true
+		bool checkCancelled(HlmsEditorPluginData* data) const;
+
+	protected:
+		const AssImpImportProgress* mParent;
+		std::atomic<int> mStage;
+		std::atomic<float> mProgress;
+		std::atomic<bool> mCancelled;
+	};
+
+	/** Forwards assimp's progress to an AssImpImportProgress and aborts the assimp import when it is cancelled.
+	 *  The Assimp::Importer takes ownership of the handler.
+	 */
+	class AssImpProgressHandler : public Assimp::ProgressHandler
+	{
+	public:
+		AssImpProgressHandler(AssImpImportProgress* progress);
+		virtual ~AssImpProgressHandler(void);
+
+		// Implement Assimp::ProgressHandler functions
+		virtual bool Update(float percentage = -1.0f);
+
+	protected:
+		AssImpImportProgress* mProgress;
+	};
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of OGRE
+(Object-oriented Graphics Rendering Engine)
+For the latest info, see http://www.ogre3d.org
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef __AssImpMappedIOSystem_H__
+#define __AssImpMappedIOSystem_H__
+
+#include "OgrePrerequisites.h"
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include <assimp/DefaultIOSystem.h>
+#include <mutex>
+
+namespace Ogre
+{
+	class AssImpMappedIOSystem;
+
+	/** Read-only assimp stream on a memory mapped file. Reads are served from the mapping, so assimp's many
+	 *  small reads don't result in a system call each.
+	 */
+	class AssImpMappedIOStream : public Assimp::IOStream
+	{
+	public:
+		AssImpMappedIOStream(AssImpMappedIOSystem* ioSystem, const String& fileName);
+		virtual ~AssImpMappedIOStream(void);
+
+		// Returns false if the file could not be opened or mapped
+		bool map(void);
+
+		// Implement Assimp::IOStream functions
+		virtual size_t Read(void* buffer, size_t size, size_t count);
+		virtual size_t Write(const void* buffer, size_t size, size_t count);
+		virtual aiReturn Seek(size_t offset, aiOrigin origin);
+		virtual size_t Tell(void) const;
+		virtual size_t FileSize(void) const;
+		virtual void Flush(void);
+
+	protected:
+		void unmap(void);
+
+		AssImpMappedIOSystem* mIOSystem;
+		String mFileName;
+		const char* mData;
+		size_t mSize;
+		size_t mPosition;
+		size_t mBytesRead;
+		bool mMapped;		// Only mapped streams are counted by logBytesRead; probes and failed maps are not
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+		void* mFileHandle;
+		void* mMappingHandle;
+#endif
+	};
+
+	/** Assimp IOSystem that memory maps the imported file and all files it references (.mtl, .bin, textures, ...).
+	 *  Files opened for writing are delegated to assimp's default IOSystem.
+	 *  The number of bytes read from each file is recorded and can be logged after the import.
+	 */
+	class AssImpMappedIOSystem : public Assimp::IOSystem
+	{
+	public:
+		AssImpMappedIOSystem(void);
+		virtual ~AssImpMappedIOSystem(void);
+
+		// Implement Assimp::IOSystem functions
+		virtual bool Exists(const char* fileName) const;
+		virtual char getOsSeparator(void) const;
+		virtual Assimp::IOStream* Open(const char* fileName, const char* mode = "rb");
+		virtual void Close(Assimp::IOStream* stream);
+
+		// Called by a stream when it is closed
+		void addBytesRead(const String& fileName, uint64 bytesRead);
+
+		// Number of bytes read per file since the last reset
+		std::map<String, uint64> getBytesRead(void) const;
+		void resetBytesRead(void);
+
+		// Number of bytes read from all files since the last reset
+		uint64 getTotalBytesRead(void) const;
+
+		// Write the read statistics to the Ogre log
+		void logBytesRead(void) const;
+
+	protected:
+		Assimp::DefaultIOSystem mDefaultIOSystem;
+		mutable std::mutex mBytesReadMutex;
+		std::map<String, uint64> mBytesRead;
+	};
+}
+
+#endif
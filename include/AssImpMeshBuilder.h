@@ -0,0 +1,207 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of OGRE
+(Object-oriented Graphics Rendering Engine)
+For the latest info, see http://www.ogre3d.org
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef __AssImpMeshBuilder_H__
+#define __AssImpMeshBuilder_H__
+
+#include "OgrePrerequisites.h"
+#include "OgreVector3.h"
+#include "OgreQuaternion.h"
+#include "OgreMesh2.h"
+#include "Vao/OgreVertexBufferPacked.h"
+#include "Vao/OgreIndexBufferPacked.h"
+#include "hlms_editor_plugin.h"
+#include "AssImpImportProgress.h"
+#include <assimp/scene.h>
+
+namespace Ogre
+{
+	/** Converts an assimp scene directly into an Ogre v2 mesh, without the intermediate xml file
+	 *  and OgreMeshTool. Building is done in two phases:
+	 *  1. prepareSubMeshes() packs the vertex- and index data of each aiMesh into plain memory.
+	 *     It does not touch the rendersystem.
+	 *  2. createMesh() creates the v2 Mesh, its SubMeshes and their vertex/index buffers from the
+	 *     packed data. This must be called from the thread that owns the rendersystem.
+	 *  With quantization, the vertices are also packed without it, for a preview mesh that the editor
+	 *  can show; the HLMS of the editor does not dequantize.
+	 */
+	class AssImpMeshBuilder
+	{
+	public:
+		/** Vertex formats and dequantization parameters of one submesh. Quantized positions are stored as
+		 *  unorm16, normalised to the bounds of the submesh; the vertex shader restores them with
+		 *  offset + position * scale. The other attributes are decoded by the vertex fetch (normalised formats,
+		 *  halfs), except octahedral normals, which need the usual octahedral decode.
+		 */
+		struct Quantization
+		{
+			VertexElementType positionType;
+			Vector3 positionOffset;
+			Vector3 positionScale;
+			bool octahedralNormals;		// Normals without tangents, encoded as short2
+			bool writeColours;
+			VertexElementType colourType;
+			std::vector<VertexElementType> texCoordTypes;
+
+			// Maximum error of each attribute; the position error is relative to the largest extent of the submesh
+			float positionError;
+			float normalError;
+			float texCoordError;
+			float colourError;
+		};
+
+		// Packed data of one submesh; the buffers are allocated with OGRE_MALLOC_SIMD
+		struct SubMeshData
+		{
+			VertexElement2Vec vertexElements;
+			char* vertexData;
+			VertexElement2Vec previewVertexElements;	// Without quantization; only packed when quantizing
+			char* previewVertexData;
+			size_t numVertices;
+			IndexBufferPacked::IndexType indexType;
+			char* indexData;
+			size_t numIndices;
+			String materialName;
+			bool writeNormals;
+			bool writeTangents;
+			bool writeQTangents;
+			Quantization quantization;
+		};
+
+		// Vertex format options; these correspond with the OgreMeshTool options
+		struct Options
+		{
+			bool qTangents;			// -O q; normals and tangents are encoded as QTangent
+			bool halfPositions;		// -O p; half precision positions
+			bool halfTexCoords;		// -O u; half precision texture coordinates
+			bool shadowMapBuffers;	// -O s; optimized vertex buffers for shadow mapping
+			bool quantize;			// Compact vertex formats; see Quantization
+			float quantizationTolerance;	// Maximum error of a quantized attribute
+		};
+
+		AssImpMeshBuilder(void);
+		virtual ~AssImpMeshBuilder(void);
+
+		/* Pack the meshes of the assimp scene into vertex- and index buffers (one per submesh)
+		 */
+		bool prepareSubMeshes(const aiScene* scene, HlmsEditorPluginData* data);
+
+		/* Report the progress of prepareSubMeshes; it stops when the import is cancelled.
+		 * The progress object is optional and not owned by the builder.
+		 */
+		void setImportProgress(AssImpImportProgress* importProgress) {mImportProgress = importProgress;}
+
+		/* Create a v2 mesh from the data packed by prepareSubMeshes. The vertex- and index data is
+		 * handed over to the buffers of the mesh, so createMesh can only be called once per prepareSubMeshes.
+		 * If a mesh with the same name already exists, it is left alone and the new mesh gets a unique name.
+		 * The preview mesh (see isQuantized) is created from copies; create it before the mesh itself.
+		 */
+		MeshPtr createMesh(const String& meshName, const String& groupName, HlmsEditorPluginData* data,
+			bool preview = false);
+
+		/* Save the mesh in the v2 binary mesh format. This replaces the OgreMeshTool step of the
+		 * xml path; the mesh must have been created by createMesh.
+		 */
+		bool saveMesh(const MeshPtr& mesh, const String& meshFileName, HlmsEditorPluginData* data);
+
+		/* Save the preview mesh next to the mesh; saveMesh removes an old one if the mesh is not quantized.
+		 */
+		bool savePreviewMesh(const MeshPtr& previewMesh, const String& meshFileName, HlmsEditorPluginData* data);
+
+		// True if a submesh has positions or normals that the shader must dequantize; the editor then needs the preview
+		bool isQuantized(void) const;
+
+		/* The file with the dequantization parameters of the mesh; saveMesh writes it next to the mesh if
+		 * at least one submesh is quantized and removes an old one otherwise.
+		 */
+		static String getQuantizationFileName(const String& meshFileName);
+
+		// The file with the preview mesh of a quantized mesh (<name>.preview.mesh)
+		static String getPreviewFileName(const String& meshFileName);
+
+		// Release all packed data that is not (yet) handed over to a mesh
+		void clear(void);
+
+	protected:
+		// Set the options from the properties in the HLMS Editor settings dialog
+		void readOptions(HlmsEditorPluginData* data);
+
+
+		bool prepareSubMesh(const aiMesh* subMesh,
+			SubMeshData& subMeshData,
+			HlmsEditorPluginData* data);
+
+		/* Choose the compact format of each attribute and measure its error. An attribute whose error
+		 * exceeds the tolerance is written with 32 bit floats.
+		 */
+		void quantizeSubMesh(const aiMesh* subMesh, SubMeshData& subMeshData);
+
+		// Write the dequantization parameters of all submeshes as json, with the object space bounds of the mesh
+		bool writeQuantization(const String& quantizationFileName, const Aabb& bounds) const;
+
+		// The vertex layout of the submesh with the formats of the quantization
+		static void buildVertexElements(const SubMeshData& subMeshData,
+			const Quantization& quantization,
+			VertexElement2Vec& vertexElements);
+
+		// Fill a vertex buffer; the layout must match the vertex elements. Returns false if cancelled.
+		bool packVertices(const aiMesh* subMesh,
+			const SubMeshData& subMeshData,
+			const Quantization& quantization,
+			const VertexElement2Vec& vertexElements,
+			char*& vertexData,
+			HlmsEditorPluginData* data);
+
+		// Write the mesh file without the dequantization parameters
+		static bool exportMesh(const MeshPtr& mesh, const String& meshFileName, HlmsEditorPluginData* data);
+
+		// Fill the index buffer with 16 or 32 bit indices
+		void packIndices(const aiMesh* subMesh,
+			SubMeshData& subMeshData);
+
+		// Encode the tangent space as a quaternion; the sign contains the handedness
+		static Quaternion toQTangent(const Vector3& normal, const Vector3& tangent, float handedness);
+		static int16 floatToSnorm16(float value);
+		static uint16 floatToUnorm16(float value);
+		static uint8 floatToUnorm8(float value);
+
+		// Octahedral encoding of a unit vector; both components are in [-1, 1]
+		static void toOctahedral(const Vector3& normal, float& u, float& v);
+		static Vector3 fromOctahedral(float u, float v);
+
+		AssImpImportProgress* mImportProgress;
+		size_t mNumVerticesPacked;
+		size_t mNumVerticesTotal;
+		Options mOptions;
+		std::vector<SubMeshData> mSubMeshes;
+		std::vector<Quantization> mQuantization;	// Not released by clear, because saveMesh needs it
+		Vector3 mMinimum;
+		Vector3 mMaximum;
+	};
+}
+
+#endif
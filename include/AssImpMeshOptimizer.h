@@ -0,0 +1,141 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of OGRE
+(Object-oriented Graphics Rendering Engine)
+For the latest info, see http://www.ogre3d.org
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef __AssImpMeshOptimizer_H__
+#define __AssImpMeshOptimizer_H__
+
+#include "OgrePrerequisites.h"
+#include "hlms_editor_plugin.h"
+#include "AssImpImportProgress.h"
+#include "AssImpImportProfiler.h"
+#include <assimp/scene.h>
+#include <atomic>
+
+namespace Ogre
+{
+	/** Reorders the triangles and vertices of the meshes of an assimp scene for the GPU, before they are converted
+	 *  to xml or to vertex/index buffers:
+	 *  1. The triangles are reordered for the post-transform vertex cache (Tom Forsyth's linear-speed vertex cache
+	 *     optimisation), so a vertex that is shaded once is reused by as many triangles as possible.
+	 *  2. Optionally, the triangles are grouped into clusters that are sorted by their occlusion potential, so the
+	 *     outer, outward facing parts of the mesh are drawn first and early-Z rejects more of the fragments behind
+	 *     them (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+	 *  3. The vertices are renumbered in the order in which the triangles first use them, so the vertex fetches
+	 *     follow the index buffer instead of jumping through the vertex buffer.
+	 *  The meshes are optimised in parallel; only the order changes, the meshes keep all their triangles and vertices.
+	 */
+	class AssImpMeshOptimizer
+	{
+	public:
+		// Efficiency of the vertex cache for one mesh
+		struct Statistics
+		{
+			float acmrBefore;	// Average cache miss ratio: transformed vertices per triangle (0.5 is the optimum)
+			float acmrAfter;
+			float atvrBefore;	// Average transform to vertex ratio: transformed vertices per vertex (1 is the optimum)
+			float atvrAfter;
+			unsigned int numClusters;	// Number of clusters of the overdraw optimisation; 0 if it is not used
+			bool optimized;		// False if the mesh was skipped, because it does not consist of triangles
+		};
+
+		AssImpMeshOptimizer(void);
+		virtual ~AssImpMeshOptimizer(void);
+
+		/* Optimise all triangle meshes of the scene and log the ACMR and ATVR of each mesh before and after.
+		 * The scene is changed in place. Returns false if the import is cancelled.
+		 */
+		bool optimizeScene(aiScene* scene, HlmsEditorPluginData* data);
+
+		/* Report the progress of optimizeScene; it stops when the import is cancelled.
+		 * The progress object is optional and not owned by the optimizer.
+		 */
+		void setImportProgress(AssImpImportProgress* importProgress) {mImportProgress = importProgress;}
+
+		/* Time the optimisation of each mesh in the thread that optimises it.
+		 * The profiler is optional and not owned by the optimizer.
+		 */
+		void setImportProfiler(AssImpImportProfiler* importProfiler) {mImportProfiler = importProfiler;}
+
+		/* Limit the number of threads; 0 means one per core. A batch import already imports files in parallel,
+		 * so it gives each file a share of the cores.
+		 */
+		void setMaxThreads(unsigned int maxThreads) {mMaxThreads = maxThreads;}
+
+		/* Enable the overdraw optimisation. The threshold is the cache efficiency that may be traded for less
+		 * overdraw: each cluster may have an ACMR of at most threshold times the ACMR of the whole mesh, so 1 keeps
+		 * the cache efficiency and larger values give more, smaller clusters. Off by default.
+		 */
+		void setOverdrawOptimization(bool enabled, float threshold = 1.05f);
+
+		// The statistics of the meshes of the last optimizeScene, in the order of the meshes
+		const std::vector<Statistics>& getStatistics(void) const {return mStatistics;}
+
+		/* Reorder the triangles of a triangle mesh for the vertex cache (and overdraw, if enabled), then renumber its
+		 * vertices in the order of first use. Vertices that are not used by any triangle are moved to the end.
+		 */
+		void optimizeMesh(aiMesh* mesh, Statistics& statistics) const;
+
+		// Average cache miss ratio of the triangles of the mesh, simulated with a FIFO cache of cacheSize vertices
+		static float calculateACMR(const aiMesh* mesh, unsigned int cacheSize);
+
+		// Average transform to vertex ratio of the mesh, simulated with a FIFO cache of cacheSize vertices
+		static float calculateATVR(const aiMesh* mesh, unsigned int cacheSize);
+
+		/* Forsyth's triangle order; indices contains three vertex indices per triangle and is reordered in place.
+		 * Also used for the index lists of the levels of detail.
+		 */
+		static void optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int numVertices);
+
+	protected:
+		// Optimise the meshes that are not yet taken by another worker
+		void runWorker(aiScene* scene);
+
+		/* Split the cache order of the triangles into clusters and sort the clusters by occlusion potential; the
+		 * order within a cluster is kept. Returns the number of clusters.
+		 */
+		static unsigned int optimizeOverdraw(std::vector<unsigned int>& indices, const aiMesh* mesh, float threshold);
+
+		/* Renumber the vertices of the mesh in the order of first use. All per-vertex data is moved: the
+		 * positions, normals, tangents, colours, texture coordinates, bone weights and animation meshes.
+		 */
+		static void reorderVertices(aiMesh* mesh);
+
+		// Number of transformed vertices when the triangles are drawn with a FIFO cache of cacheSize vertices
+		static unsigned int countCacheMisses(const aiMesh* mesh, unsigned int cacheSize);
+
+		AssImpImportProgress* mImportProgress;
+		AssImpImportProfiler* mImportProfiler;
+		unsigned int mMaxThreads;
+		bool mOptimizeOverdraw;
+		float mOverdrawThreshold;
+		std::vector<Statistics> mStatistics;
+		std::atomic<unsigned int> mNextMesh;
+		std::atomic<unsigned int> mOptimizedMeshes;
+	};
+}
+
+#endif
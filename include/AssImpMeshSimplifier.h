@@ -0,0 +1,132 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of OGRE
+(Object-oriented Graphics Rendering Engine)
+For the latest info, see http://www.ogre3d.org
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef __AssImpMeshSimplifier_H__
+#define __AssImpMeshSimplifier_H__
+
+#include "OgrePrerequisites.h"
+#include "OgreVector3.h"
+#include "hlms_editor_plugin.h"
+#include "AssImpImportProgress.h"
+#include "AssImpImportProfiler.h"
+#include <assimp/scene.h>
+#include <atomic>
+
+namespace Ogre
+{
+	/** Generates levels of detail for the meshes of an assimp scene with quadric error edge collapses
+	 *  (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics").
+	 *  - Only half-edge collapses are used: a vertex is merged into one of its neighbours, so every level is an
+	 *    index list into the vertices of the full-detail mesh and the levels share its vertex buffer.
+	 *  - Vertices with the same position but different attributes (UV seams, hard edges) are collapsed together
+	 *    and only along the seam; border vertices only move along the border. Seams and borders also get extra
+	 *    quadrics, so they keep their shape. Vertices where seams or borders meet are never moved.
+	 *  - The cost of a collapse includes the difference of the normals and texture coordinates, so attribute
+	 *    discontinuities are collapsed last.
+	 *  The meshes are simplified in parallel. The error of a level is the largest geometric error of its collapses,
+	 *  relative to the bounding radius of the whole scene, so it can be converted to a screen-space error.
+	 */
+	class AssImpMeshSimplifier
+	{
+	public:
+		enum TargetType
+		{
+			TARGET_TRIANGLE_RATIO,	// Fraction of the triangles of the full-detail mesh, e.g. 0.5 0.25 0.125
+			TARGET_ERROR			// Maximum error relative to the bounding radius, e.g. 0.002 0.01 0.05
+		};
+
+		// One level of detail of a mesh
+		struct LodLevel
+		{
+			std::vector<unsigned int> indices;	// Three vertex indices per triangle, in vertex cache order
+			float error;						// Largest geometric error relative to the bounding radius
+		};
+
+		AssImpMeshSimplifier(void);
+		virtual ~AssImpMeshSimplifier(void);
+
+		/* Set the targets of the levels; triangle ratios must be decreasing and errors increasing.
+		 * Returns false if the targets are not valid.
+		 */
+		bool setTargets(TargetType type, const std::vector<float>& targets);
+
+		/* Report the progress of simplifyScene; it stops when the import is cancelled.
+		 * The progress object is optional and not owned by the simplifier.
+		 */
+		void setImportProgress(AssImpImportProgress* importProgress) {mImportProgress = importProgress;}
+
+		/* Time the simplification of each mesh in the thread that simplifies it.
+		 * The profiler is optional and not owned by the simplifier.
+		 */
+		void setImportProfiler(AssImpImportProfiler* importProfiler) {mImportProfiler = importProfiler;}
+
+		/* Limit the number of threads; 0 means one per core. A batch import already imports files in parallel,
+		 * so it gives each file a share of the cores.
+		 */
+		void setMaxThreads(unsigned int maxThreads) {mMaxThreads = maxThreads;}
+
+		/* Generate the levels of all meshes of the scene. The scene itself is not changed.
+		 * If the scene contains a mesh that does not consist of triangles, no levels are generated at all,
+		 * because all submeshes of a mesh must have the same levels. A level keeps at least one triangle of each
+		 * mesh; the levels end at the first one that removes no triangles. Returns false if the import is cancelled.
+		 */
+		bool simplifyScene(const aiScene* scene, HlmsEditorPluginData* data);
+
+		// Number of generated levels, excluding the full-detail level
+		size_t getNumLodLevels(void) const {return mLodErrors.size();}
+
+		// The generated levels of a mesh of the scene
+		const std::vector<LodLevel>& getLodLevels(unsigned int meshIndex) const {return mLodLevels[meshIndex];}
+
+		/* The projected area (in pixels) of the bounding sphere below which a level is used, such that its
+		 * error is at most pixelError pixels on the screen. These are the values of Ogre's pixel_count strategy.
+		 */
+		std::vector<float> calculateLodPixelCounts(float pixelError) const;
+
+		// Release the generated levels
+		void clear(void);
+
+		// Generate the levels of one triangle mesh; positions are divided by the scale
+		void simplifyMesh(const aiMesh* mesh, float scale, std::vector<LodLevel>& lodLevels) const;
+
+	protected:
+		// Simplify the meshes that are not yet taken by another worker
+		void runWorker(const aiScene* scene, float scale);
+
+		AssImpImportProgress* mImportProgress;
+		AssImpImportProfiler* mImportProfiler;
+		unsigned int mMaxThreads;
+		TargetType mTargetType;
+		std::vector<float> mTargets;
+		std::vector<std::vector<LodLevel> > mLodLevels;
+		std::vector<float> mLodErrors;		// Largest error of each level over all meshes
+		std::atomic<unsigned int> mNextMesh;
+		std::atomic<unsigned int> mSimplifiedMeshes;
+	};
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of OGRE
+(Object-oriented Graphics Rendering Engine)
+For the latest info, see http://www.ogre3d.org
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef __AssImpMeshSplitter_H__
+#define __AssImpMeshSplitter_H__
+
+#include "OgrePrerequisites.h"
+#include <assimp/scene.h>
+
+namespace Ogre
+{
+	/** Splits the meshes of an assimp scene that have more vertices than 16 bit indices can address into several
+	 *  meshes, so every submesh can use 16 bit indices. The triangles are split along spatially coherent
+	 *  boundaries: they are sorted by the Morton code of their centroid and each part takes the next triangles in
+	 *  that order until it is full. Vertices on the boundary of two parts are duplicated.
+	 *  The parts replace the original mesh in the scene and in the nodes that refer to it.
+	 */
+	class AssImpMeshSplitter
+	{
+	public:
+		AssImpMeshSplitter(unsigned int maxVertices = 0xFFFF);
+		virtual ~AssImpMeshSplitter(void);
+
+		/* Split the triangle meshes of the scene that have more than maxVertices vertices. The scene is changed in
+		 * place. Meshes with animation meshes are not split, because the plugin does not convert them.
+		 * Returns the number of meshes that are split.
+		 */
+		unsigned int splitScene(aiScene* scene);
+
+	protected:
+		// Split the mesh into parts of at most mMaxVertices vertices
+		void splitMesh(const aiMesh* mesh, std::vector<aiMesh*>& parts) const;
+
+		/* Create a part with the given faces and vertices of the mesh; partVertex contains the index in the part of
+		 * each vertex of the mesh that is in the part.
+		 */
+		aiMesh* createPart(const aiMesh* mesh,
+			const std::vector<unsigned int>& faces,
+			const std::vector<unsigned int>& vertices,
+			const std::vector<unsigned int>& partVertex) const;
+
+		// Replace the mesh indices of the node and its children; each mesh maps to a range of new meshes
+		static void remapNodeMeshes(aiNode* node,
+			const std::vector<unsigned int>& firstNewMesh,
+			const std::vector<unsigned int>& numNewMeshes);
+
+		// Interleave the bits of three 10 bit coordinates
+		static uint32 mortonCode(uint32 x, uint32 y, uint32 z);
+
+		unsigned int mMaxVertices;
+	};
+}
+
+#endif
@@ -31,7 +31,21 @@ THE SOFTWARE.
 #include "AssImpPluginPrerequisites.h"
 #include "OgrePlugin.h"
 #include "hlms_editor_plugin.h"
+#include "AssImpMeshBuilder.h"
+#include "AssImpImportCache.h"
+#include "AssImpMeshSimplifier.h"
+#include "AssImpImportProgress.h"
+#include "AssImpImportProfiler.h"
 #include <assimp/scene.h>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace Assimp
+{
+	class Importer;
+}
 
 namespace Ogre
 {
@@ -40,6 +54,7 @@ namespace Ogre
     {
 		public:
 			AssImpPlugin();
+			virtual ~AssImpPlugin();
 		
 			/// @copydoc Plugin::getName
 			const String& getName() const;
@@ -69,13 +84,109 @@ namespace Ogre
 			virtual void performPostExportActions(void);
 			virtual unsigned int getActionFlag(void);
 			virtual std::map<std::string, HlmsEditorPluginData::PLUGIN_PROPERTY> getProperties(void);
+
+			/* Asynchronous import. startImport runs the import on a worker thread and returns immediately.
+			 * The caller must not use the data until finishImport returns. finishImport waits for the worker
+			 * and creates the mesh, so it must be called from the thread that owns the rendersystem.
+			 * executeImport is startImport followed by finishImport; in between it pumps the window messages of
+			 * the calling thread, so the editor stays responsive and can cancel the import (see AssImpPluginDll.cpp).
+			 */
+			bool startImport(HlmsEditorPluginData* data);
+			bool finishImport(HlmsEditorPluginData* data);
+
+			// True while the worker thread runs; finishImport does not block anymore when this returns false
+			bool isImportRunning(void) const;
+
+			// The import stops at the next check; finishImport returns false
+			void cancelImport(void);
+
+			const AssImpImportProgress& getImportProgress(void) const {return mImportProgress;}
 	
 		protected:
-			bool AssImpPlugin::parseScene(const aiScene* scene, HlmsEditorPluginData* data);
+			/* State of the import of one file. The single import uses mImportContext; each file of a batch import
+			 * has its own context, but the files that are imported by the same worker share its importer.
+			 */
+			struct ImportContext
+			{
+				ImportContext(void) : importer(0), progress(0), maxThreads(0), meshPrepared(false), cacheHit(false) {}
+				Assimp::Importer* importer;
+				AssImpImportProgress* progress;
+				unsigned int maxThreads;	// Threads of the optimizer, simplifier and xml writer; 0 means one per core
+				AssImpMeshBuilder meshBuilder;
+				AssImpMeshSimplifier meshSimplifier;	// Levels of detail of the mesh that is being imported
+				AssImpImportCache importCache;
+				AssImpImportProfiler profiler;
+				bool meshPrepared;	// The mesh must still be created by completeImport
+				bool cacheHit;
+			};
+
+			// One file of a batch import
+			struct BatchJob
+			{
+				BatchJob(void) : prepared(false), result(false), prepareMicroseconds(0), completeMicroseconds(0) {}
+				HlmsEditorPluginData data;
+				ImportContext context;
+				AssImpImportProgress progress;
+				bool prepared;
+				bool result;
+				unsigned long prepareMicroseconds;
+				unsigned long completeMicroseconds;
+			};
+
+			// Shared by the workers and the main thread of a batch import
+			struct BatchState
+			{
+				std::vector<BatchJob*> jobs;
+				std::atomic<size_t> nextJob;
+				size_t numCompleted;
+				size_t maxPending;
+				std::mutex mutex;
+				std::condition_variable condition;
+			};
+
+			void runImport(HlmsEditorPluginData* data);
+
+			/* Import the file up to the point where the rendersystem is needed; this can run on any thread.
+			 * completeImport creates the mesh and must run on the thread that owns the rendersystem.
+			 */
+			bool prepareImport(HlmsEditorPluginData* data, ImportContext& context);
+			bool completeImport(HlmsEditorPluginData* data, ImportContext& context);
+
+			// Log the timings of the import stages and write the json report if the write_import_report property is set
+			void reportImport(HlmsEditorPluginData* data, ImportContext& context, bool result);
+
+			// Pump the window messages of the calling thread and log the progress when it changes
+			void pumpImport(AssImpImportProgress::Stage& loggedStage, int& loggedPercentage);
+
+			bool importFile(HlmsEditorPluginData* data, ImportContext& context);
+			bool createMesh(HlmsEditorPluginData* data, ImportContext& context);
+
+			// Reload the mesh of the file if the editor has loaded it before, so it shows the new file
+			void reloadEditorMesh(const String& meshFileName);
+			bool AssImpPlugin::parseScene(const aiScene* scene, HlmsEditorPluginData* data, ImportContext& context);
+			bool parseSceneViaXml(const aiScene* scene, HlmsEditorPluginData* data, ImportContext& context);
+
+			// Pass the lod_targets property to the simplifier; returns false if the targets are not valid
+			bool setLodTargets(HlmsEditorPluginData* data, AssImpMeshSimplifier& meshSimplifier);
+
+			/* Import all files in the directory of the selected file that match the batch_import_pattern property.
+			 * The files are prepared by a pool of workers (each with its own Assimp::Importer) and the meshes are
+			 * created on the calling thread, in the order of the file names.
+			 */
+			bool executeBatchImport(HlmsEditorPluginData* data);
+			StringVector findBatchFiles(HlmsEditorPluginData* data, const String& pattern);
+			void runBatchWorker(BatchState* state);
+			void logBatchSummary(const BatchState& state, unsigned long microseconds);
 			std::map<std::string, HlmsEditorPluginData::PLUGIN_PROPERTY> mProperties;
 
 		private:
-			MeshPtr mMeshPtr;
+			ImportContext mImportContext;
+			AssImpImportProgress mImportProgress;
+			std::thread mImportThread;
+			std::atomic<bool> mImportRunning;
+			bool mImportStarted;
+			bool mImportResult;
+			bool mBatchImportRunning;	// executeBatchImport runs; it pumps the window messages while it waits
     };
 }
 
@@ -32,6 +32,9 @@ THE SOFTWARE.
 
 #define ASSIMP_PLUGIN_EXPORTS 1
 
+// Version of the plugin; part of the import cache key, so increment it when the generated meshes change
+#define ASSIMP_PLUGIN_VERSION "1.1.0"
+
 //-----------------------------------------------------------------------
 // Windows Settings
 //-----------------------------------------------------------------------
@@ -0,0 +1,84 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of OGRE
+(Object-oriented Graphics Rendering Engine)
+For the latest info, see http://www.ogre3d.org
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef __AssImpPluginProperties_H__
+#define __AssImpPluginProperties_H__
+
+#include "hlms_editor_plugin.h"
+
+namespace Ogre
+{
+	/* Return the value of a bool property as set in the HLMS Editor settings dialog.
+	 * If the property is not available, the default value is returned.
+	 */
+	inline bool getBoolProperty(const HlmsEditorPluginData* data, const String& propertyName, bool defaultValue)
+	{
+		std::map<std::string, HlmsEditorPluginData::PLUGIN_PROPERTY>::const_iterator it = data->mInPropertiesMap.find(propertyName);
+		if (it == data->mInPropertiesMap.end())
+			return defaultValue;
+
+		return (it->second).boolValue;
+	}
+
+	/* Return the value of an int property as set in the HLMS Editor settings dialog.
+	 * If the property is not available, the default value is returned.
+	 */
+	inline int getIntProperty(const HlmsEditorPluginData* data, const String& propertyName, int defaultValue)
+	{
+		std::map<std::string, HlmsEditorPluginData::PLUGIN_PROPERTY>::const_iterator it = data->mInPropertiesMap.find(propertyName);
+		if (it == data->mInPropertiesMap.end())
+			return defaultValue;
+
+		return (it->second).intValue;
+	}
+
+	/* Return the value of a float property as set in the HLMS Editor settings dialog.
+	 * If the property is not available, the default value is returned.
+	 */
+	inline float getFloatProperty(const HlmsEditorPluginData* data, const String& propertyName, float defaultValue)
+	{
+		std::map<std::string, HlmsEditorPluginData::PLUGIN_PROPERTY>::const_iterator it = data->mInPropertiesMap.find(propertyName);
+		if (it == data->mInPropertiesMap.end())
+			return defaultValue;
+
+		return (it->second).floatValue;
+	}
+
+	/* Return the value of a string property as set in the HLMS Editor settings dialog.
+	 * If the property is not available, the default value is returned.
+	 */
+	inline String getStringProperty(const HlmsEditorPluginData* data, const String& propertyName, const String& defaultValue)
+	{
+		std::map<std::string, HlmsEditorPluginData::PLUGIN_PROPERTY>::const_iterator it = data->mInPropertiesMap.find(propertyName);
+		if (it == data->mInPropertiesMap.end())
+			return defaultValue;
+
+		return (it->second).stringValue;
+	}
+}
+
+#endif
@@ -0,0 +1,69 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of OGRE
+(Object-oriented Graphics Rendering Engine)
+For the latest info, see http://www.ogre3d.org
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef __NumberFormat_H__
+#define __NumberFormat_H__
+
+#include "OgrePrerequisites.h"
+
+namespace Ogre
+{
+	/** Fast conversion of numbers to text, without stringstreams or memory allocations.
+	 *  Floats are written with std::to_chars if the compiler supports it (C++17); otherwise snprintf is used.
+	 *  All functions write into a caller supplied buffer of at least BUFFER_SIZE bytes, add a terminating 0
+	 *  and return the number of characters written (excluding the 0).
+	 */
+	class NumberFormat
+	{
+	public:
+		static const size_t BUFFER_SIZE = 32;
+
+		// Use the shortest representation that converts back to exactly the same float
+		static const unsigned int PRECISION_SHORTEST = 0;
+
+		static size_t formatInt(char* buffer, int value);
+		static size_t formatUnsignedInt(char* buffer, unsigned int value);
+
+		/* Format a float. With PRECISION_SHORTEST the value round trips without loss; any other value is
+		 * the maximum number of significant digits (like %g), which results in smaller files if full precision
+		 * is not needed.
+		 */
+		static size_t formatFloat(char* buffer, float value, unsigned int precision = PRECISION_SHORTEST);
+
+		// Format a double with the shortest representation that converts back to exactly the same double
+		static size_t formatDouble(char* buffer, double value);
+
+		/* Read a number at the start of the text; leading white space and a '+' are skipped and
+		 * trailing characters are ignored, like sscanf does. Uses std::from_chars if the compiler
+		 * supports it. Returns false if the text does not start with a number or it is out of range.
+		 */
+		static bool parseInt(const char* text, int& value);
+		static bool parseDouble(const char* text, double& value);
+	};
+}
+
+#endif
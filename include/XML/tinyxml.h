@@ -82,6 +82,8 @@ class TiXmlElement;
 class TiXmlComment;
 class TiXmlUnknown;
 class TiXmlAttribute;
+class TiXmlAttributeSet;
+class TiXmlNameTable;
 class TiXmlText;
 class TiXmlDeclaration;
 class TiXmlParsingData;
@@ -165,6 +167,176 @@ enum TiXmlEncoding
 
 const TiXmlEncoding TIXML_DEFAULT_ENCODING = TIXML_ENCODING_UNKNOWN;
 
+/** A block allocator for the nodes and attributes of a document. Memory is handed out
+    sequentially from large blocks and is only given back in bulk, when the document is
+    cleared or destroyed. Deleting a node that was allocated from an arena runs its
+    destructor, but does not free its memory.
+*/
+class TiXmlArena
+{
+public:
+    TiXmlArena();
+    ~TiXmlArena();
+
+    /// Allocate memory, aligned for any TinyXml class.
+    void* Allocate( size_t size );
+
+    /// Free all blocks at once. Everything allocated from the arena must have been destroyed.
+    void Release();
+
+    /// Number of bytes handed out since the last Release().
+    size_t BytesAllocated() const   { return bytesAllocated; }
+
+private:
+    TiXmlArena( const TiXmlArena& );            // not implemented.
+    void operator=( const TiXmlArena& );        // not allowed.
+
+    struct Block
+    {
+        Block*  next;
+        size_t  size;
+    };
+    enum
+    {
+        BLOCK_SIZE = 64 * 1024,
+        ALIGNMENT = sizeof( double )
+    };
+
+    Block*  blocks;
+    char*   current;
+    char*   end;
+    size_t  bytesAllocated;
+};
+
+/** The value of a node or the name of an attribute. Parsed element and attribute names are
+    in the name table of their document and are shared; other values are owned by their node
+    or attribute. A null pointer is the empty string.
+*/
+struct TiXmlName
+{
+    TIXML_STRING            str;
+    unsigned int            hash;       // Only set for names in a table
+    const TiXmlNameTable*   table;      // Null if the name is owned
+
+    /// A new owned name with a copy of str, or null if it is empty.
+    static const TiXmlName* Create( const char* str, size_t length );
+    /// A new owned name that takes the contents of str, or null if it is empty.
+    static const TiXmlName* Create( TIXML_STRING* str );
+    /// Delete the name if it is owned.
+    static void Release( const TiXmlName* name )    { if ( name && !name->table ) delete name; }
+    /// The string of the name.
+    static const TIXML_STRING& Str( const TiXmlName* name ) { return name ? name->str : empty; }
+
+private:
+    static const TIXML_STRING empty;
+};
+
+/** The distinct element and attribute names of a document. The parser points its elements and
+    attributes to the names in this table instead of giving each its own string, so a parsed
+    element or attribute holds one pointer for its name, names of the same document are compared
+    by pointer, and the hash of an attribute name is not computed again. The names are kept
+    until the document is destroyed.
+*/
+class TiXmlNameTable
+{
+public:
+    TiXmlNameTable();
+    ~TiXmlNameTable();
+
+    /// Return the stored name; it is added if it is not in the table yet.
+    const TiXmlName* Intern( const char* name, size_t length );
+
+    /// Return the stored name, or null if the name is not in the table.
+    const TiXmlName* Find( const char* name, size_t length ) const;
+
+    /// The hash function of the table (FNV-1a).
+    static unsigned int Hash( const char* name, size_t length );
+
+private:
+    TiXmlNameTable( const TiXmlNameTable& );    // not implemented.
+    void operator=( const TiXmlNameTable& );    // not allowed.
+
+    // The slot with the name, or the empty slot where it belongs
+    int FindSlot( const char* name, size_t length, unsigned int hash ) const;
+
+    TiXmlName** slots;      // Open addressing; the size is a power of two
+    int         size;
+    int         count;
+};
+
+
+/** Buffered output of the Print methods. Printing writes many small pieces (tags,
+    attributes, indentation), which are collected in a large buffer and handed to the
+    target in a few large writes. The target is a FILE, a file descriptor, a callback
+    or a string that grows with the output; a string is appended to directly.
+
+    In compact mode there is no indentation and there are no line breaks between elements.
+*/
+class TiXmlOutput
+{
+public:
+    /// Receives a full buffer. Returns false if the data could not be written.
+    typedef bool (*Callback)( const char* data, size_t length, void* userData );
+
+    explicit TiXmlOutput( FILE* file );
+    explicit TiXmlOutput( int fileDescriptor );
+    explicit TiXmlOutput( TIXML_STRING* memory );
+    TiXmlOutput( Callback callback, void* userData );
+    /// Flushes the buffer; the target is not closed.
+    ~TiXmlOutput();
+
+    void SetCompact( bool _compact )        { compact = _compact; }
+    bool Compact() const                    { return compact; }
+
+    void Write( const char* data, size_t length );
+    void Write( const char* str )           { Write( str, strlen( str ) ); }
+    void Write( const TIXML_STRING& str )   { Write( str.c_str(), str.length() ); }
+    void Put( char c )
+    {
+        if ( memory )
+            (*memory) += c;
+        else
+        {
+            if ( used == BUFFER_SIZE )
+                Flush();
+            buffer[ used++ ] = c;
+        }
+    }
+
+    /// Indentation for the depth; nothing in compact mode.
+    void Indent( int depth );
+    /// A line break; nothing in compact mode.
+    void NewLine()                          { if ( !compact ) Put( '\n' ); }
+
+    /// Write the buffered output to the target. Returns false if the target failed.
+    bool Flush();
+    /// True if a write to the target failed.
+    bool Error() const                      { return error; }
+
+    // [internal use] An empty string to escape text in before it is written.
+    TIXML_STRING* Scratch()                 { scratch = ""; return &scratch; }
+
+private:
+    TiXmlOutput( const TiXmlOutput& );          // not implemented.
+    void operator=( const TiXmlOutput& );       // not allowed.
+
+    void Init();
+    bool WriteTarget( const char* data, size_t length );
+
+    enum { BUFFER_SIZE = 256 * 1024 };
+
+    FILE*           file;
+    int             fileDescriptor;
+    TIXML_STRING*   memory;
+    Callback        callback;
+    void*           userData;
+    char*           buffer;     // Not used for a string target
+    size_t          used;
+    bool            compact;
+    bool            error;
+    TIXML_STRING    scratch;
+};
+
 /** TiXmlBase is a base class for every class in TinyXml.
     It does little except to establish that TinyXml classes
     can be printed and provide some utility functions.
@@ -192,11 +364,21 @@ class TiXmlBase
     friend class TiXmlNode;
     friend class TiXmlElement;
     friend class TiXmlDocument;
+    friend class TiXmlPullReader;
 
 public:
     TiXmlBase() :   userData(0)     {}
     virtual ~TiXmlBase()            {}
 
+    /** Objects created with new, as before, live on the heap. The parser creates the nodes
+        and attributes of a document in the arena of the document, with new( arena ).
+        delete works for both; it only frees heap objects.
+    */
+    static void* operator new( size_t size )                        { return operator new( size, static_cast< TiXmlArena* >( 0 ) ); }
+    static void* operator new( size_t size, TiXmlArena* arena );
+    static void operator delete( void* p );
+    static void operator delete( void* p, TiXmlArena* )             { operator delete( p ); }
+
     /** All TinyXml classes can print themselves to a filestream
         or the string class (TiXmlString in non-STL mode, TIXML_STRING
         in STL mode.) Either or both cfile and str can be null.
@@ -206,19 +388,33 @@ public:
         
         (For an unformatted stream, use the << operator.)
     */
-    virtual void Print( FILE* cfile, int depth ) const = 0;
+    void Print( FILE* cfile, int depth ) const;
+
+    /** Print to a buffered output; Print( FILE* ) uses this as well. The output
+        decides about compact printing.
+    */
+    virtual void PrintTo( TiXmlOutput* out, int depth ) const = 0;
 
     /** The world does not agree on whether white space should be kept or
         not. In order to make everyone happy, these global, static functions
         are provided to set whether or not TinyXml will condense all white space
-        into a single space or not. The default is to condense. Note changing this
-        value is not thread safe.
+        into a single space or not. The default is to condense.
+
+        This is only the default of the documents and pull readers that are created
+        afterwards; each of them keeps its own setting (see
+        TiXmlDocument::SetCondenseWhiteSpace). Change it before starting threads, as
+        changing this value is not thread safe.
     */
     static void SetCondenseWhiteSpace( bool condense )      { condenseWhiteSpace = condense; }
 
     /// Return the current white space setting.
     static bool IsWhiteSpaceCondensed()                     { return condenseWhiteSpace; }
 
+    /** Expands entities in a string. Note this should not contain the tag's '<', '>', etc,
+        or they will be transformed into entities! This is what Print() uses for attribute values.
+    */
+    static void EncodeString( const TIXML_STRING& str, TIXML_STRING* out )  { PutString( str, out ); }
+
     /** Return the position, in the original source file, of this node or attribute.
         The row and column are 1-based. (That is the first row and first column is
         1,1). If the returns values are 0 or less, then the parser does not have
@@ -305,11 +501,17 @@ protected:
     */
     static const char* ReadText(    const char* in,             // where to start
                                     TIXML_STRING* text,         // the string read
-                                    bool ignoreWhiteSpace,      // whether to keep the white space
+                                    bool ignoreWhiteSpace,      // whether to condense the white space
                                     const char* endTag,         // what ends this text
                                     bool ignoreCase,            // whether to ignore case in the end tag
                                     TiXmlEncoding encoding );   // the current encoding
 
+    /*  Reads text that ends with endChar in place: the entities are decoded into the
+        buffer itself and the text is zero terminated where it ends. Returns a pointer past
+        endChar, or 0 on failure. All white space is kept, like ReadText does for attribute values.
+    */
+    static const char* ReadTextInSitu( char* in, const char** text, char endChar, TiXmlEncoding encoding );
+
     // If an entity has been found, transform it into a character.
     static const char* GetEntity( const char* in, char* value, int* length, TiXmlEncoding encoding );
 
@@ -353,7 +555,8 @@ protected:
 
     // Puts a string to a stream, expanding entities as it goes.
     // Note this should not contian the '<', '>', etc, or they will be transformed into entities!
-    static void PutString( const TIXML_STRING& str, TIXML_STRING* out );
+    static void PutString( const TIXML_STRING& str, TIXML_STRING* out )   { PutString( str.c_str(), str.length(), out ); }
+    static void PutString( const char* str, size_t length, TIXML_STRING* out );
 
     // Return true if the next characters in the stream are any of the endTag sequences.
     // Ignore case only works for english, and should only be relied on when comparing
@@ -363,7 +566,7 @@ protected:
                                 bool ignoreCase,
                                 TiXmlEncoding encoding );
 
-    static const char* errorString[ TIXML_ERROR_STRING_COUNT ];
+    static const char* const errorString[ TIXML_ERROR_STRING_COUNT ];
 
     TiXmlCursor location;
 
@@ -404,7 +607,7 @@ private:
         MAX_ENTITY_LENGTH = 6
 
     };
-    static Entity entity[ NUM_ENTITY ];
+    static const Entity entity[ NUM_ENTITY ];
     static bool condenseWhiteSpace;
 };
 
@@ -479,16 +682,19 @@ public:
 
         The subclasses will wrap this function.
     */
-    const char *Value() const { return value.c_str (); }
+    const char *Value() const { return ValueTStr().c_str (); }
 
     #ifdef TIXML_USE_STL
     /** Return Value() as a TIXML_STRING. If you only use STL,
         this is more efficient than calling Value().
         Only available in STL mode.
     */
-    const TIXML_STRING& ValueStr() const { return value; }
+    const TIXML_STRING& ValueStr() const { return ValueTStr(); }
     #endif
 
+    // Get the tinyxml string representation; the names of parsed elements are stored in the name table of their document
+    const TIXML_STRING& ValueTStr() const { return TiXmlName::Str( value ); }
+
     /** Changes the value of the node. Defined as:
         @verbatim
         Document:   filename of the xml file
@@ -498,11 +704,11 @@ public:
         Text:       the text string
         @endverbatim
     */
-    void SetValue(const char * _value) { value = _value;}
+    void SetValue(const char * _value) { ReplaceValue( TiXmlName::Create( _value, strlen( _value ) ) ); }
 
     #ifdef TIXML_USE_STL
     /// STL TIXML_STRING form.
-    void SetValue( const TIXML_STRING& _value ) { value = _value; }
+    void SetValue( const TIXML_STRING& _value ) { ReplaceValue( TiXmlName::Create( _value.c_str(), _value.length() ) ); }
     #endif
 
     /// Delete all the children of this node. Does not affect 'this'.
@@ -745,13 +951,16 @@ protected:
     // Figure out what is at *p, and parse it. Returns null if it is not an xml node.
     TiXmlNode* Identify( const char* start, TiXmlEncoding encoding );
 
+    // Set the value to a name that is already created; the old value is released.
+    void ReplaceValue( const TiXmlName* _value )    { TiXmlName::Release( value ); value = _value; }
+
     TiXmlNode*      parent;
     NodeType        type;
 
     TiXmlNode*      firstChild;
     TiXmlNode*      lastChild;
 
-    TIXML_STRING    value;
+    const TiXmlName* value;     // Shared with the name table for parsed elements
 
     TiXmlNode*      prev;
     TiXmlNode*      next;
@@ -778,6 +987,10 @@ public:
     TiXmlAttribute() : TiXmlBase()
     {
         document = 0;
+        name = 0;
+        situValue = 0;
+        valueType = TEXT_VALUE;
+        set = 0;
         prev = next = 0;
     }
 
@@ -785,9 +998,12 @@ public:
     /// TIXML_STRING constructor.
     TiXmlAttribute( const TIXML_STRING& _name, const TIXML_STRING& _value )
     {
-        name = _name;
+        name = TiXmlName::Create( _name.c_str(), _name.length() );
         value = _value;
         document = 0;
+        situValue = 0;
+        valueType = TEXT_VALUE;
+        set = 0;
         prev = next = 0;
     }
     #endif
@@ -795,22 +1011,45 @@ public:
     /// Construct an attribute with a name and value.
     TiXmlAttribute( const char * _name, const char * _value )
     {
-        name = _name;
+        name = TiXmlName::Create( _name, strlen( _name ) );
         value = _value;
         document = 0;
+        situValue = 0;
+        valueType = TEXT_VALUE;
+        set = 0;
         prev = next = 0;
     }
 
-    const char*     Name()  const       { return name.c_str(); }        ///< Return the name of this attribute.
-    const char*     Value() const       { return value.c_str(); }       ///< Return the value of this attribute.
+    ~TiXmlAttribute()                   { TiXmlName::Release( name ); }
+
+    const char*     Name()  const       { return NameTStr().c_str(); }  ///< Return the name of this attribute.
+    /// The type of value the attribute holds. Parsed attributes and attributes set from a string hold text.
+    enum ValueType
+    {
+        TEXT_VALUE,
+        INT_VALUE,
+        FLOAT_VALUE,
+        DOUBLE_VALUE
+    };
+
+    const char*     Value() const       ///< Return the value of this attribute.
+    {
+        if ( situValue )
+            return situValue;
+        return ( valueType == TEXT_VALUE ) ? value.c_str() : ValueTStr().c_str();
+    }
+    ValueType       Type() const        { return valueType; }   ///< Return the type of value the attribute holds.
     #ifdef TIXML_USE_STL
-    const TIXML_STRING& ValueStr() const    { return value; }               ///< Return the value of this attribute.
+    const TIXML_STRING& ValueStr() const    { return ValueTStr(); }         ///< Return the value of this attribute.
     #endif
     int             IntValue() const;                                   ///< Return the value of this attribute, converted to an integer.
     double          DoubleValue() const;                                ///< Return the value of this attribute, converted to a double.
 
     // Get the tinyxml string representation
-    const TIXML_STRING& NameTStr() const { return name; }
+    const TIXML_STRING& NameTStr() const { return TiXmlName::Str( name ); }
+    // A value that was parsed in-situ is copied into a string the first time it is asked for;
+    // a number is formatted the first time.
+    const TIXML_STRING& ValueTStr() const;
 
     /** QueryIntValue examines the value string. It is an alternative to the
         IntValue() method with richer error checking.
@@ -825,17 +1064,23 @@ public:
     /// QueryDoubleValue examines the value string. See QueryIntValue().
     int QueryDoubleValue( double* _value ) const;
 
-    void SetName( const char* _name )   { name = _name; }               ///< Set the name of this attribute.
-    void SetValue( const char* _value ) { value = _value; }             ///< Set the value.
+    void SetName( const char* _name );                                  ///< Set the name of this attribute.
+    void SetValue( const char* _value ) { value = _value; situValue = 0; valueType = TEXT_VALUE; }  ///< Set the value.
 
-    void SetIntValue( int _value );                                     ///< Set the value from an integer.
+    /** Set the value from a number. The number itself is kept and is only formatted when the
+        attribute is printed or its text is asked for; QueryIntValue and QueryDoubleValue
+        return it without parsing. Floats and doubles are formatted with the shortest text
+        that reads back as the same number.
+    */
+    void SetIntValue( int _value );
+    void SetFloatValue( float _value );                                 ///< Set the value from a float.
     void SetDoubleValue( double _value );                               ///< Set the value from a double.
 
     #ifdef TIXML_USE_STL
     /// STL TIXML_STRING form.
-    void SetName( const TIXML_STRING& _name )   { name = _name; }   
+    void SetName( const TIXML_STRING& _name );
     /// STL TIXML_STRING form.  
-    void SetValue( const TIXML_STRING& _value ) { value = _value; }
+    void SetValue( const TIXML_STRING& _value ) { value = _value; situValue = 0; valueType = TEXT_VALUE; }
     #endif
 
     /// Get the next sibling attribute in the DOM. Returns null at end.
@@ -850,20 +1095,24 @@ public:
         return const_cast< TiXmlAttribute* >( (const_cast< const TiXmlAttribute* >(this))->Previous() ); 
     }
 
-    bool operator==( const TiXmlAttribute& rhs ) const { return rhs.name == name; }
-    bool operator<( const TiXmlAttribute& rhs )  const { return name < rhs.name; }
-    bool operator>( const TiXmlAttribute& rhs )  const { return name > rhs.name; }
+    bool operator==( const TiXmlAttribute& rhs ) const { return rhs.NameTStr() == NameTStr(); }
+    bool operator<( const TiXmlAttribute& rhs )  const { return NameTStr() < rhs.NameTStr(); }
+    bool operator>( const TiXmlAttribute& rhs )  const { return NameTStr() > rhs.NameTStr(); }
 
     /*  Attribute parsing starts: first letter of the name
                          returns: the next char after the value end quote
     */
     virtual const char* Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding );
 
+    // Format the number; the buffer must have room for Ogre::NumberFormat::BUFFER_SIZE characters
+    size_t FormatNumber( char* buffer ) const;
+
     // Prints this Attribute to a FILE stream.
-    virtual void Print( FILE* cfile, int depth ) const {
+    void Print( FILE* cfile, int depth ) const {
         Print( cfile, depth, 0 );
     }
     void Print( FILE* cfile, int depth, TIXML_STRING* str ) const;
+    virtual void PrintTo( TiXmlOutput* out, int depth ) const;
 
     // [internal use]
     // Set the document pointer so the attribute can report errors.
@@ -874,8 +1123,17 @@ private:
     void operator=( const TiXmlAttribute& base );   // not allowed.
 
     TiXmlDocument*  document;   // A pointer back to a document, for error reporting.
-    TIXML_STRING name;
+    TiXmlAttributeSet* set;     // The set this attribute is in, so it can update its index when the name changes.
+    const TiXmlName* name;      // Shared with the name table for parsed attributes
     TIXML_STRING value;
+    const char* situValue;      // If set, it replaces value; it points into the buffer of an in-situ load
+    ValueType valueType;
+    union                       // The value if it is a number; value is empty until it is formatted
+    {
+        int     i;
+        float   f;
+        double  d;
+    } number;
     TiXmlAttribute* prev;
     TiXmlAttribute* next;
 };
@@ -892,6 +1150,11 @@ private:
     This version is implemented with circular lists because:
         - I like circular lists
         - it demonstrates some independence from the (typical) doubly linked list.
+
+    The list is only used for iteration. Find() searches a contiguous array of the attributes
+    and the hashes of their names instead, with room for a few attributes inside the set
+    itself. Sets with many attributes also get an open addressing hash index, so adding k
+    attributes is no longer O(k*k) string compares.
 */
 class TiXmlAttributeSet
 {
@@ -919,13 +1182,39 @@ public:
 
     #endif
 
+    // [internal use] The name of the attribute has changed.
+    void Rename( TiXmlAttribute* attribute );
+
+    // The attribute with the name; it is added if it does not exist. Returns 0 if out of memory.
+    TiXmlAttribute* FindOrCreate( const char* _name );
+
 private:
     //*ME:  Because of hidden/disabled copy-construktor in TiXmlAttribute (sentinel-element),
     //*ME:  this class must be also use a hidden/disabled copy-constructor !!!
     TiXmlAttributeSet( const TiXmlAttributeSet& );  // not allowed
     void operator=( const TiXmlAttributeSet& ); // not allowed (as TiXmlAttribute)
 
+    struct Entry
+    {
+        unsigned int    hash;
+        TiXmlAttribute* attribute;
+    };
+    enum
+    {
+        INLINE_CAPACITY = 8,    // Number of attributes that fit without a heap allocation
+        INDEX_THRESHOLD = 16    // Sets with more attributes get a hash index
+    };
+
+    int FindEntry( const char* name, size_t length ) const;
+    void BuildIndex();
+
     TiXmlAttribute sentinel;
+    Entry   inlineEntries[ INLINE_CAPACITY ];
+    Entry*  entries;        // In the order of the list; points to inlineEntries until the set grows
+    int     count;
+    int     capacity;
+    int*    index;          // Entry position + 1 per slot; 0 is an empty slot
+    int     indexSize;      // A power of two, or 0 without an index
 };
 
 
@@ -1039,6 +1328,11 @@ public:
     */
     void SetDoubleAttribute( const char * name, double value );
 
+    /** Sets an attribute of name to a given value. The attribute
+        will be created if it does not exist, or changed if it does.
+    */
+    void SetFloatAttribute( const char * name, float value );
+
     /** Deletes an attribute with the given name.
     */
     void RemoveAttribute( const char * name );
@@ -1087,8 +1381,8 @@ public:
 
     /// Creates a new Element and returns it - the returned element is a copy.
     virtual TiXmlNode* Clone() const;
-    // Print the Element to a FILE stream.
-    virtual void Print( FILE* cfile, int depth ) const;
+    // Print the Element to a buffered output.
+    virtual void PrintTo( TiXmlOutput* out, int depth ) const;
 
     /*  Attribtue parsing starts: next char past '<'
                          returns: next char past '>'
@@ -1141,8 +1435,8 @@ public:
 
     /// Returns a copy of this Comment.
     virtual TiXmlNode* Clone() const;
-    // Write this Comment to a FILE stream.
-    virtual void Print( FILE* cfile, int depth ) const;
+    // Write this Comment to a buffered output.
+    virtual void PrintTo( TiXmlOutput* out, int depth ) const;
 
     /*  Attribtue parsing starts: at the ! of the !--
                          returns: next char past '>'
@@ -1202,8 +1496,8 @@ public:
     TiXmlText( const TiXmlText& copy ) : TiXmlNode( TiXmlNode::TEXT )   { copy.CopyTo( this ); }
     void operator=( const TiXmlText& base )                             { base.CopyTo( this ); }
 
-    // Write this text object to a FILE stream.
-    virtual void Print( FILE* cfile, int depth ) const;
+    // Write this text object to a buffered output.
+    virtual void PrintTo( TiXmlOutput* out, int depth ) const;
 
     /// Queries whether this represents text using a CDATA section.
     bool CDATA() const              { return cdata; }
@@ -1281,10 +1575,11 @@ public:
     /// Creates a copy of this Declaration and returns it.
     virtual TiXmlNode* Clone() const;
     // Print this declaration to a FILE stream.
-    virtual void Print( FILE* cfile, int depth, TIXML_STRING* str ) const;
-    virtual void Print( FILE* cfile, int depth ) const {
+    void Print( FILE* cfile, int depth, TIXML_STRING* str ) const;
+    void Print( FILE* cfile, int depth ) const {
         Print( cfile, depth, 0 );
     }
+    virtual void PrintTo( TiXmlOutput* out, int depth ) const;
 
     virtual const char* Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding );
 
@@ -1328,8 +1623,8 @@ public:
 
     /// Creates a copy of this Unknown and returns it.
     virtual TiXmlNode* Clone() const;
-    // Print this Unknown to a FILE stream.
-    virtual void Print( FILE* cfile, int depth ) const;
+    // Print this Unknown to a buffered output.
+    virtual void PrintTo( TiXmlOutput* out, int depth ) const;
 
     virtual const char* Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding );
 
@@ -1372,7 +1667,7 @@ public:
     TiXmlDocument( const TiXmlDocument& copy );
     void operator=( const TiXmlDocument& copy );
 
-    virtual ~TiXmlDocument() {}
+    virtual ~TiXmlDocument();
 
     /** Load a file using the current document value.
         Returns true if successful. Will delete any existing
@@ -1393,6 +1688,34 @@ public:
     bool LoadFile( FILE*, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
     /// Save a file using the given FILE*. Returns true if successful.
     bool SaveFile( FILE* ) const;
+    /** Save to a buffered output, e.g. a file descriptor or compact printing.
+        The output is flushed. Returns true if successful.
+    */
+    bool SaveFile( TiXmlOutput* out ) const;
+
+    /** In-situ loading. When set, LoadFile maps the file copy-on-write instead of
+        reading it into a copy, normalises the line endings in that private mapping and
+        parses attribute values in place, so the attributes point into the mapping instead
+        of owning a copy of their value. The mapping is released by Clear() and the
+        destructor. Files that cannot be mapped are read into one buffer that is used
+        the same way. Off by default.
+    */
+    void SetInSitu( bool _inSitu )          { inSitu = _inSitu; }
+    bool InSitu() const                     { return inSitu; }
+
+    /** Set whether the white space of text is condensed when this document is parsed.
+        The setting is initialised from the global TiXmlBase::IsWhiteSpaceCondensed()
+        when the document is created, so documents that are parsed on different threads
+        can use different settings without touching the global.
+
+        Parsing and printing only use state of the document and of the output, and the
+        tables that are shared by all documents are constant. So distinct documents can be
+        loaded, parsed and printed concurrently; a single document must not be used by
+        several threads at the same time.
+    */
+    void SetCondenseWhiteSpace( bool condense )     { condenseWhiteSpace = condense; }
+    /// Return the white space setting of this document.
+    bool IsWhiteSpaceCondensed() const              { return condenseWhiteSpace; }
 
     #ifdef TIXML_USE_STL
     bool LoadFile( const TIXML_STRING& filename, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING )          ///< STL TIXML_STRING version.
@@ -1475,6 +1798,15 @@ public:
 
     int TabSize() const { return tabsize; }
 
+    /** Set whether the row and column of each node and attribute are tracked while
+        parsing. Tracking walks every byte of the input a second time, which is wasted
+        when the locations are never looked at. When it is off, Row() and Column() of
+        the nodes return 0, but the location of a parse error is still reported: it is
+        derived from the position of the error once the parse fails. On by default.
+    */
+    void SetTrackLocations( bool track )    { trackLocations = track; }
+    bool TrackLocations() const             { return trackLocations; }
+
     /** If you have handled the error, it can be reset with this call. The error
         state is automatically cleared if you Parse a new XML block.
     */
@@ -1495,10 +1827,21 @@ public:
     //char* PrintToMemory() const; 
 
     /// Print this Document to a FILE stream.
-    virtual void Print( FILE* cfile, int depth = 0 ) const;
+    void Print( FILE* cfile, int depth = 0 ) const  { TiXmlBase::Print( cfile, depth ); }
+    /// Print this Document to a buffered output.
+    virtual void PrintTo( TiXmlOutput* out, int depth ) const;
     // [internal use]
     void SetError( int err, const char* errorLocation, TiXmlParsingData* prevData, TiXmlEncoding encoding );
 
+    // [internal use] The arena of the nodes and attributes that are created by the parser.
+    TiXmlArena* Arena()                     { return &arena; }
+    // [internal use] The names of the elements and attributes that are created by the parser.
+    TiXmlNameTable* Names()                 { return &names; }
+    // [internal use] True if p points into the writable buffer of an in-situ load.
+    bool IsInSituBuffer( const char* p ) const  { return situBuffer && p >= situBuffer && p < situBuffer + situLength; }
+    // [internal use] Release the buffer of an in-situ load; nothing may refer to it anymore.
+    void ReleaseInSitu();
+
     virtual const TiXmlDocument*    ToDocument()    const { return this; } ///< Cast to a more defined type. Will return null not of the requested type.
     virtual TiXmlDocument*          ToDocument()          { return this; } ///< Cast to a more defined type. Will return null not of the requested type.
 
@@ -1515,13 +1858,27 @@ protected :
 
 private:
     void CopyTo( TiXmlDocument* target ) const;
+    void Init();
+
+    // Map the file copy-on-write; returns false if the file cannot be mapped.
+    bool MapFile( const char* filename );
+    // Normalise the line endings of situBuffer in place and parse it.
+    bool ParseInSitu( TiXmlEncoding encoding );
 
     bool error;
     int  errorId;
     TIXML_STRING errorDesc;
     int tabsize;
+    bool condenseWhiteSpace;
+    bool trackLocations;
     TiXmlCursor errorLocation;
     bool useMicrosoftBOM;       // the UTF-8 BOM were found when read. Note this, and try to write.
+    TiXmlArena arena;
+    TiXmlNameTable names;
+    bool inSitu;
+    char* situBuffer;           // the file of an in-situ load; zero terminated
+    size_t situLength;
+    bool situMapped;            // situBuffer is a file mapping instead of an allocated buffer
 };
 
 
@@ -1685,6 +2042,135 @@ private:
 };
 
 
+/** A pull reader for documents that are too large to build a DOM for. It reads a file
+    through a buffer and reports the document as a sequence of events, using the same
+    tokenizer as the DOM parser. Only the current tag or text is kept in memory; the buffer
+    only grows when a single tag or text does not fit in it, so the memory used depends on
+    the largest tag instead of on the size of the file.
+
+    @verbatim
+    TiXmlPullReader reader;
+    if ( reader.Open( "mesh.xml" ) )
+    {
+        TiXmlPullReader::Event event;
+        while ( ( event = reader.Next() ) > TiXmlPullReader::EVENT_END_DOCUMENT )
+        {
+            if ( event == TiXmlPullReader::EVENT_START_ELEMENT && strcmp( reader.Name(), "position" ) == 0 )
+                reader.QueryFloatAttribute( "x", &x );
+        }
+        if ( event == TiXmlPullReader::EVENT_ERROR )
+            printf( "%s\n", reader.ErrorDesc() );
+    }
+    @endverbatim
+
+    Names, attribute values and text are valid until the next call of Next(). Comments,
+    declarations and DTDs are skipped, and so is text that is only white space. An empty
+    element (<foo/>) is reported as a start and an end event. Unlike the DOM parser, the
+    reader requires attribute values to be quoted and end tags to match their start tags.
+*/
+class TiXmlPullReader
+{
+public:
+    enum Event
+    {
+        EVENT_ERROR,            ///< The file could not be read or is not well formed; see ErrorDesc().
+        EVENT_END_DOCUMENT,     ///< The root element is closed and there is no more input.
+        EVENT_START_ELEMENT,    ///< Name() and the attributes of the element are set.
+        EVENT_END_ELEMENT,      ///< Name() is set.
+        EVENT_TEXT              ///< Text() is set; this includes CDATA sections.
+    };
+
+    /// The buffer starts with bufferSize bytes.
+    TiXmlPullReader( size_t bufferSize = 64 * 1024 );
+    ~TiXmlPullReader();
+
+    /// Start reading a file. Returns false if the file cannot be opened.
+    bool Open( const char* filename );
+    /// Start reading from the current position of an open file. The reader does not close it.
+    bool Open( FILE* file );
+    /// Stop reading; this closes a file opened by name.
+    void Close();
+
+    /// Set whether the white space of text events is condensed; see TiXmlDocument::SetCondenseWhiteSpace.
+    void SetCondenseWhiteSpace( bool condense )     { condenseWhiteSpace = condense; }
+    bool IsWhiteSpaceCondensed() const              { return condenseWhiteSpace; }
+
+    /// Read the next event. After EVENT_END_DOCUMENT or EVENT_ERROR it keeps returning the same event.
+    Event Next();
+
+    /// The name of the current element.
+    const char* Name() const                    { return name.c_str(); }
+    /// The text of a text event, with the entities decoded.
+    const char* Text() const                    { return text.c_str(); }
+    /// The number of open elements; the current element is included at its start event.
+    int Depth() const                           { return depth; }
+
+    int AttributeCount() const                  { return attributeCount; }
+    const char* AttributeName( int i ) const    { return attributes[ i ].name.c_str(); }
+    const char* AttributeValue( int i ) const   { return attributes[ i ].value; }
+    /// The value of the attribute of the current element, or null if it does not have it.
+    const char* Attribute( const char* _name ) const;
+    /// Same as TiXmlElement::QueryIntAttribute.
+    int QueryIntAttribute( const char* _name, int* _value ) const;
+    /// Same as TiXmlElement::QueryDoubleAttribute.
+    int QueryDoubleAttribute( const char* _name, double* _value ) const;
+    /// Same as TiXmlElement::QueryFloatAttribute.
+    int QueryFloatAttribute( const char* _name, float* _value ) const;
+
+    /// The number of bytes read from the file so far, e.g. to show progress.
+    size_t BytesRead() const                    { return bytesRead; }
+
+    bool Error() const                          { return errorId != 0; }
+    int ErrorId() const                         { return errorId; }
+    const char* ErrorDesc() const               { return errorDesc.c_str(); }
+
+private:
+    TiXmlPullReader( const TiXmlPullReader& );  // not implemented.
+    void operator=( const TiXmlPullReader& );   // not allowed.
+
+    struct PullAttribute
+    {
+        TIXML_STRING name;
+        const char* value;      // Decoded in the buffer
+    };
+
+    // Read more of the file; the unread part is moved to the front or the buffer grows.
+    bool Fill();
+    // Find the end of the token that starts at begin. Returns false if it is not in the buffer completely.
+    bool FindTokenEnd( size_t* tokenEnd ) const;
+    Event ReadStartTag( char* p );
+    Event ReadEndTag( const char* p );
+    void ReadDeclaration( const char* p );
+    Event SetError( int err );
+
+    FILE*           file;
+    bool            ownsFile;
+    char*           buffer;     // Zero terminated at end
+    size_t          capacity;
+    size_t          begin;      // The first byte that is not parsed yet
+    size_t          end;        // The end of the data in the buffer
+    size_t          bytesRead;
+    bool            endOfFile;
+    bool            rootRead;
+    bool            pendingEnd; // The end event of an empty element is still to be reported
+    Event           finalEvent; // EVENT_END_DOCUMENT or EVENT_ERROR once reading has stopped
+    TiXmlEncoding   encoding;
+    bool            condenseWhiteSpace;
+
+    TIXML_STRING    name;
+    TIXML_STRING    text;
+    PullAttribute*  attributes;
+    int             attributeCount;
+    int             attributeCapacity;
+    TIXML_STRING*   openElements;
+    int             depth;
+    int             openCapacity;
+
+    int             errorId;
+    TIXML_STRING    errorDesc;
+};
+
+
 /** Print to memory functionality. The TiXmlPrinter is useful when you need to:
 
     -# Print to memory (especially in non-STL mode)
@@ -29,8 +29,15 @@ THE SOFTWARE.
 #define __XmlSerializer_H__
 
 #include "XML/tinyxml.h"
+#include "XmlStreamWriter.h"
+#include "AssImpImportProgress.h"
+#include "AssImpImportProfiler.h"
+#include "AssImpMeshSimplifier.h"
 #include "hlms_editor_plugin.h"
 #include <assimp/scene.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace Ogre
 {
@@ -49,6 +56,7 @@ namespace Ogre
 		/* Read the assimp scene and convert the mesh data to an xml file (and save it)
 		 * The basename of the file is the same as the basename of the imported file
 		 * E.g. If the loaded file is mymodel.fbx, the xml is called mymodel.xml
+		 * The xml is streamed to the file submesh by submesh; no TiXmlDocument is created.
 		 */
 		bool convertAssImpMeshToXml(const aiScene* scene, 
 			const String& fileNameXml,
@@ -64,70 +72,139 @@ namespace Ogre
 		 */
 		bool importOgreMeshXml(const String& xmlFileName, HlmsEditorPluginData* data);
 
+		/* Report the progress of the conversion; the conversion stops when the import is cancelled.
+		 * The progress object is optional and not owned by the serializer.
+		 */
+		void setImportProgress(AssImpImportProgress* importProgress) {mImportProgress = importProgress;}
+
+		/* Time the write functions, saving the xml file and OgreMeshTool.
+		 * The profiler is optional and not owned by the serializer.
+		 */
+		void setImportProfiler(AssImpImportProfiler* importProfiler) {mImportProfiler = importProfiler;}
+
+		/* Limit the number of chunk workers; 0 means one per core. A batch import already imports files in
+		 * parallel, so it gives each file a share of the cores.
+		 */
+		void setMaxThreads(unsigned int maxThreads) {mMaxThreads = maxThreads;}
+
+		/* Write the levels of detail generated by the simplifier, with the pixel_count strategy; a level is used
+		 * while its error is at most pixelError pixels. The simplifier is optional and not owned by the serializer.
+		 */
+		void setMeshSimplifier(const AssImpMeshSimplifier* meshSimplifier, float pixelError)
+		{
+			mMeshSimplifier = meshSimplifier;
+			mLodPixelError = pixelError;
+		}
+
 	protected:
-		// Level 2 elements
+		// Level 2 elements; the children of the root element
+		bool writeMeshElements(XmlStreamWriter& writer,
+			const aiScene* scene,
+			HlmsEditorPluginData* data);
+
 		bool writeSharedGeometry(const String& sharedGeometryId,
-			TiXmlElement* root,
+			XmlStreamWriter& writer,
 			const aiScene* scene,
 			HlmsEditorPluginData* data);
 
 		bool writeSubMeshes(const String& submMeshesId,
-			TiXmlElement* root,
+			XmlStreamWriter& writer,
 			const aiScene* scene,
 			HlmsEditorPluginData* data);
 		
 		bool writeSkeletonLink(const String& skeletonlinkId,
-			TiXmlElement* root,
+			XmlStreamWriter& writer,
 			const aiScene* scene,
 			HlmsEditorPluginData* data);
 		
 		bool writeLodInfo(const String& lodInfoId,
-			TiXmlElement* root,
+			XmlStreamWriter& writer,
 			const aiScene* scene,
 			HlmsEditorPluginData* data);
 
 		bool writeSubMeshNames(const String& subMeshNamesId,
-			TiXmlElement* root,
+			XmlStreamWriter& writer,
 			const aiScene* scene,
 			HlmsEditorPluginData* data);
 
 		bool writeExtremes(const String& extremesId,
-			TiXmlElement* root,
+			XmlStreamWriter& writer,
 			const aiScene* scene,
 			HlmsEditorPluginData* data);
 
 		bool writePoses(const String& posesId,
-			TiXmlElement* root,
+			XmlStreamWriter& writer,
 			const aiScene* scene,
 			HlmsEditorPluginData* data);
 
 		bool writeAnimations(const String& animationsId,
-			TiXmlElement* root,
+			XmlStreamWriter& writer,
 			const aiScene* scene,
 			HlmsEditorPluginData* data);
 
 		// level 3 elements
 		bool writeSubMesh(const String& submMeshId,
-			TiXmlElement* subMeshNode,
+			XmlStreamWriter& writer,
 			const aiMesh* subMesh,
 			HlmsEditorPluginData* data);
 
 		// level 4 elements
 		bool writeFaces(const String& faceId,
-			TiXmlElement* facesNode,
+			XmlStreamWriter& writer,
 			const aiMesh* subMesh,
+			unsigned int firstFace,
+			unsigned int lastFace,
 			HlmsEditorPluginData* data);
 
 		bool writeVertexBoneAssignments(const String& vertexBoneAssignmentsId,
-			TiXmlElement* boneAssignmentsNode,
+			XmlStreamWriter& writer,
 			const aiMesh* subMesh,
 			HlmsEditorPluginData* data);
 
 		// level 4 elements
 		bool writeVertices(const String& vertexBufferId,
-			TiXmlElement* vertexBufferNode,
+			XmlStreamWriter& writer,
 			const aiMesh* subMesh,
+			unsigned int firstVertex,
+			unsigned int lastVertex,
 			HlmsEditorPluginData* data);
+
+		// A range of faces or vertices of a submesh, converted to text by a worker thread
+		struct XmlChunk
+		{
+			const aiMesh* subMesh;
+			bool faces;
+			unsigned int first;
+			unsigned int last;
+			String text;
+			bool done;
+		};
+
+		/* The faces and vertices are split into chunks, which are converted to text in parallel. The chunks
+		 * are written to the file in their original order, so the output does not depend on the number of threads.
+		 */
+		bool startChunkWorkers(const aiScene* scene, HlmsEditorPluginData* data);
+		void addChunks(const aiMesh* subMesh, bool faces, unsigned int count, unsigned int chunkSize);
+		void stopChunkWorkers(void);
+		void runChunkWorker(HlmsEditorPluginData* data);
+
+		// Wait for the chunks of the faces or vertices of the submesh and write them
+		bool writeChunks(XmlStreamWriter& writer, const aiMesh* subMesh, bool faces, HlmsEditorPluginData* data);
+
+		AssImpImportProgress* mImportProgress;
+		AssImpImportProfiler* mImportProfiler;
+		unsigned int mMaxThreads;
+		const AssImpMeshSimplifier* mMeshSimplifier;
+		float mLodPixelError;
+		unsigned int mFloatPrecision;
+		std::vector<XmlChunk> mChunks;
+		size_t mNextChunk;
+		size_t mWrittenChunks;
+		size_t mChunksAhead;
+		bool mAbortChunks;
+		std::vector<std::thread> mChunkWorkers;
+		std::mutex mChunkMutex;
+		std::condition_variable mChunkCondition;
 	};
 }
 
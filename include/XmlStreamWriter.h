@@ -0,0 +1,99 @@
+/*
+-----------------------------------------------------------------------------
+This source file is part of OGRE
+(Object-oriented Graphics Rendering Engine)
+For the latest info, see http://www.ogre3d.org
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+-----------------------------------------------------------------------------
+*/
+#ifndef __XmlStreamWriter_H__
+#define __XmlStreamWriter_H__
+
+#include "OgrePrerequisites.h"
+#include <stdio.h>
+
+namespace Ogre
+{
+	/** Writes xml elements directly to a buffered file, without building a TiXmlDocument first.
+	 *  The output is formatted exactly as TiXmlDocument::SaveFile formats it (4 spaces indentation,
+	 *  empty elements as <foo />), so memory use is bounded by the file buffer instead of the document size.
+	 *  Attributes must be written directly after openElement, before any child element.
+	 *  A writer can also write into a memory buffer (openBuffer), so parts of a document can be generated
+	 *  in parallel and inserted afterwards with writeRaw.
+	 */
+	class XmlStreamWriter
+	{
+	public:
+		XmlStreamWriter(void);
+		virtual ~XmlStreamWriter(void);
+
+		// Open the file; the file is opened in text mode, the same as TiXmlDocument::SaveFile
+		bool open(const String& fileName);
+
+		// Close the file; returns false if not all data could be written
+		bool close(void);
+
+		/* Write into a memory buffer instead of a file. The elements are written as children of an element
+		 * at depth - 1, so the buffer can be passed to writeRaw of a writer that has such an element open.
+		 */
+		void openBuffer(size_t depth);
+		String& getBuffer(void) {return mText;}
+
+		/* Insert text written by a buffer writer as children of the currently open element
+		 */
+		void writeRaw(const String& text);
+
+		void openElement(const String& name);
+		void attribute(const String& name, const String& value);
+		void attribute(const String& name, int value);
+		void attribute(const String& name, unsigned int value);
+		void attribute(const String& name, float value);
+		void closeElement(void);
+
+		/* Number of significant digits of float attributes. The default, NumberFormat::PRECISION_SHORTEST,
+		 * writes the shortest text that reads back as exactly the same float.
+		 */
+		void setFloatPrecision(unsigned int precision) {mFloatPrecision = precision;}
+
+		// Number of bytes written since open or openBuffer
+		uint64 getBytesWritten(void) const {return mBytesWritten;}
+
+	protected:
+		// Numbers never contain characters that must be encoded, so they are written as-is
+		void writeNumberAttribute(const String& name, const char* value, size_t length);
+		void write(const String& value);
+		void write(const char* value, size_t length);
+		void writeIndent(size_t depth);
+
+		FILE* mFile;
+		bool mError;
+		bool mStartTagOpen;
+		unsigned int mFloatPrecision;
+		size_t mBaseDepth;
+		uint64 mBytesWritten;
+		String mText;
+		std::vector<String> mElementStack;
+		std::vector<char> mBuffer;
+	};
+}
+
+#endif
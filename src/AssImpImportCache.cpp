@@ -0,0 +1,612 @@
+/*
+  -----------------------------------------------------------------------------
+  This source file is part of OGRE
+  (Object-oriented Graphics Rendering Engine)
+  For the latest info, see http://www.ogre3d.org/
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+  -----------------------------------------------------------------------------
+*/
+
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+#include "AssImpPluginPrerequisites.h"
+#include "AssImpImportCache.h"
+#include <fstream>
+#include <algorithm>
+#include <map>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <atomic>
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <sys/stat.h>
+#	include <sys/types.h>
+#	include <dirent.h>
+#	include <unistd.h>
+#	include <utime.h>
+#endif
+
+namespace Ogre
+{
+	// Size of the chunks in which a file is read and hashed
+	static const size_t gHashChunkSize = 1024 * 1024;
+
+	// Temporary files older than this (in seconds) are left behind by a crashed instance
+	static const uint64 gStaleTmpFileAge = 3600;
+
+	// Extensions of the files that are cached with a quantized mesh: the dequantization parameters and the
+	// preview mesh for the editor. The preview does not end with .mesh, so the eviction doesn't count it as a separate
+	// entry; both files count toward the size of the entry of their mesh.
+	static const char* gQuantizationExtension = ".quantization.json";
+	static const char* gPreviewExtension = ".preview";
+
+	// Properties that don't change the imported mesh, so they are not part of the key
+	static const char* gIgnoredProperties[] =
+	{
+		"use_import_cache",
+		"batch_import_pattern",
+		"batch_import_threads",
+		"write_import_report"
+	};
+	static const size_t gNumIgnoredProperties = sizeof(gIgnoredProperties) / sizeof(gIgnoredProperties[0]);
+
+	// Makes the names of temporary files unique between the threads of one process (e.g. batch workers)
+	static std::atomic<unsigned int> gUniqueNameCounter(0);
+
+	struct CacheEntry
+	{
+		String fileName;
+		uint64 size;
+		uint64 lastUsed;
+	};
+	//---------------------------------------------------------------------
+	static bool compareCacheEntryLastUsed(const CacheEntry& a, const CacheEntry& b)
+	{
+		return a.lastUsed < b.lastUsed;
+	}
+	//---------------------------------------------------------------------
+	static bool fileExists(const String& fileName)
+	{
+		std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+		return file.is_open();
+	}
+	//---------------------------------------------------------------------
+	static String getExtension(const String& fileName)
+	{
+		String extension;
+		std::string::size_type idx = fileName.rfind('.');
+		if (idx != std::string::npos)
+		{
+			extension = fileName.substr(idx + 1);
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		}
+		return extension;
+	}
+	//---------------------------------------------------------------------
+	static String getDirectory(const String& fileName)
+	{
+		std::string::size_type idx = fileName.find_last_of("/\\");
+		if (idx == std::string::npos)
+			return "";
+		return fileName.substr(0, idx + 1);
+	}
+	//---------------------------------------------------------------------
+	static String trim(const String& value)
+	{
+		std::string::size_type first = value.find_first_not_of(" \t\r\n");
+		if (first == std::string::npos)
+			return "";
+		std::string::size_type last = value.find_last_not_of(" \t\r\n");
+		return value.substr(first, last - first + 1);
+	}
+	//---------------------------------------------------------------------
+	static String getPropertyValue(const HlmsEditorPluginData::PLUGIN_PROPERTY& property)
+	{
+		switch (property.type)
+		{
+		case HlmsEditorPluginData::INT:
+			return StringConverter::toString(property.intValue);
+		case HlmsEditorPluginData::FLOAT:
+			return StringConverter::toString(property.floatValue);
+		case HlmsEditorPluginData::STRING:
+			return property.stringValue;
+		default:
+			return StringConverter::toString(property.boolValue);
+		}
+	}
+	//---------------------------------------------------------------------
+	// Platform dependent file functions
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+	static uint64 fileTimeToSeconds(const FILETIME& fileTime)
+	{
+		// FILETIME is in 100 ns intervals since 1601
+		uint64 time = (static_cast<uint64>(fileTime.dwHighDateTime) << 32) | fileTime.dwLowDateTime;
+		return time / 10000000ULL - 11644473600ULL;
+	}
+	//---------------------------------------------------------------------
+	static void createDirectory(const String& dir)
+	{
+		CreateDirectoryA(dir.c_str(), NULL);
+	}
+	//---------------------------------------------------------------------
+	static void touchFile(const String& fileName)
+	{
+		HANDLE file = CreateFileA(fileName.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+		FILETIME now;
+		GetSystemTimeAsFileTime(&now);
+		SetFileTime(file, NULL, NULL, &now);
+		CloseHandle(file);
+	}
+	//---------------------------------------------------------------------
+	static bool renameFile(const String& sourceFileName, const String& destinationFileName)
+	{
+		return MoveFileExA(sourceFileName.c_str(), destinationFileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+	}
+	//---------------------------------------------------------------------
+	static String getUniqueName(void)
+	{
+		return StringConverter::toString(static_cast<unsigned long>(GetCurrentProcessId())) + "_" +
+			StringConverter::toString(static_cast<unsigned long>(GetTickCount())) + "_" +
+			StringConverter::toString(gUniqueNameCounter++);
+	}
+	//---------------------------------------------------------------------
+	static std::vector<CacheEntry> listDirectory(const String& dir)
+	{
+		std::vector<CacheEntry> entries;
+		WIN32_FIND_DATAA findData;
+		HANDLE find = FindFirstFileA((dir + "*").c_str(), &findData);
+		if (find == INVALID_HANDLE_VALUE)
+			return entries;
+		do
+		{
+			if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				continue;
+			CacheEntry entry;
+			entry.fileName = findData.cFileName;
+			entry.size = (static_cast<uint64>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+			entry.lastUsed = fileTimeToSeconds(findData.ftLastWriteTime);
+			entries.push_back(entry);
+		} while (FindNextFileA(find, &findData));
+		FindClose(find);
+		return entries;
+	}
+#else
+	static void createDirectory(const String& dir)
+	{
+		mkdir(dir.c_str(), 0755);
+	}
+	//---------------------------------------------------------------------
+	static void touchFile(const String& fileName)
+	{
+		utime(fileName.c_str(), NULL);
+	}
+	//---------------------------------------------------------------------
+	static bool renameFile(const String& sourceFileName, const String& destinationFileName)
+	{
+		return rename(sourceFileName.c_str(), destinationFileName.c_str()) == 0;
+	}
+	//---------------------------------------------------------------------
+	static String getUniqueName(void)
+	{
+		return StringConverter::toString(static_cast<unsigned long>(getpid())) + "_" +
+			StringConverter::toString(static_cast<unsigned long>(clock())) + "_" +
+			StringConverter::toString(gUniqueNameCounter++);
+	}
+	//---------------------------------------------------------------------
+	static std::vector<CacheEntry> listDirectory(const String& dir)
+	{
+		std::vector<CacheEntry> entries;
+		DIR* directory = opendir(dir.c_str());
+		if (!directory)
+			return entries;
+		struct dirent* dirEntry;
+		while ((dirEntry = readdir(directory)) != NULL)
+		{
+			struct stat fileStat;
+			String fileName = dirEntry->d_name;
+			if (stat((dir + fileName).c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+				continue;
+			CacheEntry entry;
+			entry.fileName = fileName;
+			entry.size = static_cast<uint64>(fileStat.st_size);
+			entry.lastUsed = static_cast<uint64>(fileStat.st_mtime);
+			entries.push_back(entry);
+		}
+		closedir(directory);
+		return entries;
+	}
+#endif
+
+	//---------------------------------------------------------------------
+	AssImpImportCache::AssImpImportCache(void) :
+		mMaxCacheSize(0)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	AssImpImportCache::~AssImpImportCache(void)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	StringVector AssImpImportCache::listFiles(const String& dir)
+	{
+		std::vector<CacheEntry> entries = listDirectory(dir);
+		StringVector fileNames;
+		std::vector<CacheEntry>::const_iterator it = entries.begin();
+		std::vector<CacheEntry>::const_iterator itEnd = entries.end();
+		while (it != itEnd)
+		{
+			fileNames.push_back(it->fileName);
+			++it;
+		}
+		return fileNames;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpImportCache::setCacheDir(const String& cacheDir, uint64 maxCacheSize)
+	{
+		mCacheDir = cacheDir;
+		mMaxCacheSize = maxCacheSize;
+		mKey = "";
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpImportCache::calculateKey(const String& fileName, HlmsEditorPluginData* data)
+	{
+		mKey = "";
+		uint64 hash = 0;
+		if (!hashFile(fileName, hash))
+			return false;
+
+		// Referenced files; a missing file is part of the key by its name only
+		StringVector referencedFiles = getReferencedFiles(fileName);
+		StringVector::iterator it = referencedFiles.begin();
+		StringVector::iterator itEnd = referencedFiles.end();
+		while (it != itEnd)
+		{
+			uint64 referencedHash = 0;
+			hashFile(*it, referencedHash);
+			hash = murmurHash64(it->c_str(), it->length(), hash);
+			hash = murmurHash64(&referencedHash, sizeof(referencedHash), hash);
+			++it;
+		}
+
+		// The properties; the map is sorted, so the order is always the same
+		std::map<std::string, HlmsEditorPluginData::PLUGIN_PROPERTY>::const_iterator itProperty = data->mInPropertiesMap.begin();
+		std::map<std::string, HlmsEditorPluginData::PLUGIN_PROPERTY>::const_iterator itPropertyEnd = data->mInPropertiesMap.end();
+		while (itProperty != itPropertyEnd)
+		{
+			if (std::find(gIgnoredProperties, gIgnoredProperties + gNumIgnoredProperties, itProperty->first) ==
+				gIgnoredProperties + gNumIgnoredProperties)
+			{
+				String property = itProperty->first + "=" + getPropertyValue(itProperty->second) + ";";
+				hash = murmurHash64(property.c_str(), property.length(), hash);
+			}
+			++itProperty;
+		}
+
+		String version = ASSIMP_PLUGIN_VERSION;
+		hash = murmurHash64(version.c_str(), version.length(), hash);
+
+		char key[17];
+		snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+		mKey = key;
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpImportCache::fetch(const String& meshFileName, const String& quantizationFileName,
+		const String& previewFileName)
+	{
+		if (mKey.empty())
+			return false;
+
+		String cachedFileName = mCacheDir + mKey + ".mesh";
+		if (!fileExists(cachedFileName))
+			return false;
+
+		// The other files are copied first. A store writes them before the mesh and an eviction
+		// removes them after it, so while the mesh is still there, a missing file means the
+		// entry is not quantized.
+		if (!fetchFile(gQuantizationExtension, quantizationFileName) || !fetchFile(gPreviewExtension, previewFileName))
+			return false;
+
+		// The entry may be evicted by another instance in the meantime; that is just a cache miss
+		if (!copyFile(cachedFileName, meshFileName))
+			return false;
+
+		// Mark as recently used
+		touchFile(cachedFileName);
+		LogManager::getSingleton().logMessage("AssImpImportCache: Using cached mesh " + cachedFileName);
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpImportCache::store(const String& meshFileName, const String& quantizationFileName,
+		const String& previewFileName)
+	{
+		if (mKey.empty())
+			return;
+
+		createDirectory(mCacheDir);
+
+		// The other files are stored before the mesh, so the rename of the mesh is the moment the
+		// entry becomes visible; a fetch never finds the mesh without them
+		if (!storeFile(gQuantizationExtension, quantizationFileName) || !storeFile(gPreviewExtension, previewFileName))
+			return;
+
+		String tmpFileName = mCacheDir + mKey + "." + getUniqueName() + ".tmp";
+		String cachedFileName = mCacheDir + mKey + ".mesh";
+		if (!copyFile(meshFileName, tmpFileName))
+		{
+			LogManager::getSingleton().logMessage("AssImpImportCache: Could not write " + tmpFileName);
+			std::remove(tmpFileName.c_str());
+			return;
+		}
+
+		// Rename is atomic; if another instance stored the same entry, either file is fine
+		if (!renameFile(tmpFileName, cachedFileName))
+		{
+			LogManager::getSingleton().logMessage("AssImpImportCache: Could not rename " + tmpFileName);
+			std::remove(tmpFileName.c_str());
+			return;
+		}
+
+		evict();
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpImportCache::fetchFile(const String& extension, const String& fileName)
+	{
+		// Without a cached file, don't leave the one of an older import
+		String cachedFileName = mCacheDir + mKey + extension;
+		if (!fileExists(cachedFileName))
+		{
+			std::remove(fileName.c_str());
+			return true;
+		}
+		return copyFile(cachedFileName, fileName);
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpImportCache::storeFile(const String& extension, const String& fileName)
+	{
+		if (!fileExists(fileName))
+			return true;
+
+		String cachedFileName = mCacheDir + mKey + extension;
+		String tmpFileName = mCacheDir + mKey + "." + getUniqueName() + ".tmp";
+		if (!copyFile(fileName, tmpFileName) || !renameFile(tmpFileName, cachedFileName))
+		{
+			LogManager::getSingleton().logMessage("AssImpImportCache: Could not write " + cachedFileName);
+			std::remove(tmpFileName.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpImportCache::evict(void)
+	{
+		std::vector<CacheEntry> entries = listDirectory(mCacheDir);
+		std::vector<CacheEntry> meshEntries;
+		std::map<String, CacheEntry> sideFiles;
+		uint64 cacheSize = 0;
+		uint64 now = static_cast<uint64>(time(NULL));
+		std::vector<CacheEntry>::iterator it = entries.begin();
+		std::vector<CacheEntry>::iterator itEnd = entries.end();
+		while (it != itEnd)
+		{
+			String extension = getExtension(it->fileName);
+			if (extension == "mesh")
+			{
+				meshEntries.push_back(*it);
+			}
+			else if (extension == "json" || extension == "preview")
+			{
+				sideFiles[it->fileName] = *it;
+			}
+			else if (extension == "tmp" && now > it->lastUsed + gStaleTmpFileAge)
+			{
+				std::remove((mCacheDir + it->fileName).c_str());
+			}
+			++it;
+		}
+
+		// The size of an entry includes the files that are cached with its mesh
+		it = meshEntries.begin();
+		itEnd = meshEntries.end();
+		while (it != itEnd)
+		{
+			String key = it->fileName.substr(0, it->fileName.length() - 5);
+			const char* sideExtensions[] = {gQuantizationExtension, gPreviewExtension};
+			for (size_t extension = 0; extension < 2; ++extension)
+			{
+				std::map<String, CacheEntry>::iterator sideFile = sideFiles.find(key + sideExtensions[extension]);
+				if (sideFile != sideFiles.end())
+				{
+					it->size += sideFile->second.size;
+					sideFiles.erase(sideFile);
+				}
+			}
+			cacheSize += it->size;
+			++it;
+		}
+
+		// Files without a mesh are left behind by an interrupted store or eviction; a store writes them before its mesh
+		std::map<String, CacheEntry>::iterator sideFile = sideFiles.begin();
+		std::map<String, CacheEntry>::iterator sideFileEnd = sideFiles.end();
+		while (sideFile != sideFileEnd)
+		{
+			if (now > sideFile->second.lastUsed + gStaleTmpFileAge)
+				std::remove((mCacheDir + sideFile->first).c_str());
+			++sideFile;
+		}
+
+		if (cacheSize <= mMaxCacheSize)
+			return;
+
+		std::sort(meshEntries.begin(), meshEntries.end(), compareCacheEntryLastUsed);
+		it = meshEntries.begin();
+		itEnd = meshEntries.end();
+		while (it != itEnd && cacheSize > mMaxCacheSize)
+		{
+			if (std::remove((mCacheDir + it->fileName).c_str()) == 0)
+			{
+				String key = it->fileName.substr(0, it->fileName.length() - 5);
+				std::remove((mCacheDir + key + gQuantizationExtension).c_str());
+				std::remove((mCacheDir + key + gPreviewExtension).c_str());
+				LogManager::getSingleton().logMessage("AssImpImportCache: Evicted " + it->fileName);
+				cacheSize -= it->size;
+			}
+			++it;
+		}
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpImportCache::hashFile(const String& fileName, uint64& hash)
+	{
+		std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		std::vector<char> buffer(gHashChunkSize);
+		uint64 size = 0;
+		while (file)
+		{
+			file.read(&buffer[0], buffer.size());
+			std::streamsize count = file.gcount();
+			if (count <= 0)
+				break;
+			hash = murmurHash64(&buffer[0], static_cast<size_t>(count), hash);
+			size += static_cast<uint64>(count);
+		}
+
+		hash = murmurHash64(&size, sizeof(size), hash);
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	StringVector AssImpImportCache::getReferencedFiles(const String& fileName)
+	{
+		StringVector referencedFiles;
+		String extension = getExtension(fileName);
+		String directory = getDirectory(fileName);
+		if (extension == "obj")
+		{
+			// Material libraries
+			std::ifstream file(fileName.c_str());
+			String line;
+			while (std::getline(file, line))
+			{
+				line = trim(line);
+				if (line.compare(0, 7, "mtllib ") == 0)
+					referencedFiles.push_back(directory + trim(line.substr(7)));
+			}
+		}
+		else if (extension == "gltf")
+		{
+			// Buffers and images; embedded data uri's are already part of the file itself
+			std::ifstream file(fileName.c_str());
+			String content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			std::string::size_type idx = content.find("\"uri\"");
+			while (idx != std::string::npos)
+			{
+				std::string::size_type start = content.find('"', content.find(':', idx));
+				std::string::size_type end = start == std::string::npos ? start : content.find('"', start + 1);
+				if (end == std::string::npos)
+					break;
+				String uri = content.substr(start + 1, end - start - 1);
+				if (uri.compare(0, 5, "data:") != 0)
+					referencedFiles.push_back(directory + uri);
+				idx = content.find("\"uri\"", end);
+			}
+		}
+
+		return referencedFiles;
+	}
+
+	//---------------------------------------------------------------------
+	uint64 AssImpImportCache::murmurHash64(const void* key, size_t length, uint64 seed)
+	{
+		// MurmurHash64A by Austin Appleby (public domain)
+		const uint64 m = 0xc6a4a7935bd1e995ULL;
+		const int r = 47;
+		uint64 h = seed ^ (length * m);
+
+		const unsigned char* data = static_cast<const unsigned char*>(key);
+		const unsigned char* end = data + (length / 8) * 8;
+		while (data != end)
+		{
+			uint64 k;
+			memcpy(&k, data, sizeof(k));
+			data += 8;
+
+			k *= m;
+			k ^= k >> r;
+			k *= m;
+
+			h ^= k;
+			h *= m;
+		}
+
+		switch (length & 7)
+		{
+		case 7: h ^= static_cast<uint64>(data[6]) << 48;
+		case 6: h ^= static_cast<uint64>(data[5]) << 40;
+		case 5: h ^= static_cast<uint64>(data[4]) << 32;
+		case 4: h ^= static_cast<uint64>(data[3]) << 24;
+		case 3: h ^= static_cast<uint64>(data[2]) << 16;
+		case 2: h ^= static_cast<uint64>(data[1]) << 8;
+		case 1: h ^= static_cast<uint64>(data[0]);
+			h *= m;
+		};
+
+		h ^= h >> r;
+		h *= m;
+		h ^= h >> r;
+		return h;
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpImportCache::copyFile(const String& sourceFileName, const String& destinationFileName)
+	{
+		std::ifstream source(sourceFileName.c_str(), std::ios::in | std::ios::binary);
+		if (!source.is_open())
+			return false;
+
+		std::ofstream destination(destinationFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!destination.is_open())
+			return false;
+
+		destination << source.rdbuf();
+		destination.close();
+		return !destination.fail();
+	}
+}
@@ -0,0 +1,220 @@
+/*
+  -----------------------------------------------------------------------------
+  This source file is part of OGRE
+  (Object-oriented Graphics Rendering Engine)
+  For the latest info, see http://www.ogre3d.org/
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+  -----------------------------------------------------------------------------
+*/
+
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+#include "AssImpPluginPrerequisites.h"
+#include "AssImpImportProfiler.h"
+#include <fstream>
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <time.h>
+#endif
+
+namespace Ogre
+{
+	//---------------------------------------------------------------------
+	AssImpImportProfiler::Scope::Scope(AssImpImportProfiler* profiler, const String& stageName) :
+		mProfiler(profiler),
+		mStageName(stageName),
+		mBytes(0),
+		mStartCpuMicroseconds(profiler ? getThreadCpuMicroseconds() : 0)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	AssImpImportProfiler::Scope::~Scope(void)
+	{
+		if (mProfiler)
+			mProfiler->addStage(mStageName, mTimer.getMicroseconds(), getThreadCpuMicroseconds() - mStartCpuMicroseconds, mBytes);
+	}
+
+	//---------------------------------------------------------------------
+	AssImpImportProfiler::AssImpImportProfiler(void)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	AssImpImportProfiler::~AssImpImportProfiler(void)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpImportProfiler::reset(const String& fileName)
+	{
+		std::lock_guard<std::mutex> lock(mStagesMutex);
+		mFileName = fileName;
+		mStages.clear();
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpImportProfiler::addStage(const String& stageName, uint64 wallMicroseconds, uint64 cpuMicroseconds, uint64 bytes)
+	{
+		std::lock_guard<std::mutex> lock(mStagesMutex);
+
+		// There are only a few stages, so a linear search is fine
+		std::vector<Stage>::iterator it = mStages.begin();
+		std::vector<Stage>::iterator itEnd = mStages.end();
+		while (it != itEnd && it->name != stageName)
+			++it;
+
+		if (it == itEnd)
+		{
+			Stage stage;
+			stage.name = stageName;
+			stage.wallMicroseconds = 0;
+			stage.cpuMicroseconds = 0;
+			stage.bytes = 0;
+			stage.calls = 0;
+			mStages.push_back(stage);
+			it = mStages.end() - 1;
+		}
+
+		it->wallMicroseconds += wallMicroseconds;
+		it->cpuMicroseconds += cpuMicroseconds;
+		it->bytes += bytes;
+		++it->calls;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpImportProfiler::logStages(void) const
+	{
+		std::lock_guard<std::mutex> lock(mStagesMutex);
+		LogManager& logManager = LogManager::getSingleton();
+		logManager.logMessage("AssImpImportProfiler: " + mFileName);
+		std::vector<Stage>::const_iterator it = mStages.begin();
+		std::vector<Stage>::const_iterator itEnd = mStages.end();
+		while (it != itEnd)
+		{
+			logManager.logMessage("AssImpImportProfiler:     " + it->name +
+				": wall " + StringConverter::toString(static_cast<Real>(it->wallMicroseconds) / 1000.0f) + " ms" +
+				", cpu " + StringConverter::toString(static_cast<Real>(it->cpuMicroseconds) / 1000.0f) + " ms" +
+				", " + StringConverter::toString(static_cast<size_t>(it->bytes)) + " bytes" +
+				", " + StringConverter::toString(it->calls) + " calls");
+			++it;
+		}
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpImportProfiler::writeReport(const String& reportFileName, bool importResult) const
+	{
+		std::ofstream report(reportFileName.c_str(), std::ios::out | std::ios::trunc);
+		if (!report.is_open())
+			return false;
+
+		std::lock_guard<std::mutex> lock(mStagesMutex);
+		report << "{\n";
+		report << "    \"plugin_version\": \"" << ASSIMP_PLUGIN_VERSION << "\",\n";
+		report << "    \"file\": \"" << escapeJson(mFileName) << "\",\n";
+		report << "    \"result\": " << (importResult ? "true" : "false") << ",\n";
+		report << "    \"stages\": [";
+		std::vector<Stage>::const_iterator it = mStages.begin();
+		std::vector<Stage>::const_iterator itEnd = mStages.end();
+		while (it != itEnd)
+		{
+			if (it != mStages.begin())
+				report << ",";
+			report << "\n        {\"name\": \"" << escapeJson(it->name) << "\"" <<
+				", \"wall_us\": " << it->wallMicroseconds <<
+				", \"cpu_us\": " << it->cpuMicroseconds <<
+				", \"bytes\": " << it->bytes <<
+				", \"calls\": " << it->calls << "}";
+			++it;
+		}
+		report << "\n    ]\n}\n";
+
+		report.close();
+		return !report.fail();
+	}
+
+	//---------------------------------------------------------------------
+	uint64 AssImpImportProfiler::getFileSize(const String& fileName)
+	{
+		std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return 0;
+
+		return static_cast<uint64>(file.tellg());
+	}
+
+	//---------------------------------------------------------------------
+	uint64 AssImpImportProfiler::getThreadCpuMicroseconds(void)
+	{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+		// Kernel and user time in units of 100 ns
+		FILETIME creationTime;
+		FILETIME exitTime;
+		FILETIME kernelTime;
+		FILETIME userTime;
+		if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+			return 0;
+		uint64 kernel = (static_cast<uint64>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+		uint64 user = (static_cast<uint64>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+		return (kernel + user) / 10;
+#else
+		struct timespec time;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+			return 0;
+		return static_cast<uint64>(time.tv_sec) * 1000000 + static_cast<uint64>(time.tv_nsec) / 1000;
+#endif
+	}
+
+	//---------------------------------------------------------------------
+	String AssImpImportProfiler::escapeJson(const String& value)
+	{
+		// File names on Windows contain backslashes
+		String escaped;
+		escaped.reserve(value.length());
+		String::const_iterator it = value.begin();
+		String::const_iterator itEnd = value.end();
+		while (it != itEnd)
+		{
+			char c = *it;
+			if (c == '"' || c == '\\')
+			{
+				escaped += '\\';
+				escaped += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char buffer[8];
+				snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned int>(c));
+				escaped += buffer;
+			}
+			else
+			{
+				escaped += c;
+			}
+			++it;
+		}
+
+		return escaped;
+	}
+}
@@ -0,0 +1,110 @@
+/*
+  -----------------------------------------------------------------------------
+  This source file is part of OGRE
+  (Object-oriented Graphics Rendering Engine)
+  For the latest info, see http://www.ogre3d.org/
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+  -----------------------------------------------------------------------------
+*/
+
+#include "AssImpImportProgress.h"
+
+namespace Ogre
+{
+	static const String gStageNames[] =
+	{
+		"",
+		"Reading file",
+		"Optimizing",
+		"Simplifying",
+		"Converting",
+		"Creating mesh",
+		"Done"
+	};
+
+	//---------------------------------------------------------------------
+	AssImpImportProgress::AssImpImportProgress(void) :
+		mParent(0),
+		mStage(STAGE_IDLE),
+		mProgress(0.0f),
+		mCancelled(false)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	AssImpImportProgress::~AssImpImportProgress(void)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpImportProgress::reset(void)
+	{
+		mStage.store(STAGE_IDLE);
+		mProgress.store(0.0f);
+		mCancelled.store(false);
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpImportProgress::setStage(Stage stage)
+	{
+		mProgress.store(0.0f);
+		mStage.store(stage);
+	}
+
+	//---------------------------------------------------------------------
+	const String& AssImpImportProgress::getStageName(void) const
+	{
+		return gStageNames[getStage()];
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpImportProgress::checkCancelled(HlmsEditorPluginData* data) const
+	{
+		if (!isCancelled())
+			return false;
+
+		data->mOutErrorText = "The import was cancelled";
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	AssImpProgressHandler::AssImpProgressHandler(AssImpImportProgress* progress) :
+		mProgress(progress)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	AssImpProgressHandler::~AssImpProgressHandler(void)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpProgressHandler::Update(float percentage)
+	{
+		// A negative value means that the progress is unknown
+		if (percentage >= 0.0f)
+			mProgress->setProgress(percentage);
+
+		// Returning false aborts the import
+		return !mProgress->isCancelled();
+	}
+}
@@ -0,0 +1,327 @@
+/*
+  -----------------------------------------------------------------------------
+  This source file is part of OGRE
+  (Object-oriented Graphics Rendering Engine)
+  For the latest info, see http://www.ogre3d.org/
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+  -----------------------------------------------------------------------------
+*/
+
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+#include "AssImpMappedIOSystem.h"
+#include <string.h>
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+namespace Ogre
+{
+	//---------------------------------------------------------------------
+	AssImpMappedIOStream::AssImpMappedIOStream(AssImpMappedIOSystem* ioSystem, const String& fileName) :
+		mIOSystem(ioSystem),
+		mFileName(fileName),
+		mData(0),
+		mSize(0),
+		mPosition(0),
+		mBytesRead(0),
+		mMapped(false)
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+		,mFileHandle(INVALID_HANDLE_VALUE),
+		mMappingHandle(0)
+#endif
+	{
+	}
+
+	//---------------------------------------------------------------------
+	AssImpMappedIOStream::~AssImpMappedIOStream(void)
+	{
+		unmap();
+		if (mMapped)
+			mIOSystem->addBytesRead(mFileName, mBytesRead);
+	}
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+	//---------------------------------------------------------------------
+	bool AssImpMappedIOStream::map(void)
+	{
+		mFileHandle = CreateFileA(mFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (mFileHandle == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(mFileHandle, &fileSize))
+			return false;
+		mSize = static_cast<size_t>(fileSize.QuadPart);
+
+		// An empty file cannot be mapped, but it is a valid file
+		if (mSize == 0)
+		{
+			mMapped = true;
+			return true;
+		}
+
+		mMappingHandle = CreateFileMappingA(mFileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!mMappingHandle)
+			return false;
+
+		mData = static_cast<const char*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+		mMapped = mData != 0;
+		return mMapped;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMappedIOStream::unmap(void)
+	{
+		if (mData)
+			UnmapViewOfFile(mData);
+		if (mMappingHandle)
+			CloseHandle(mMappingHandle);
+		if (mFileHandle != INVALID_HANDLE_VALUE)
+			CloseHandle(mFileHandle);
+		mData = 0;
+		mMappingHandle = 0;
+		mFileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	//---------------------------------------------------------------------
+	bool AssImpMappedIOStream::map(void)
+	{
+		int file = open(mFileName.c_str(), O_RDONLY);
+		if (file < 0)
+			return false;
+
+		struct stat fileStat;
+		if (fstat(file, &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+		{
+			close(file);
+			return false;
+		}
+		mSize = static_cast<size_t>(fileStat.st_size);
+
+		// An empty file cannot be mapped, but it is a valid file
+		if (mSize == 0)
+		{
+			close(file);
+			mMapped = true;
+			return true;
+		}
+
+		// The mapping stays valid after closing the file descriptor
+		void* data = mmap(0, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (data == MAP_FAILED)
+			return false;
+
+		// Most importers read the file front to back
+		madvise(data, mSize, MADV_SEQUENTIAL);
+		mData = static_cast<const char*>(data);
+		mMapped = true;
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMappedIOStream::unmap(void)
+	{
+		if (mData)
+			munmap(const_cast<char*>(mData), mSize);
+		mData = 0;
+	}
+#endif
+
+	//---------------------------------------------------------------------
+	size_t AssImpMappedIOStream::Read(void* buffer, size_t size, size_t count)
+	{
+		// Same semantics as fread; only complete elements are read
+		if (size == 0 || count == 0 || mPosition >= mSize)
+			return 0;
+
+		size_t available = (mSize - mPosition) / size;
+		if (count > available)
+			count = available;
+
+		size_t bytes = size * count;
+		memcpy(buffer, mData + mPosition, bytes);
+		mPosition += bytes;
+		mBytesRead += bytes;
+		return count;
+	}
+
+	//---------------------------------------------------------------------
+	size_t AssImpMappedIOStream::Write(const void*, size_t, size_t)
+	{
+		// Read-only stream
+		return 0;
+	}
+
+	//---------------------------------------------------------------------
+	aiReturn AssImpMappedIOStream::Seek(size_t offset, aiOrigin origin)
+	{
+		size_t position;
+		switch (origin)
+		{
+		case aiOrigin_SET:
+			position = offset;
+			break;
+		case aiOrigin_CUR:
+			position = mPosition + offset;
+			break;
+		case aiOrigin_END:
+			// The offset is a size_t, so it counts back from the end here. The default IOStream passes it to
+			// fseek(SEEK_END) unchanged, which seeks past the end; the two only agree for an offset of 0
+			if (offset > mSize)
+				return aiReturn_FAILURE;
+			position = mSize - offset;
+			break;
+		default:
+			return aiReturn_FAILURE;
+		}
+
+		if (position > mSize)
+			return aiReturn_FAILURE;
+
+		mPosition = position;
+		return aiReturn_SUCCESS;
+	}
+
+	//---------------------------------------------------------------------
+	size_t AssImpMappedIOStream::Tell(void) const
+	{
+		return mPosition;
+	}
+
+	//---------------------------------------------------------------------
+	size_t AssImpMappedIOStream::FileSize(void) const
+	{
+		return mSize;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMappedIOStream::Flush(void)
+	{
+		// Nothing to do
+	}
+
+	//---------------------------------------------------------------------
+	AssImpMappedIOSystem::AssImpMappedIOSystem(void)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	AssImpMappedIOSystem::~AssImpMappedIOSystem(void)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMappedIOSystem::Exists(const char* fileName) const
+	{
+		return mDefaultIOSystem.Exists(fileName);
+	}
+
+	//---------------------------------------------------------------------
+	char AssImpMappedIOSystem::getOsSeparator(void) const
+	{
+		return mDefaultIOSystem.getOsSeparator();
+	}
+
+	//---------------------------------------------------------------------
+	Assimp::IOStream* AssImpMappedIOSystem::Open(const char* fileName, const char* mode)
+	{
+		// Only plain reads are mapped
+		if (strchr(mode, 'w') || strchr(mode, 'a') || strchr(mode, '+'))
+			return mDefaultIOSystem.Open(fileName, mode);
+
+		AssImpMappedIOStream* stream = new AssImpMappedIOStream(this, fileName);
+		if (!stream->map())
+		{
+			delete stream;
+
+			// Not a regular file or the mapping failed; let the default IOSystem try
+			return mDefaultIOSystem.Open(fileName, mode);
+		}
+
+		return stream;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMappedIOSystem::Close(Assimp::IOStream* stream)
+	{
+		delete stream;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMappedIOSystem::addBytesRead(const String& fileName, uint64 bytesRead)
+	{
+		std::lock_guard<std::mutex> lock(mBytesReadMutex);
+		mBytesRead[fileName] += bytesRead;
+	}
+
+	//---------------------------------------------------------------------
+	std::map<String, uint64> AssImpMappedIOSystem::getBytesRead(void) const
+	{
+		std::lock_guard<std::mutex> lock(mBytesReadMutex);
+		return mBytesRead;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMappedIOSystem::resetBytesRead(void)
+	{
+		std::lock_guard<std::mutex> lock(mBytesReadMutex);
+		mBytesRead.clear();
+	}
+
+	//---------------------------------------------------------------------
+	uint64 AssImpMappedIOSystem::getTotalBytesRead(void) const
+	{
+		std::lock_guard<std::mutex> lock(mBytesReadMutex);
+		uint64 totalBytesRead = 0;
+		std::map<String, uint64>::const_iterator it = mBytesRead.begin();
+		std::map<String, uint64>::const_iterator itEnd = mBytesRead.end();
+		while (it != itEnd)
+		{
+			totalBytesRead += it->second;
+			++it;
+		}
+		return totalBytesRead;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMappedIOSystem::logBytesRead(void) const
+	{
+		std::map<String, uint64> bytesRead = getBytesRead();
+		std::map<String, uint64>::const_iterator it = bytesRead.begin();
+		std::map<String, uint64>::const_iterator itEnd = bytesRead.end();
+		while (it != itEnd)
+		{
+			LogManager::getSingleton().logMessage("AssImpMappedIOSystem: " + it->first + ": " +
+				StringConverter::toString(static_cast<size_t>(it->second)) + " bytes read");
+			++it;
+		}
+	}
+}
@@ -0,0 +1,985 @@
+/*
+  -----------------------------------------------------------------------------
+  This source file is part of OGRE
+  (Object-oriented Graphics Rendering Engine)
+  For the latest info, see http://www.ogre3d.org/
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+  -----------------------------------------------------------------------------
+*/
+
+#include "OgreRoot.h"
+#include "OgreRenderSystem.h"
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+#include "OgreMeshManager2.h"
+#include "OgreSubMesh2.h"
+#include "OgreMeshSerializer.h"
+#include "OgreBitwise.h"
+#include "OgreMath.h"
+#include "OgreMatrix3.h"
+#include "Vao/OgreVaoManager.h"
+#include "Vao/OgreVertexArrayObject.h"
+#include "AssImpMeshBuilder.h"
+#include "AssImpPluginProperties.h"
+#include "NumberFormat.h"
+#include <limits>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+namespace Ogre
+{
+	//---------------------------------------------------------------------
+	// Number of vertices between two checks for cancellation
+	static const unsigned int gVerticesPerProgressUpdate = 65536;
+
+	//---------------------------------------------------------------------
+	// Format names in the file with the dequantization parameters
+	static const char* getFormatName(VertexElementType type)
+	{
+		switch (type)
+		{
+		case VET_FLOAT2:
+		case VET_FLOAT3:
+		case VET_FLOAT4:
+			return "float";
+		case VET_HALF2:
+		case VET_HALF4:
+			return "half";
+		case VET_USHORT2_NORM:
+		case VET_USHORT4_NORM:
+			return "unorm16";
+		case VET_UBYTE4_NORM:
+			return "unorm8";
+		default:
+			return "unknown";
+		}
+	}
+
+	//---------------------------------------------------------------------
+	static String formatFloat(float value)
+	{
+		char buffer[NumberFormat::BUFFER_SIZE];
+		NumberFormat::formatFloat(buffer, value);
+		return String(buffer);
+	}
+
+	//---------------------------------------------------------------------
+	static String formatVector(const Vector3& value)
+	{
+		return "[" + formatFloat(value.x) + ", " + formatFloat(value.y) + ", " + formatFloat(value.z) + "]";
+	}
+
+	//---------------------------------------------------------------------
+	AssImpMeshBuilder::AssImpMeshBuilder(void) :
+		mImportProgress(0),
+		mNumVerticesPacked(0),
+		mNumVerticesTotal(0),
+		mMinimum(Vector3(std::numeric_limits<Real>::max())),
+		mMaximum(Vector3(-std::numeric_limits<Real>::max()))
+	{
+		mOptions.qTangents = false;
+		mOptions.halfPositions = false;
+		mOptions.halfTexCoords = false;
+		mOptions.shadowMapBuffers = false;
+		mOptions.quantize = false;
+		mOptions.quantizationTolerance = 0.002f;
+	}
+
+	//---------------------------------------------------------------------
+	AssImpMeshBuilder::~AssImpMeshBuilder(void)
+	{
+		clear();
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshBuilder::clear(void)
+	{
+		std::vector<SubMeshData>::iterator it = mSubMeshes.begin();
+		std::vector<SubMeshData>::iterator itEnd = mSubMeshes.end();
+		while (it != itEnd)
+		{
+			if (it->vertexData)
+				OGRE_FREE_SIMD(it->vertexData, MEMCATEGORY_GEOMETRY);
+			if (it->previewVertexData)
+				OGRE_FREE_SIMD(it->previewVertexData, MEMCATEGORY_GEOMETRY);
+			if (it->indexData)
+				OGRE_FREE_SIMD(it->indexData, MEMCATEGORY_GEOMETRY);
+			++it;
+		}
+
+		mSubMeshes.clear();
+		mMinimum = Vector3(std::numeric_limits<Real>::max());
+		mMaximum = Vector3(-std::numeric_limits<Real>::max());
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshBuilder::readOptions(HlmsEditorPluginData* data)
+	{
+		// Same options as passed to OgreMeshTool by XmlSerializer::convertXmlFileToMesh
+		mOptions.qTangents = true;
+		mOptions.shadowMapBuffers = true;
+		bool optimizeForDesktop = getBoolProperty(data, "optimize_for_desktop", true);
+		mOptions.halfPositions = optimizeForDesktop;
+		mOptions.halfTexCoords = optimizeForDesktop;
+
+		// Compact vertex formats; the shader must apply the parameters written by saveMesh
+		mOptions.quantize = getBoolProperty(data, "quantize_vertices", false);
+		mOptions.quantizationTolerance = getFloatProperty(data, "quantization_tolerance", 0.002f);
+
+		// Edge lists only exist in v1 meshes
+		if (getBoolProperty(data, "generate_edge_lists", false))
+			LogManager::getSingleton().logMessage("AssImpMeshBuilder: Edge lists are not supported by v2 meshes; ignored");
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMeshBuilder::prepareSubMeshes(const aiScene* scene, HlmsEditorPluginData* data)
+	{
+		clear();
+		readOptions(data);
+		if (!scene->HasMeshes())
+		{
+			data->mOutErrorText = "The loaded model does not have any (sub)meshes";
+			return false;
+		}
+
+		// All meshes in the scene become submeshes in Ogre
+		mSubMeshes.resize(scene->mNumMeshes);
+		mQuantization.clear();
+		mNumVerticesPacked = 0;
+		mNumVerticesTotal = 0;
+		unsigned int meshCount = 0;
+		while (meshCount < scene->mNumMeshes)
+		{
+			mNumVerticesTotal += scene->mMeshes[meshCount]->mNumVertices;
+			++meshCount;
+		}
+
+		// With quantization, every vertex is packed twice
+		if (mOptions.quantize)
+			mNumVerticesTotal *= 2;
+
+		meshCount = 0;
+		while (meshCount < scene->mNumMeshes)
+		{
+			SubMeshData& subMeshData = mSubMeshes[meshCount];
+			subMeshData.vertexData = 0;
+			subMeshData.previewVertexData = 0;
+			subMeshData.numVertices = 0;
+			subMeshData.indexType = IndexBufferPacked::IT_16BIT;
+			subMeshData.indexData = 0;
+			subMeshData.numIndices = 0;
+			subMeshData.writeNormals = false;
+			subMeshData.writeTangents = false;
+			subMeshData.writeQTangents = false;
+			if (!prepareSubMesh(scene->mMeshes[meshCount], subMeshData, data))
+			{
+				clear();
+				return false;
+			}
+
+			++meshCount;
+		}
+
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMeshBuilder::prepareSubMesh(const aiMesh* subMesh,
+		SubMeshData& subMeshData,
+		HlmsEditorPluginData* data)
+	{
+		if (!subMesh->HasPositions() || !subMesh->HasFaces())
+		{
+			data->mOutErrorText = "Error; the model contains a (sub)mesh without vertices or faces";
+			return false;
+		}
+
+		if (subMesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+		{
+			data->mOutErrorText = "Error; only models with triangle lists are supported";
+			return false;
+		}
+
+		// Same material as the xml path; the material is assigned in the editor
+		subMeshData.materialName = "BaseWhite";
+
+		// Vertex layout: position, normal, tangent, texture coordinates
+		// QTangents replace both the normal and the tangent, so they are only used if both are available
+		subMeshData.writeNormals = subMesh->HasNormals();
+		// Like the xml path, the tangents calculated by assimp are written whenever they are available
+		subMeshData.writeTangents = subMesh->HasTangentsAndBitangents();
+		subMeshData.writeQTangents = subMeshData.writeNormals && subMeshData.writeTangents && mOptions.qTangents;
+
+		// Formats without quantization; vertex colours are only written by the quantization profile
+		Quantization& quantization = subMeshData.quantization;
+		quantization.positionType = mOptions.halfPositions ? VET_HALF4 : VET_FLOAT3;
+		quantization.positionOffset = Vector3::ZERO;
+		quantization.positionScale = Vector3::UNIT_SCALE;
+		quantization.octahedralNormals = false;
+		quantization.writeColours = false;
+		quantization.colourType = VET_FLOAT4;
+		quantization.texCoordTypes.clear();
+		unsigned int textureCoordSet = 0;
+		while (subMesh->HasTextureCoords(textureCoordSet))
+		{
+			quantization.texCoordTypes.push_back(mOptions.halfTexCoords ? VET_HALF2 : VET_FLOAT2);
+			++textureCoordSet;
+		}
+		quantization.positionError = 0.0f;
+		quantization.normalError = 0.0f;
+		quantization.texCoordError = 0.0f;
+		quantization.colourError = 0.0f;
+		Quantization previewQuantization = quantization;
+		if (mOptions.quantize)
+			quantizeSubMesh(subMesh, subMeshData);
+		mQuantization.push_back(quantization);
+
+		subMeshData.numVertices = subMesh->mNumVertices;
+		buildVertexElements(subMeshData, quantization, subMeshData.vertexElements);
+		if (!packVertices(subMesh, subMeshData, quantization, subMeshData.vertexElements, subMeshData.vertexData, data))
+			return false;
+
+		// The preview keeps the vertex colours of the quantization profile, as floats
+		if (mOptions.quantize)
+		{
+			previewQuantization.writeColours = quantization.writeColours;
+			buildVertexElements(subMeshData, previewQuantization, subMeshData.previewVertexElements);
+			if (!packVertices(subMesh, subMeshData, previewQuantization, subMeshData.previewVertexElements,
+				subMeshData.previewVertexData, data))
+				return false;
+		}
+
+		packIndices(subMesh, subMeshData);
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshBuilder::buildVertexElements(const SubMeshData& subMeshData,
+		const Quantization& quantization,
+		VertexElement2Vec& vertexElements)
+	{
+		vertexElements.push_back(VertexElement2(quantization.positionType, VES_POSITION));
+		if (subMeshData.writeQTangents)
+		{
+			vertexElements.push_back(VertexElement2(VET_SHORT4_SNORM, VES_NORMAL));
+		}
+		else
+		{
+			if (subMeshData.writeNormals)
+				vertexElements.push_back(VertexElement2(quantization.octahedralNormals ? VET_SHORT2_SNORM : VET_FLOAT3,
+					VES_NORMAL));
+			if (subMeshData.writeTangents)
+				vertexElements.push_back(VertexElement2(VET_FLOAT4, VES_TANGENT));
+		}
+		if (quantization.writeColours)
+			vertexElements.push_back(VertexElement2(quantization.colourType, VES_DIFFUSE));
+		std::vector<VertexElementType>::const_iterator it = quantization.texCoordTypes.begin();
+		std::vector<VertexElementType>::const_iterator itEnd = quantization.texCoordTypes.end();
+		while (it != itEnd)
+		{
+			vertexElements.push_back(VertexElement2(*it, VES_TEXTURE_COORDINATES));
+			++it;
+		}
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshBuilder::quantizeSubMesh(const aiMesh* subMesh, SubMeshData& subMeshData)
+	{
+		Quantization& quantization = subMeshData.quantization;
+		const float tolerance = mOptions.quantizationTolerance;
+		unsigned int vertexCount = 0;
+
+		// Positions; unorm16, normalised to the bounds of the submesh
+		Vector3 minimum(std::numeric_limits<Real>::max());
+		Vector3 maximum(-std::numeric_limits<Real>::max());
+		while (vertexCount < subMesh->mNumVertices)
+		{
+			const aiVector3D& vertex = subMesh->mVertices[vertexCount];
+			minimum.makeFloor(Vector3(vertex.x, vertex.y, vertex.z));
+			maximum.makeCeil(Vector3(vertex.x, vertex.y, vertex.z));
+			++vertexCount;
+		}
+		Vector3 extent = maximum - minimum;
+		Real maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+		Vector3 inverseExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+			extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+			extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+		float positionError = 0.0f;
+		vertexCount = 0;
+		while (vertexCount < subMesh->mNumVertices)
+		{
+			const aiVector3D& vertex = subMesh->mVertices[vertexCount];
+			Vector3 position(vertex.x, vertex.y, vertex.z);
+			Vector3 normalised = (position - minimum) * inverseExtent;
+			Vector3 decoded = minimum + Vector3(floatToUnorm16(normalised.x) / 65535.0f,
+				floatToUnorm16(normalised.y) / 65535.0f,
+				floatToUnorm16(normalised.z) / 65535.0f) * extent;
+			Vector3 difference = decoded - position;
+			positionError = std::max(positionError, static_cast<float>(std::max(Math::Abs(difference.x),
+				std::max(Math::Abs(difference.y), Math::Abs(difference.z)))));
+			++vertexCount;
+		}
+		quantization.positionError = maxExtent > 0.0f ? positionError / maxExtent : 0.0f;
+		if (quantization.positionError <= tolerance)
+		{
+			quantization.positionType = VET_USHORT4_NORM;
+			quantization.positionOffset = minimum;
+			quantization.positionScale = extent;
+		}
+
+		// Normals; octahedral encoded if there is no tangent. Normal and tangent together are already
+		// encoded as a QTangent.
+		if (subMeshData.writeNormals && !subMeshData.writeQTangents)
+		{
+			float normalError = 0.0f;
+			vertexCount = 0;
+			while (vertexCount < subMesh->mNumVertices)
+			{
+				const aiVector3D& n = subMesh->mNormals[vertexCount];
+				Vector3 normal(n.x, n.y, n.z);
+				if (normal.normalise() > 0.0f)
+				{
+					float u;
+					float v;
+					toOctahedral(normal, u, v);
+					Vector3 decoded = fromOctahedral(std::max(floatToSnorm16(u) / 32767.0f, -1.0f),
+						std::max(floatToSnorm16(v) / 32767.0f, -1.0f));
+					normalError = std::max(normalError, static_cast<float>((decoded - normal).length()));
+				}
+				++vertexCount;
+			}
+			quantization.normalError = normalError;
+			quantization.octahedralNormals = normalError <= tolerance;
+		}
+
+		// Vertex colours; unorm8. Colours outside [0, 1] exceed the tolerance and remain floats.
+		if (subMesh->HasVertexColors(0))
+		{
+			float colourError = 0.0f;
+			vertexCount = 0;
+			while (vertexCount < subMesh->mNumVertices)
+			{
+				const aiColor4D& colour = subMesh->mColors[0][vertexCount];
+				colourError = std::max(colourError, Math::Abs(floatToUnorm8(colour.r) / 255.0f - colour.r));
+				colourError = std::max(colourError, Math::Abs(floatToUnorm8(colour.g) / 255.0f - colour.g));
+				colourError = std::max(colourError, Math::Abs(floatToUnorm8(colour.b) / 255.0f - colour.b));
+				colourError = std::max(colourError, Math::Abs(floatToUnorm8(colour.a) / 255.0f - colour.a));
+				++vertexCount;
+			}
+			quantization.colourError = colourError;
+			quantization.writeColours = true;
+			quantization.colourType = colourError <= tolerance ? VET_UBYTE4_NORM : VET_FLOAT4;
+		}
+
+		// Texture coordinates; unorm16 if they are in [0, 1], otherwise halfs
+		float texCoordError = 0.0f;
+		unsigned int textureCoordSet = 0;
+		while (subMesh->HasTextureCoords(textureCoordSet))
+		{
+			bool normalised = true;
+			float unormError = 0.0f;
+			float halfError = 0.0f;
+			vertexCount = 0;
+			while (vertexCount < subMesh->mNumVertices)
+			{
+				const aiVector3D& texCoord = subMesh->mTextureCoords[textureCoordSet][vertexCount];
+				if (texCoord.x < 0.0f || texCoord.x > 1.0f || texCoord.y < 0.0f || texCoord.y > 1.0f)
+					normalised = false;
+				unormError = std::max(unormError, Math::Abs(floatToUnorm16(texCoord.x) / 65535.0f - texCoord.x));
+				unormError = std::max(unormError, Math::Abs(floatToUnorm16(texCoord.y) / 65535.0f - texCoord.y));
+				halfError = std::max(halfError, Math::Abs(Bitwise::halfToFloat(Bitwise::floatToHalf(texCoord.x)) - texCoord.x));
+				halfError = std::max(halfError, Math::Abs(Bitwise::halfToFloat(Bitwise::floatToHalf(texCoord.y)) - texCoord.y));
+				++vertexCount;
+			}
+
+			VertexElementType& texCoordType = quantization.texCoordTypes[textureCoordSet];
+			if (normalised && unormError <= tolerance)
+			{
+				texCoordType = VET_USHORT2_NORM;
+				texCoordError = std::max(texCoordError, unormError);
+			}
+			else if (halfError <= tolerance)
+			{
+				texCoordType = VET_HALF2;
+				texCoordError = std::max(texCoordError, halfError);
+			}
+			else
+			{
+				texCoordType = VET_FLOAT2;
+			}
+			++textureCoordSet;
+		}
+		quantization.texCoordError = texCoordError;
+
+		LogManager::getSingleton().logMessage("AssImpMeshBuilder: Quantization errors of " + String(subMesh->mName.C_Str()) +
+			": position " + StringConverter::toString(quantization.positionError) +
+			(quantization.positionType == VET_USHORT4_NORM ? "" : " (" + String(getFormatName(quantization.positionType)) + ")") +
+			", normal " + StringConverter::toString(quantization.normalError) +
+			(quantization.octahedralNormals || !subMeshData.writeNormals || subMeshData.writeQTangents ? "" : " (float)") +
+			", colour " + StringConverter::toString(quantization.colourError) +
+			(quantization.colourType == VET_UBYTE4_NORM ? "" : " (float)") +
+			", texture coordinates " + StringConverter::toString(quantization.texCoordError));
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMeshBuilder::packVertices(const aiMesh* subMesh,
+		const SubMeshData& subMeshData,
+		const Quantization& quantization,
+		const VertexElement2Vec& vertexElements,
+		char*& vertexData,
+		HlmsEditorPluginData* data)
+	{
+		size_t vertexSize = VaoManager::calculateVertexSize(vertexElements);
+		vertexData = static_cast<char*>(OGRE_MALLOC_SIMD(vertexSize * subMesh->mNumVertices, MEMCATEGORY_GEOMETRY));
+
+		// Dequantization is offset + value * scale, so quantization is (value - offset) / scale
+		const Vector3& positionOffset = quantization.positionOffset;
+		Vector3 positionInverseScale(quantization.positionScale.x > 0.0f ? 1.0f / quantization.positionScale.x : 0.0f,
+			quantization.positionScale.y > 0.0f ? 1.0f / quantization.positionScale.y : 0.0f,
+			quantization.positionScale.z > 0.0f ? 1.0f / quantization.positionScale.z : 0.0f);
+
+		// All elements are a multiple of 4 bytes, so the float/half/short pointers below stay aligned
+		char* dest = vertexData;
+		unsigned int vertexCount = 0;
+		while (vertexCount < subMesh->mNumVertices)
+		{
+			if (mImportProgress && vertexCount % gVerticesPerProgressUpdate == 0)
+			{
+				mImportProgress->setProgress(static_cast<float>(mNumVerticesPacked + vertexCount) /
+					static_cast<float>(mNumVerticesTotal));
+				if (mImportProgress->checkCancelled(data))
+					return false;
+			}
+
+			// Position
+			const aiVector3D& vertex = subMesh->mVertices[vertexCount];
+			mMinimum.makeFloor(Vector3(vertex.x, vertex.y, vertex.z));
+			mMaximum.makeCeil(Vector3(vertex.x, vertex.y, vertex.z));
+			if (quantization.positionType == VET_USHORT4_NORM)
+			{
+				uint16* destShort = reinterpret_cast<uint16*>(dest);
+				destShort[0] = floatToUnorm16((vertex.x - positionOffset.x) * positionInverseScale.x);
+				destShort[1] = floatToUnorm16((vertex.y - positionOffset.y) * positionInverseScale.y);
+				destShort[2] = floatToUnorm16((vertex.z - positionOffset.z) * positionInverseScale.z);
+				destShort[3] = 65535;
+				dest += 4 * sizeof(uint16);
+			}
+			else if (quantization.positionType == VET_HALF4)
+			{
+				uint16* destHalf = reinterpret_cast<uint16*>(dest);
+				destHalf[0] = Bitwise::floatToHalf(vertex.x);
+				destHalf[1] = Bitwise::floatToHalf(vertex.y);
+				destHalf[2] = Bitwise::floatToHalf(vertex.z);
+				destHalf[3] = Bitwise::floatToHalf(1.0f);
+				dest += 4 * sizeof(uint16);
+			}
+			else
+			{
+				float* destFloat = reinterpret_cast<float*>(dest);
+				destFloat[0] = vertex.x;
+				destFloat[1] = vertex.y;
+				destFloat[2] = vertex.z;
+				dest += 3 * sizeof(float);
+			}
+
+			// The w component of the tangent contains the handedness of the tangent space
+			float handedness = 1.0f;
+			if (subMeshData.writeNormals && subMeshData.writeTangents)
+			{
+				const aiVector3D& normal = subMesh->mNormals[vertexCount];
+				const aiVector3D& tangent = subMesh->mTangents[vertexCount];
+				const aiVector3D& bitangent = subMesh->mBitangents[vertexCount];
+				if (((normal ^ tangent) * bitangent) < 0.0f)
+					handedness = -1.0f;
+			}
+
+			if (subMeshData.writeQTangents)
+			{
+				// Normal and tangent, encoded as one quaternion
+				const aiVector3D& normal = subMesh->mNormals[vertexCount];
+				const aiVector3D& tangent = subMesh->mTangents[vertexCount];
+				Quaternion qTangent = toQTangent(Vector3(normal.x, normal.y, normal.z),
+					Vector3(tangent.x, tangent.y, tangent.z),
+					handedness);
+				int16* destShort = reinterpret_cast<int16*>(dest);
+				destShort[0] = floatToSnorm16(qTangent.x);
+				destShort[1] = floatToSnorm16(qTangent.y);
+				destShort[2] = floatToSnorm16(qTangent.z);
+				destShort[3] = floatToSnorm16(qTangent.w);
+				dest += 4 * sizeof(int16);
+			}
+			else
+			{
+				// Normal
+				if (subMeshData.writeNormals && quantization.octahedralNormals)
+				{
+					const aiVector3D& normal = subMesh->mNormals[vertexCount];
+					float u;
+					float v;
+					toOctahedral(Vector3(normal.x, normal.y, normal.z).normalisedCopy(), u, v);
+					int16* destShort = reinterpret_cast<int16*>(dest);
+					destShort[0] = floatToSnorm16(u);
+					destShort[1] = floatToSnorm16(v);
+					dest += 2 * sizeof(int16);
+				}
+				else if (subMeshData.writeNormals)
+				{
+					const aiVector3D& normal = subMesh->mNormals[vertexCount];
+					float* destFloat = reinterpret_cast<float*>(dest);
+					destFloat[0] = normal.x;
+					destFloat[1] = normal.y;
+					destFloat[2] = normal.z;
+					dest += 3 * sizeof(float);
+				}
+
+				// Tangent
+				if (subMeshData.writeTangents)
+				{
+					const aiVector3D& tangent = subMesh->mTangents[vertexCount];
+					float* destFloat = reinterpret_cast<float*>(dest);
+					destFloat[0] = tangent.x;
+					destFloat[1] = tangent.y;
+					destFloat[2] = tangent.z;
+					destFloat[3] = handedness;
+					dest += 4 * sizeof(float);
+				}
+			}
+
+			// Vertex colour
+			if (quantization.writeColours)
+			{
+				const aiColor4D& colour = subMesh->mColors[0][vertexCount];
+				if (quantization.colourType == VET_UBYTE4_NORM)
+				{
+					uint8* destByte = reinterpret_cast<uint8*>(dest);
+					destByte[0] = floatToUnorm8(colour.r);
+					destByte[1] = floatToUnorm8(colour.g);
+					destByte[2] = floatToUnorm8(colour.b);
+					destByte[3] = floatToUnorm8(colour.a);
+					dest += 4 * sizeof(uint8);
+				}
+				else
+				{
+					float* destFloat = reinterpret_cast<float*>(dest);
+					destFloat[0] = colour.r;
+					destFloat[1] = colour.g;
+					destFloat[2] = colour.b;
+					destFloat[3] = colour.a;
+					dest += 4 * sizeof(float);
+				}
+			}
+
+			// Texture coordinates
+			unsigned int textureCoordSet = 0;
+			while (subMesh->HasTextureCoords(textureCoordSet))
+			{
+				const aiVector3D& texCoord = subMesh->mTextureCoords[textureCoordSet][vertexCount];
+				VertexElementType texCoordType = quantization.texCoordTypes[textureCoordSet];
+				if (texCoordType == VET_USHORT2_NORM)
+				{
+					uint16* destShort = reinterpret_cast<uint16*>(dest);
+					destShort[0] = floatToUnorm16(texCoord.x);
+					destShort[1] = floatToUnorm16(texCoord.y);
+					dest += 2 * sizeof(uint16);
+				}
+				else if (texCoordType == VET_HALF2)
+				{
+					uint16* destHalf = reinterpret_cast<uint16*>(dest);
+					destHalf[0] = Bitwise::floatToHalf(texCoord.x);
+					destHalf[1] = Bitwise::floatToHalf(texCoord.y);
+					dest += 2 * sizeof(uint16);
+				}
+				else
+				{
+					float* destFloat = reinterpret_cast<float*>(dest);
+					destFloat[0] = texCoord.x;
+					destFloat[1] = texCoord.y;
+					dest += 2 * sizeof(float);
+				}
+				++textureCoordSet;
+			}
+
+			++vertexCount;
+		}
+
+		mNumVerticesPacked += subMesh->mNumVertices;
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	Quaternion AssImpMeshBuilder::toQTangent(const Vector3& normal, const Vector3& tangent, float handedness)
+	{
+		// Same encoding as OgreMeshTool; see Crytek's 'Spherical skinning with dual quaternions and QTangents'
+		Vector3 bitangent = normal.crossProduct(tangent);
+		Matrix3 tangentSpace;
+		tangentSpace.FromAxes(tangent, bitangent, normal);
+		Quaternion qTangent(tangentSpace);
+		qTangent.normalise();
+
+		// The sign of w is used for the handedness, so make sure it is positive and never 0
+		if (qTangent.w < 0.0f)
+			qTangent = -qTangent;
+		const Real bias = 1.0f / 32767.0f;
+		if (qTangent.w < bias)
+		{
+			Real normFactor = Math::Sqrt(1.0f - bias * bias);
+			qTangent.w = bias;
+			qTangent.x *= normFactor;
+			qTangent.y *= normFactor;
+			qTangent.z *= normFactor;
+		}
+
+		if (handedness < 0.0f)
+			qTangent = -qTangent;
+
+		return qTangent;
+	}
+
+	//---------------------------------------------------------------------
+	int16 AssImpMeshBuilder::floatToSnorm16(float value)
+	{
+		value = Math::Clamp(value, -1.0f, 1.0f);
+		return static_cast<int16>(value < 0.0f ? value * 32767.0f - 0.5f : value * 32767.0f + 0.5f);
+	}
+
+	//---------------------------------------------------------------------
+	uint16 AssImpMeshBuilder::floatToUnorm16(float value)
+	{
+		value = Math::Clamp(value, 0.0f, 1.0f);
+		return static_cast<uint16>(value * 65535.0f + 0.5f);
+	}
+
+	//---------------------------------------------------------------------
+	uint8 AssImpMeshBuilder::floatToUnorm8(float value)
+	{
+		value = Math::Clamp(value, 0.0f, 1.0f);
+		return static_cast<uint8>(value * 255.0f + 0.5f);
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshBuilder::toOctahedral(const Vector3& normal, float& u, float& v)
+	{
+		// Project on the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals
+		Real sum = Math::Abs(normal.x) + Math::Abs(normal.y) + Math::Abs(normal.z);
+		if (sum <= 0.0f)
+		{
+			u = 0.0f;
+			v = 0.0f;
+			return;
+		}
+
+		u = normal.x / sum;
+		v = normal.y / sum;
+		if (normal.z < 0.0f)
+		{
+			float foldedU = (1.0f - Math::Abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			v = (1.0f - Math::Abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+			u = foldedU;
+		}
+	}
+
+	//---------------------------------------------------------------------
+	Vector3 AssImpMeshBuilder::fromOctahedral(float u, float v)
+	{
+		Vector3 normal(u, v, 1.0f - Math::Abs(u) - Math::Abs(v));
+		if (normal.z < 0.0f)
+		{
+			normal.x = (1.0f - Math::Abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			normal.y = (1.0f - Math::Abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+		}
+		normal.normalise();
+		return normal;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshBuilder::packIndices(const aiMesh* subMesh,
+		SubMeshData& subMeshData)
+	{
+		// Use 16 bit indices whenever all vertices can be addressed with them
+		subMeshData.numIndices = subMesh->mNumFaces * 3;
+		if (subMesh->mNumVertices <= 0xFFFF)
+		{
+			subMeshData.indexType = IndexBufferPacked::IT_16BIT;
+			subMeshData.indexData = static_cast<char*>(OGRE_MALLOC_SIMD(sizeof(uint16) * subMeshData.numIndices,
+				MEMCATEGORY_GEOMETRY));
+			uint16* dest = reinterpret_cast<uint16*>(subMeshData.indexData);
+			unsigned int faceCount = 0;
+			while (faceCount < subMesh->mNumFaces)
+			{
+				const aiFace& face = subMesh->mFaces[faceCount];
+				*dest++ = static_cast<uint16>(face.mIndices[0]);
+				*dest++ = static_cast<uint16>(face.mIndices[1]);
+				*dest++ = static_cast<uint16>(face.mIndices[2]);
+				++faceCount;
+			}
+		}
+		else
+		{
+			subMeshData.indexType = IndexBufferPacked::IT_32BIT;
+			subMeshData.indexData = static_cast<char*>(OGRE_MALLOC_SIMD(sizeof(uint32) * subMeshData.numIndices,
+				MEMCATEGORY_GEOMETRY));
+			uint32* dest = reinterpret_cast<uint32*>(subMeshData.indexData);
+			unsigned int faceCount = 0;
+			while (faceCount < subMesh->mNumFaces)
+			{
+				const aiFace& face = subMesh->mFaces[faceCount];
+				*dest++ = face.mIndices[0];
+				*dest++ = face.mIndices[1];
+				*dest++ = face.mIndices[2];
+				++faceCount;
+			}
+		}
+	}
+
+	//---------------------------------------------------------------------
+	MeshPtr AssImpMeshBuilder::createMesh(const String& meshName,
+		const String& groupName,
+		HlmsEditorPluginData* data,
+		bool preview)
+	{
+		LogManager::getSingleton().logMessage("AssImpMeshBuilder::createMesh " + meshName + "...");
+		MeshManager& meshManager = MeshManager::getSingleton();
+
+		// A mesh with the same name may still be used by the Items of the editor, so it is not replaced;
+		// the new mesh gets a unique name instead. The name does not matter for the saved file.
+		String uniqueMeshName = meshName;
+		unsigned int suffix = 1;
+		while (!meshManager.getByName(uniqueMeshName, groupName).isNull())
+		{
+			uniqueMeshName = meshName + "/" + StringConverter::toString(suffix);
+			++suffix;
+		}
+		if (uniqueMeshName != meshName)
+			LogManager::getSingleton().logMessage("AssImpMeshBuilder::createMesh: " + meshName + " is already loaded; the new mesh is created as " + uniqueMeshName);
+
+		MeshPtr mesh;
+		try
+		{
+			mesh = meshManager.createManual(uniqueMeshName, groupName);
+			VaoManager* vaoManager = Root::getSingleton().getRenderSystem()->getVaoManager();
+			std::vector<SubMeshData>::iterator it = mSubMeshes.begin();
+			std::vector<SubMeshData>::iterator itEnd = mSubMeshes.end();
+			while (it != itEnd)
+			{
+				// The buffers keep a shadow copy and take ownership of the packed data; the preview gets
+				// its own vertices and a copy of the indices
+				char* indexData = it->indexData;
+				if (preview)
+				{
+					size_t indexSize = it->indexType == IndexBufferPacked::IT_16BIT ? sizeof(uint16) : sizeof(uint32);
+					indexData = static_cast<char*>(OGRE_MALLOC_SIMD(indexSize * it->numIndices, MEMCATEGORY_GEOMETRY));
+					memcpy(indexData, it->indexData, indexSize * it->numIndices);
+				}
+				VertexBufferPacked* vertexBuffer = vaoManager->createVertexBuffer(preview ? it->previewVertexElements : it->vertexElements,
+					it->numVertices,
+					BT_IMMUTABLE,
+					preview ? it->previewVertexData : it->vertexData,
+					true);
+				if (preview)
+					it->previewVertexData = 0;
+				else
+					it->vertexData = 0;
+				IndexBufferPacked* indexBuffer = vaoManager->createIndexBuffer(it->indexType,
+					it->numIndices,
+					BT_IMMUTABLE,
+					indexData,
+					true);
+				if (!preview)
+					it->indexData = 0;
+
+				VertexBufferPackedVec vertexBuffers;
+				vertexBuffers.push_back(vertexBuffer);
+				VertexArrayObject* vao = vaoManager->createVertexArrayObject(vertexBuffers,
+					indexBuffer,
+					OT_TRIANGLE_LIST);
+
+				SubMesh* subMesh = mesh->createSubMesh();
+				subMesh->mVao[VpNormal].push_back(vao);
+				subMesh->mVao[VpShadow].push_back(vao);
+				subMesh->setMaterialName(it->materialName);
+				++it;
+			}
+
+			// The bounds are in object space, also for quantized positions; the dequantization parameters say so as well
+			Aabb bounds = Aabb::newFromExtents(mMinimum, mMaximum);
+			mesh->_setBounds(bounds, false);
+			mesh->_setBoundingSphereRadius(bounds.getRadius());
+
+			// Position-only vertex buffers for the shadow pass (OgreMeshTool -O s)
+			if (mOptions.shadowMapBuffers)
+				mesh->prepareForShadowMapping(false);
+		}
+		catch (Exception& e)
+		{
+			data->mOutErrorText = "Could not create mesh " + meshName + ": " + e.getDescription();
+			LogManager::getSingleton().logMessage(e.getFullDescription());
+			if (!mesh.isNull())
+				meshManager.remove(mesh->getHandle());
+			clear();
+			return MeshPtr();
+		}
+
+		// The mesh itself still needs the packed data
+		if (!preview)
+			clear();
+		return mesh;
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMeshBuilder::saveMesh(const MeshPtr& mesh,
+		const String& meshFileName,
+		HlmsEditorPluginData* data)
+	{
+		if (!exportMesh(mesh, meshFileName, data))
+			return false;
+
+		// The parameters and the preview of a previous import with quantization would not match this mesh
+		if (!isQuantized())
+			std::remove(getPreviewFileName(meshFileName).c_str());
+		String quantizationFileName = getQuantizationFileName(meshFileName);
+		if (!mOptions.quantize || mQuantization.empty())
+		{
+			std::remove(quantizationFileName.c_str());
+			return true;
+		}
+
+		if (!writeQuantization(quantizationFileName, mesh->getAabb()))
+		{
+			data->mOutErrorText = "Could not write " + quantizationFileName;
+			return false;
+		}
+
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMeshBuilder::savePreviewMesh(const MeshPtr& previewMesh,
+		const String& meshFileName,
+		HlmsEditorPluginData* data)
+	{
+		return exportMesh(previewMesh, getPreviewFileName(meshFileName), data);
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMeshBuilder::exportMesh(const MeshPtr& mesh,
+		const String& meshFileName,
+		HlmsEditorPluginData* data)
+	{
+		LogManager::getSingleton().logMessage("AssImpMeshBuilder::saveMesh " + meshFileName + "...");
+		try
+		{
+			MeshSerializer meshSerializer(Root::getSingleton().getRenderSystem()->getVaoManager());
+			meshSerializer.exportMesh(mesh.get(), meshFileName);
+		}
+		catch (Exception& e)
+		{
+			data->mOutErrorText = "Could not save mesh " + meshFileName + ": " + e.getDescription();
+			LogManager::getSingleton().logMessage(e.getFullDescription());
+			return false;
+		}
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMeshBuilder::isQuantized(void) const
+	{
+		std::vector<Quantization>::const_iterator it = mQuantization.begin();
+		std::vector<Quantization>::const_iterator itEnd = mQuantization.end();
+		while (it != itEnd)
+		{
+			if (it->positionType == VET_USHORT4_NORM || it->octahedralNormals)
+				return true;
+			++it;
+		}
+		return false;
+	}
+
+	//---------------------------------------------------------------------
+	String AssImpMeshBuilder::getQuantizationFileName(const String& meshFileName)
+	{
+		String baseName = meshFileName;
+		String::size_type extension = baseName.rfind(".mesh");
+		if (extension != String::npos && extension + 5 == baseName.length())
+			baseName.erase(extension);
+		return baseName + ".quantization.json";
+	}
+
+	//---------------------------------------------------------------------
+	String AssImpMeshBuilder::getPreviewFileName(const String& meshFileName)
+	{
+		String baseName = meshFileName;
+		String::size_type extension = baseName.rfind(".mesh");
+		if (extension != String::npos && extension + 5 == baseName.length())
+			baseName.erase(extension);
+		return baseName + ".preview.mesh";
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMeshBuilder::writeQuantization(const String& quantizationFileName, const Aabb& bounds) const
+	{
+		std::ofstream file(quantizationFileName.c_str(), std::ios::out | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		// One entry per submesh, in the same order as the submeshes of the mesh
+		file << "{\n";
+		file << "    \"tolerance\": " << formatFloat(mOptions.quantizationTolerance) << ",\n";
+		file << "    \"bounds\": {\"space\": \"object\", \"minimum\": " << formatVector(bounds.getMinimum()) <<
+			", \"maximum\": " << formatVector(bounds.getMaximum()) << "},\n";
+		file << "    \"submeshes\": [";
+		std::vector<Quantization>::const_iterator it = mQuantization.begin();
+		std::vector<Quantization>::const_iterator itEnd = mQuantization.end();
+		while (it != itEnd)
+		{
+			if (it != mQuantization.begin())
+				file << ",";
+			file << "\n        {\"position\": {\"format\": \"" << getFormatName(it->positionType) << "\"" <<
+				", \"offset\": " << formatVector(it->positionOffset) <<
+				", \"scale\": " << formatVector(it->positionScale) <<
+				", \"error\": " << formatFloat(it->positionError) << "}" <<
+				", \"normal\": {\"octahedral\": " << (it->octahedralNormals ? "true" : "false") <<
+				", \"error\": " << formatFloat(it->normalError) << "}";
+			if (it->writeColours)
+			{
+				file << ", \"colour\": {\"format\": \"" << getFormatName(it->colourType) << "\"" <<
+					", \"error\": " << formatFloat(it->colourError) << "}";
+			}
+			file << ", \"texcoords\": {\"formats\": [";
+			std::vector<VertexElementType>::const_iterator itTexCoord = it->texCoordTypes.begin();
+			std::vector<VertexElementType>::const_iterator itTexCoordEnd = it->texCoordTypes.end();
+			while (itTexCoord != itTexCoordEnd)
+			{
+				if (itTexCoord != it->texCoordTypes.begin())
+					file << ", ";
+				file << "\"" << getFormatName(*itTexCoord) << "\"";
+				++itTexCoord;
+			}
+			file << "], \"error\": " << formatFloat(it->texCoordError) << "}}";
+			++it;
+		}
+		file << "\n    ]\n}\n";
+
+		file.close();
+		return !file.fail();
+	}
+}
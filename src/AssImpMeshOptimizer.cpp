@@ -0,0 +1,602 @@
+/*
+  -----------------------------------------------------------------------------
+  This source file is part of OGRE
+  (Object-oriented Graphics Rendering Engine)
+  For the latest info, see http://www.ogre3d.org/
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+  -----------------------------------------------------------------------------
+*/
+
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+#include "OgreVector3.h"
+#include "AssImpMeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace Ogre
+{
+	//---------------------------------------------------------------------
+	// Size of the vertex cache that Forsyth's scoring assumes
+	static const unsigned int gScoreCacheSize = 32;
+
+	// Constants of Forsyth's vertex score
+	static const float gCacheDecayPower = 1.5f;
+	static const float gLastTriangleScore = 0.75f;
+	static const float gValenceBoostScale = 2.0f;
+	static const float gValenceBoostPower = 0.5f;
+
+	// Remaining valences up to this value use a precalculated score
+	static const unsigned int gMaxTableValence = 64;
+
+	// Size of the FIFO cache that is simulated for the ACMR and ATVR statistics and for the overdraw clusters
+	static const unsigned int gStatisticsCacheSize = 16;
+
+	//---------------------------------------------------------------------
+	// Precalculated parts of Forsyth's vertex score
+	struct VertexScoreTable
+	{
+		float cacheScore[gScoreCacheSize];
+		float valenceScore[gMaxTableValence + 1];
+
+		VertexScoreTable(void)
+		{
+			// The vertices of the last triangle get a fixed score, so it is not reused right away
+			for (unsigned int position = 0; position < gScoreCacheSize; ++position)
+			{
+				if (position < 3)
+					cacheScore[position] = gLastTriangleScore;
+				else
+					cacheScore[position] = std::pow(1.0f - static_cast<float>(position - 3) /
+						static_cast<float>(gScoreCacheSize - 3), gCacheDecayPower);
+			}
+
+			// Vertices with few remaining triangles are boosted, so they are finished and don't linger
+			valenceScore[0] = 0.0f;
+			for (unsigned int valence = 1; valence <= gMaxTableValence; ++valence)
+				valenceScore[valence] = gValenceBoostScale * std::pow(static_cast<float>(valence), -gValenceBoostPower);
+		}
+
+		float score(int cachePosition, unsigned int remainingValence) const
+		{
+			// A vertex without remaining triangles is never a reason to pick a triangle
+			if (remainingValence == 0)
+				return -1.0f;
+
+			float vertexScore = cachePosition >= 0 ? cacheScore[cachePosition] : 0.0f;
+			if (remainingValence <= gMaxTableValence)
+				return vertexScore + valenceScore[remainingValence];
+			return vertexScore + gValenceBoostScale * std::pow(static_cast<float>(remainingValence), -gValenceBoostPower);
+		}
+	};
+
+	static const VertexScoreTable gVertexScoreTable;
+
+	//---------------------------------------------------------------------
+	// Move the per-vertex values to their new index; values may be null if the mesh does not have them
+	template <typename T>
+	static void remapVertexValues(T* values, const std::vector<unsigned int>& remap)
+	{
+		if (!values)
+			return;
+
+		std::vector<T> original(values, values + remap.size());
+		for (size_t vertex = 0; vertex < remap.size(); ++vertex)
+			values[remap[vertex]] = original[vertex];
+	}
+
+	//---------------------------------------------------------------------
+	static bool isTriangleMesh(const aiMesh* mesh)
+	{
+		if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE || !mesh->HasFaces() || !mesh->HasPositions())
+			return false;
+
+		for (unsigned int faceCount = 0; faceCount < mesh->mNumFaces; ++faceCount)
+			if (mesh->mFaces[faceCount].mNumIndices != 3)
+				return false;
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	AssImpMeshOptimizer::AssImpMeshOptimizer(void) :
+		mImportProgress(0),
+		mImportProfiler(0),
+		mMaxThreads(0),
+		mOptimizeOverdraw(false),
+		mOverdrawThreshold(1.05f),
+		mNextMesh(0),
+		mOptimizedMeshes(0)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	AssImpMeshOptimizer::~AssImpMeshOptimizer(void)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshOptimizer::setOverdrawOptimization(bool enabled, float threshold)
+	{
+		mOptimizeOverdraw = enabled;
+		mOverdrawThreshold = std::max(threshold, 1.0f);
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMeshOptimizer::optimizeScene(aiScene* scene, HlmsEditorPluginData* data)
+	{
+		Statistics skipped;
+		skipped.acmrBefore = skipped.acmrAfter = 0.0f;
+		skipped.atvrBefore = skipped.atvrAfter = 0.0f;
+		skipped.numClusters = 0;
+		skipped.optimized = false;
+		mStatistics.assign(scene->mNumMeshes, skipped);
+		mNextMesh.store(0);
+		mOptimizedMeshes.store(0);
+
+		// Each worker takes the next mesh that is not optimised yet; this thread is one of the workers
+		unsigned int numWorkers = mMaxThreads > 0 ? mMaxThreads : std::max(std::thread::hardware_concurrency(), 1u);
+		numWorkers = std::min(numWorkers, scene->mNumMeshes);
+		std::vector<std::thread> workers;
+		for (unsigned int worker = 1; worker < numWorkers; ++worker)
+			workers.push_back(std::thread(&AssImpMeshOptimizer::runWorker, this, scene));
+		runWorker(scene);
+		std::vector<std::thread>::iterator it = workers.begin();
+		std::vector<std::thread>::iterator itEnd = workers.end();
+		while (it != itEnd)
+		{
+			it->join();
+			++it;
+		}
+
+		if (mImportProgress && mImportProgress->checkCancelled(data))
+			return false;
+
+		LogManager& logManager = LogManager::getSingleton();
+		for (unsigned int meshCount = 0; meshCount < scene->mNumMeshes; ++meshCount)
+		{
+			const Statistics& statistics = mStatistics[meshCount];
+			String line = "AssImpMeshOptimizer: mesh " + StringConverter::toString(meshCount) + ": ";
+			if (statistics.optimized)
+			{
+				line += "ACMR " + StringConverter::toString(statistics.acmrBefore, 3) +
+					" -> " + StringConverter::toString(statistics.acmrAfter, 3) +
+					", ATVR " + StringConverter::toString(statistics.atvrBefore, 3) +
+					" -> " + StringConverter::toString(statistics.atvrAfter, 3);
+				if (statistics.numClusters > 0)
+					line += ", " + StringConverter::toString(statistics.numClusters) + " overdraw clusters";
+			}
+			else
+			{
+				line += "skipped; not a triangle mesh";
+			}
+			logManager.logMessage(line);
+		}
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshOptimizer::runWorker(aiScene* scene)
+	{
+		unsigned int meshCount = mNextMesh++;
+		while (meshCount < scene->mNumMeshes)
+		{
+			if (mImportProgress && mImportProgress->isCancelled())
+				return;
+
+			aiMesh* mesh = scene->mMeshes[meshCount];
+			if (isTriangleMesh(mesh))
+			{
+				AssImpImportProfiler::Scope scope(mImportProfiler, "optimizeMesh");
+				optimizeMesh(mesh, mStatistics[meshCount]);
+			}
+
+			unsigned int optimizedMeshes = ++mOptimizedMeshes;
+			if (mImportProgress)
+				mImportProgress->setProgress(static_cast<float>(optimizedMeshes) / static_cast<float>(scene->mNumMeshes));
+			meshCount = mNextMesh++;
+		}
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshOptimizer::optimizeMesh(aiMesh* mesh, Statistics& statistics) const
+	{
+		statistics.acmrBefore = calculateACMR(mesh, gStatisticsCacheSize);
+		statistics.atvrBefore = calculateATVR(mesh, gStatisticsCacheSize);
+
+		std::vector<unsigned int> indices(mesh->mNumFaces * 3);
+		for (unsigned int faceCount = 0; faceCount < mesh->mNumFaces; ++faceCount)
+		{
+			const unsigned int* faceIndices = mesh->mFaces[faceCount].mIndices;
+			std::copy(faceIndices, faceIndices + 3, indices.begin() + faceCount * 3);
+		}
+
+		optimizeVertexCache(indices, mesh->mNumVertices);
+		statistics.numClusters = mOptimizeOverdraw ? optimizeOverdraw(indices, mesh, mOverdrawThreshold) : 0;
+
+		// All faces are triangles, so the indices of the new order can be written into the existing faces
+		for (unsigned int faceCount = 0; faceCount < mesh->mNumFaces; ++faceCount)
+		{
+			unsigned int* faceIndices = mesh->mFaces[faceCount].mIndices;
+			std::copy(indices.begin() + faceCount * 3, indices.begin() + faceCount * 3 + 3, faceIndices);
+		}
+		reorderVertices(mesh);
+
+		statistics.acmrAfter = calculateACMR(mesh, gStatisticsCacheSize);
+		statistics.atvrAfter = calculateATVR(mesh, gStatisticsCacheSize);
+		statistics.optimized = true;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int numVertices)
+	{
+		size_t numTriangles = indices.size() / 3;
+		if (numTriangles == 0)
+			return;
+
+		// Triangles per vertex; the triangles that are not drawn yet are at the front of the list of a vertex
+		std::vector<unsigned int> remainingValence(numVertices, 0);
+		for (size_t index = 0; index < indices.size(); ++index)
+			++remainingValence[indices[index]];
+		std::vector<unsigned int> triangleOffsets(numVertices + 1, 0);
+		for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+			triangleOffsets[vertex + 1] = triangleOffsets[vertex] + remainingValence[vertex];
+		std::vector<unsigned int> vertexTriangles(indices.size());
+		std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t index = 0; index < indices.size(); ++index)
+			vertexTriangles[fill[indices[index]]++] = static_cast<unsigned int>(index / 3);
+
+		std::vector<int> cachePosition(numVertices, -1);
+		std::vector<float> vertexScore(numVertices);
+		for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+			vertexScore[vertex] = gVertexScoreTable.score(-1, remainingValence[vertex]);
+
+		std::vector<float> triangleScore(numTriangles);
+		std::vector<bool> triangleDrawn(numTriangles, false);
+		size_t bestTriangle = 0;
+		for (size_t triangle = 0; triangle < numTriangles; ++triangle)
+		{
+			const unsigned int* triangleIndices = &indices[triangle * 3];
+			triangleScore[triangle] = vertexScore[triangleIndices[0]] + vertexScore[triangleIndices[1]] +
+				vertexScore[triangleIndices[2]];
+			if (triangleScore[triangle] > triangleScore[bestTriangle])
+				bestTriangle = triangle;
+		}
+
+		// The cache holds the vertices of the last triangle in front of the previous cache content, so during an
+		// update it can contain three vertices more than gScoreCacheSize
+		unsigned int cache[gScoreCacheSize + 3];
+		unsigned int newCache[gScoreCacheSize + 3];
+		unsigned int cacheCount = 0;
+		std::vector<unsigned int> drawOrder;
+		drawOrder.reserve(indices.size());
+		size_t nextUndrawn = 0;
+		for (size_t drawn = 0; drawn < numTriangles; ++drawn)
+		{
+			// If no triangle in the cache has a score, continue with the first triangle that is not drawn yet
+			if (bestTriangle == numTriangles)
+			{
+				while (triangleDrawn[nextUndrawn])
+					++nextUndrawn;
+				bestTriangle = nextUndrawn;
+			}
+
+			const unsigned int* triangleIndices = &indices[bestTriangle * 3];
+			triangleDrawn[bestTriangle] = true;
+			unsigned int newCacheCount = 0;
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int vertex = triangleIndices[corner];
+				drawOrder.push_back(vertex);
+
+				// Move the triangle behind the remaining triangles of the vertex
+				unsigned int* first = &vertexTriangles[triangleOffsets[vertex]];
+				unsigned int* last = first + remainingValence[vertex] - 1;
+				unsigned int* position = std::find(first, last, static_cast<unsigned int>(bestTriangle));
+				std::swap(*position, *last);
+				--remainingValence[vertex];
+
+				// A triangle may use the same vertex more than once
+				if (std::find(newCache, newCache + newCacheCount, vertex) == newCache + newCacheCount)
+					newCache[newCacheCount++] = vertex;
+			}
+			for (unsigned int cacheIndex = 0; cacheIndex < cacheCount; ++cacheIndex)
+			{
+				unsigned int vertex = cache[cacheIndex];
+				if (std::find(newCache, newCache + newCacheCount, vertex) == newCache + newCacheCount)
+					newCache[newCacheCount++] = vertex;
+			}
+
+			// Update the scores of the vertices in the cache and of the vertices that drop out of it
+			for (unsigned int cacheIndex = 0; cacheIndex < newCacheCount; ++cacheIndex)
+			{
+				unsigned int vertex = newCache[cacheIndex];
+				cachePosition[vertex] = cacheIndex < gScoreCacheSize ? static_cast<int>(cacheIndex) : -1;
+				float score = gVertexScoreTable.score(cachePosition[vertex], remainingValence[vertex]);
+				float delta = score - vertexScore[vertex];
+				vertexScore[vertex] = score;
+				const unsigned int* triangle = &vertexTriangles[triangleOffsets[vertex]];
+				const unsigned int* triangleEnd = triangle + remainingValence[vertex];
+				while (triangle != triangleEnd)
+				{
+					triangleScore[*triangle] += delta;
+					++triangle;
+				}
+			}
+			cacheCount = std::min(newCacheCount, gScoreCacheSize);
+			std::copy(newCache, newCache + cacheCount, cache);
+
+			// The next triangle is the best one that uses a vertex in the cache
+			bestTriangle = numTriangles;
+			float bestScore = -1.0f;
+			for (unsigned int cacheIndex = 0; cacheIndex < cacheCount; ++cacheIndex)
+			{
+				unsigned int vertex = cache[cacheIndex];
+				const unsigned int* triangle = &vertexTriangles[triangleOffsets[vertex]];
+				const unsigned int* triangleEnd = triangle + remainingValence[vertex];
+				while (triangle != triangleEnd)
+				{
+					if (triangleScore[*triangle] > bestScore)
+					{
+						bestScore = triangleScore[*triangle];
+						bestTriangle = *triangle;
+					}
+					++triangle;
+				}
+			}
+		}
+
+		indices.swap(drawOrder);
+	}
+
+	//---------------------------------------------------------------------
+	unsigned int AssImpMeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices,
+		const aiMesh* mesh,
+		float threshold)
+	{
+		size_t numTriangles = indices.size() / 3;
+		if (numTriangles == 0)
+			return 0;
+
+		// Cache misses of each triangle in the cache order
+		std::vector<unsigned int> transformedAt(mesh->mNumVertices, 0);
+		std::vector<unsigned int> triangleMisses(numTriangles, 0);
+		unsigned int misses = 0;
+		for (size_t triangle = 0; triangle < numTriangles; ++triangle)
+		{
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int vertex = indices[triangle * 3 + corner];
+				if (transformedAt[vertex] == 0 || misses - transformedAt[vertex] >= gStatisticsCacheSize)
+				{
+					transformedAt[vertex] = ++misses;
+					++triangleMisses[triangle];
+				}
+			}
+		}
+
+		/* A triangle that misses all three vertices starts a new strip, so the cache order can be cut there for
+		 * free (hard boundaries). Between those, a cluster ends as soon as its ACMR, starting with an empty cache, is
+		 * within the threshold (soft boundaries); after reordering, each cluster may start with an empty cache.
+		 */
+		float maxACMR = threshold * static_cast<float>(misses) / static_cast<float>(numTriangles);
+		std::vector<size_t> clusterStarts;
+		clusterStarts.push_back(0);
+		unsigned int clusterMisses = 0;
+		misses += gStatisticsCacheSize;
+		for (size_t triangle = 0; triangle < numTriangles; ++triangle)
+		{
+			if (triangle > clusterStarts.back() && triangleMisses[triangle] == 3)
+			{
+				clusterStarts.push_back(triangle);
+				clusterMisses = 0;
+				misses += gStatisticsCacheSize;
+			}
+
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int vertex = indices[triangle * 3 + corner];
+				if (transformedAt[vertex] == 0 || misses - transformedAt[vertex] >= gStatisticsCacheSize)
+				{
+					transformedAt[vertex] = ++misses;
+					++clusterMisses;
+				}
+			}
+
+			size_t clusterSize = triangle + 1 - clusterStarts.back();
+			if (triangle + 1 < numTriangles &&
+				static_cast<float>(clusterMisses) <= maxACMR * static_cast<float>(clusterSize))
+			{
+				clusterStarts.push_back(triangle + 1);
+				clusterMisses = 0;
+				misses += gStatisticsCacheSize;
+			}
+		}
+		size_t numClusters = clusterStarts.size();
+		clusterStarts.push_back(numTriangles);
+
+		// Area weighted centroid and normal of each cluster and the centroid of the whole mesh
+		std::vector<Vector3> clusterCentroids(numClusters, Vector3::ZERO);
+		std::vector<Vector3> clusterNormals(numClusters, Vector3::ZERO);
+		Vector3 meshCentroid = Vector3::ZERO;
+		float meshArea = 0.0f;
+		for (size_t cluster = 0; cluster < numClusters; ++cluster)
+		{
+			Vector3 centroid = Vector3::ZERO;
+			Vector3 normal = Vector3::ZERO;
+			float area = 0.0f;
+			for (size_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; ++triangle)
+			{
+				const aiVector3D& p0 = mesh->mVertices[indices[triangle * 3]];
+				const aiVector3D& p1 = mesh->mVertices[indices[triangle * 3 + 1]];
+				const aiVector3D& p2 = mesh->mVertices[indices[triangle * 3 + 2]];
+				Vector3 v0(p0.x, p0.y, p0.z);
+				Vector3 v1(p1.x, p1.y, p1.z);
+				Vector3 v2(p2.x, p2.y, p2.z);
+				Vector3 triangleNormal = (v1 - v0).crossProduct(v2 - v0);
+				float triangleArea = 0.5f * triangleNormal.length();
+				centroid += (v0 + v1 + v2) * (triangleArea / 3.0f);
+				normal += triangleNormal;
+				area += triangleArea;
+			}
+
+			meshCentroid += centroid;
+			meshArea += area;
+			clusterCentroids[cluster] = area > 0.0f ? centroid / area : centroid;
+			clusterNormals[cluster] = normal;
+			clusterNormals[cluster].normalise();
+		}
+		if (meshArea > 0.0f)
+			meshCentroid /= meshArea;
+
+		/* The further a cluster lies outward in the direction it faces, the more likely it occludes other parts of
+		 * the mesh, from any point of view. Those clusters are drawn first.
+		 */
+		std::vector<std::pair<float, size_t> > clusterOrder(numClusters);
+		for (size_t cluster = 0; cluster < numClusters; ++cluster)
+		{
+			float occlusion = (clusterCentroids[cluster] - meshCentroid).dotProduct(clusterNormals[cluster]);
+			clusterOrder[cluster] = std::make_pair(-occlusion, cluster);
+		}
+		std::stable_sort(clusterOrder.begin(), clusterOrder.end());
+
+		std::vector<unsigned int> drawOrder;
+		drawOrder.reserve(indices.size());
+		for (size_t order = 0; order < numClusters; ++order)
+		{
+			size_t cluster = clusterOrder[order].second;
+			drawOrder.insert(drawOrder.end(),
+				indices.begin() + clusterStarts[cluster] * 3,
+				indices.begin() + clusterStarts[cluster + 1] * 3);
+		}
+		indices.swap(drawOrder);
+		return static_cast<unsigned int>(numClusters);
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshOptimizer::reorderVertices(aiMesh* mesh)
+	{
+		// New index of each vertex, in the order in which the triangles use them
+		const unsigned int unused = ~0u;
+		std::vector<unsigned int> remap(mesh->mNumVertices, unused);
+		unsigned int nextVertex = 0;
+		for (unsigned int faceCount = 0; faceCount < mesh->mNumFaces; ++faceCount)
+		{
+			aiFace& face = mesh->mFaces[faceCount];
+			for (unsigned int index = 0; index < face.mNumIndices; ++index)
+			{
+				unsigned int& vertex = face.mIndices[index];
+				if (remap[vertex] == unused)
+					remap[vertex] = nextVertex++;
+				vertex = remap[vertex];
+			}
+		}
+		for (unsigned int vertex = 0; vertex < mesh->mNumVertices; ++vertex)
+			if (remap[vertex] == unused)
+				remap[vertex] = nextVertex++;
+
+		remapVertexValues(mesh->mVertices, remap);
+		remapVertexValues(mesh->mNormals, remap);
+		remapVertexValues(mesh->mTangents, remap);
+		remapVertexValues(mesh->mBitangents, remap);
+		for (unsigned int set = 0; set < AI_MAX_NUMBER_OF_COLOR_SETS; ++set)
+			remapVertexValues(mesh->mColors[set], remap);
+		for (unsigned int set = 0; set < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++set)
+			remapVertexValues(mesh->mTextureCoords[set], remap);
+
+		for (unsigned int boneCount = 0; boneCount < mesh->mNumBones; ++boneCount)
+		{
+			aiBone* bone = mesh->mBones[boneCount];
+			for (unsigned int weightCount = 0; weightCount < bone->mNumWeights; ++weightCount)
+				bone->mWeights[weightCount].mVertexId = remap[bone->mWeights[weightCount].mVertexId];
+		}
+
+		// The animation meshes replace the vertices of the mesh, so they must follow the same order
+		for (unsigned int animMeshCount = 0; animMeshCount < mesh->mNumAnimMeshes; ++animMeshCount)
+		{
+			aiAnimMesh* animMesh = mesh->mAnimMeshes[animMeshCount];
+			if (animMesh->mNumVertices != mesh->mNumVertices)
+				continue;
+
+			remapVertexValues(animMesh->mVertices, remap);
+			remapVertexValues(animMesh->mNormals, remap);
+			remapVertexValues(animMesh->mTangents, remap);
+			remapVertexValues(animMesh->mBitangents, remap);
+			for (unsigned int set = 0; set < AI_MAX_NUMBER_OF_COLOR_SETS; ++set)
+				remapVertexValues(animMesh->mColors[set], remap);
+			for (unsigned int set = 0; set < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++set)
+				remapVertexValues(animMesh->mTextureCoords[set], remap);
+		}
+	}
+
+	//---------------------------------------------------------------------
+	unsigned int AssImpMeshOptimizer::countCacheMisses(const aiMesh* mesh, unsigned int cacheSize)
+	{
+		// A vertex is in the FIFO cache if fewer than cacheSize vertices were transformed after it
+		std::vector<unsigned int> transformedAt(mesh->mNumVertices, 0);
+		unsigned int misses = 0;
+		for (unsigned int faceCount = 0; faceCount < mesh->mNumFaces; ++faceCount)
+		{
+			const aiFace& face = mesh->mFaces[faceCount];
+			for (unsigned int index = 0; index < face.mNumIndices; ++index)
+			{
+				unsigned int vertex = face.mIndices[index];
+				if (transformedAt[vertex] == 0 || misses - transformedAt[vertex] >= cacheSize)
+					transformedAt[vertex] = ++misses;
+			}
+		}
+		return misses;
+	}
+
+	//---------------------------------------------------------------------
+	float AssImpMeshOptimizer::calculateACMR(const aiMesh* mesh, unsigned int cacheSize)
+	{
+		if (mesh->mNumFaces == 0)
+			return 0.0f;
+
+		return static_cast<float>(countCacheMisses(mesh, cacheSize)) / static_cast<float>(mesh->mNumFaces);
+	}
+
+	//---------------------------------------------------------------------
+	float AssImpMeshOptimizer::calculateATVR(const aiMesh* mesh, unsigned int cacheSize)
+	{
+		// Only the vertices that are used by a face can be transformed
+		std::vector<bool> used(mesh->mNumVertices, false);
+		unsigned int numUsed = 0;
+		for (unsigned int faceCount = 0; faceCount < mesh->mNumFaces; ++faceCount)
+		{
+			const aiFace& face = mesh->mFaces[faceCount];
+			for (unsigned int index = 0; index < face.mNumIndices; ++index)
+			{
+				if (!used[face.mIndices[index]])
+				{
+					used[face.mIndices[index]] = true;
+					++numUsed;
+				}
+			}
+		}
+		if (numUsed == 0)
+			return 0.0f;
+
+		return static_cast<float>(countCacheMisses(mesh, cacheSize)) / static_cast<float>(numUsed);
+	}
+}
@@ -0,0 +1,882 @@
+/*
+  -----------------------------------------------------------------------------
+  This source file is part of OGRE
+  (Object-oriented Graphics Rendering Engine)
+  For the latest info, see http://www.ogre3d.org/
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+  -----------------------------------------------------------------------------
+*/
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+#include "OgreMath.h"
+#include "AssImpMeshSimplifier.h"
+#include "AssImpMeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace Ogre
+{
+	//---------------------------------------------------------------------
+	// Weight of the quadric of a border or seam edge per unit of length; triangles are weighted by their area
+	static const double gBoundaryWeight = 10.0;
+
+	// Weight of the difference of the normals and texture coordinates in the cost of a collapse
+	static const double gAttributeWeight = 1.0;
+
+	// A collapse may not rotate the normal of a remaining triangle by more than about 75 degrees
+	static const double gMinFlipCosine = 0.25;
+
+	// At most 1/6 of the triangles are collapsed in one pass, so the cheapest collapses go first
+	static const size_t gCollapsesPerPassDivisor = 6;
+
+	// A pass only does collapses up to this factor times the cost of the collapse at the goal of the pass
+	static const double gCostLimitFactor = 1.5;
+
+	// Error of a lossless level in the pixel count conversion; it would otherwise be infinite
+	static const float gMinimumLodError = 1e-6f;
+
+	static const unsigned int gNoVertex = ~0u;
+	static const unsigned int gMultipleVertices = ~0u - 1;
+
+	//---------------------------------------------------------------------
+	enum VertexKind
+	{
+		KIND_MANIFOLD,	// Inside the surface; collapses to any neighbour
+		KIND_BORDER,	// On an open edge of the surface; only collapses along the border
+		KIND_SEAM,		// One of two vertices with the same position; both collapse together along the seam
+		KIND_LOCKED		// Corners of borders and seams and other complex vertices; never collapses
+	};
+
+	//---------------------------------------------------------------------
+	// Sum of squared distances to weighted planes: p^T A p + 2 b.p + c. Doubles, because the terms cancel.
+	struct Quadric
+	{
+		double a00, a11, a22, a01, a02, a12;
+		double b0, b1, b2;
+		double c;
+		double weight;
+
+		Quadric(void) : a00(0.0), a11(0.0), a22(0.0), a01(0.0), a02(0.0), a12(0.0), b0(0.0), b1(0.0), b2(0.0),
+			c(0.0), weight(0.0)
+		{
+		}
+
+		// The plane n.p + d = 0; the normal must have unit length
+		void addPlane(const Vector3& normal, double d, double planeWeight)
+		{
+			a00 += planeWeight * normal.x * normal.x;
+			a11 += planeWeight * normal.y * normal.y;
+			a22 += planeWeight * normal.z * normal.z;
+			a01 += planeWeight * normal.x * normal.y;
+			a02 += planeWeight * normal.x * normal.z;
+			a12 += planeWeight * normal.y * normal.z;
+			b0 += planeWeight * normal.x * d;
+			b1 += planeWeight * normal.y * d;
+			b2 += planeWeight * normal.z * d;
+			c += planeWeight * d * d;
+			weight += planeWeight;
+		}
+
+		void add(const Quadric& other)
+		{
+			a00 += other.a00;
+			a11 += other.a11;
+			a22 += other.a22;
+			a01 += other.a01;
+			a02 += other.a02;
+			a12 += other.a12;
+			b0 += other.b0;
+			b1 += other.b1;
+			b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		// Weighted mean of the squared distances of the point to the planes
+		double error(const Vector3& point) const
+		{
+			double x = point.x;
+			double y = point.y;
+			double z = point.z;
+			double sum = a00 * x * x + a11 * y * y + a22 * z * z +
+				2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+				2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+		}
+	};
+
+	//---------------------------------------------------------------------
+	// A candidate collapse of source into target; a seam vertex takes its partner along
+	struct Collapse
+	{
+		unsigned int source;
+		unsigned int target;
+		unsigned int partnerSource;
+		unsigned int partnerTarget;
+		double cost;
+		double error;
+
+		bool operator<(const Collapse& other) const {return cost < other.cost;}
+	};
+
+	//---------------------------------------------------------------------
+	static bool isTriangleMesh(const aiMesh* mesh)
+	{
+		if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE || !mesh->HasFaces() || !mesh->HasPositions())
+			return false;
+
+		for (unsigned int faceCount = 0; faceCount < mesh->mNumFaces; ++faceCount)
+			if (mesh->mFaces[faceCount].mNumIndices != 3)
+				return false;
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	static inline uint64 halfEdgeKey(unsigned int from, unsigned int to)
+	{
+		return (static_cast<uint64>(from) << 32) | to;
+	}
+
+	//---------------------------------------------------------------------
+	// The half edges of the triangles, sorted; remap maps the vertices first (e.g. to their position)
+	static void buildHalfEdges(const std::vector<unsigned int>& indices,
+		const std::vector<unsigned int>* remap,
+		std::vector<uint64>& halfEdges)
+	{
+		halfEdges.resize(indices.size());
+		for (size_t index = 0; index < indices.size(); ++index)
+		{
+			unsigned int from = indices[index];
+			unsigned int to = indices[index - index % 3 + (index + 1) % 3];
+			if (remap)
+				halfEdges[index] = halfEdgeKey((*remap)[from], (*remap)[to]);
+			else
+				halfEdges[index] = halfEdgeKey(from, to);
+		}
+		std::sort(halfEdges.begin(), halfEdges.end());
+	}
+
+	//---------------------------------------------------------------------
+	static inline bool hasHalfEdge(const std::vector<uint64>& halfEdges, unsigned int from, unsigned int to)
+	{
+		return std::binary_search(halfEdges.begin(), halfEdges.end(), halfEdgeKey(from, to));
+	}
+
+	//---------------------------------------------------------------------
+	// The state of a mesh during simplification; the levels are generated one after the other from the same state
+	class MeshSimplification
+	{
+	public:
+		MeshSimplification(const aiMesh* mesh, float scale);
+
+		/* Collapse edges until the mesh has at most targetTriangles triangles or no collapse with an error of at
+		 * most errorLimit is left. The last triangle is never collapsed. Returns false if it is cancelled.
+		 */
+		bool simplify(size_t targetTriangles, double errorLimit, const AssImpImportProgress* importProgress);
+
+		const std::vector<unsigned int>& getIndices(void) const {return mIndices;}
+		unsigned int getNumVertices(void) const {return static_cast<unsigned int>(mPositions.size());}
+		double getError(void) const {return mError;}
+
+	protected:
+		// Vertices with the same position form a ring of wedges; mPositionRemap is the first vertex of the ring
+		void buildPositionRemap(void);
+		void classifyVertices(void);
+		void buildQuadrics(void);
+
+		// One pass of non-overlapping collapses; returns the number of collapses
+		size_t collapsePass(size_t targetTriangles, double errorLimit);
+
+		// Fill the collapse if the source may be collapsed into the target along the triangle edge (from, to)
+		bool evaluateCollapse(unsigned int source, unsigned int target, bool sourceIsFrom, double errorLimit,
+			Collapse& collapse) const;
+
+		// True if moving the position of the source to the target turns a remaining triangle around
+		bool flipsTriangle(unsigned int sourcePosition, unsigned int targetPosition, const Vector3& target) const;
+
+		double attributeDistance(unsigned int vertex0, unsigned int vertex1) const;
+
+		const aiMesh* mMesh;
+		std::vector<Vector3> mPositions;		// Divided by the scale
+		std::vector<unsigned int> mIndices;
+		std::vector<unsigned int> mPositionRemap;
+		std::vector<unsigned int> mWedges;
+		std::vector<unsigned char> mKinds;
+		std::vector<Quadric> mQuadrics;			// Per position
+		double mError;
+
+		// Rebuilt by each pass
+		std::vector<uint64> mHalfEdges;
+		std::vector<uint64> mPositionHalfEdges;
+		std::vector<unsigned int> mTriangleOffsets;	// Triangles around each position
+		std::vector<unsigned int> mTriangles;
+		std::vector<unsigned int> mCollapseRemap;
+		std::vector<unsigned char> mLocked;
+	};
+
+	//---------------------------------------------------------------------
+	MeshSimplification::MeshSimplification(const aiMesh* mesh, float scale) :
+		mMesh(mesh),
+		mError(0.0)
+	{
+		unsigned int numVertices = mesh->mNumVertices;
+		mPositions.resize(numVertices);
+		for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+		{
+			const aiVector3D& position = mesh->mVertices[vertex];
+			mPositions[vertex] = Vector3(position.x / scale, position.y / scale, position.z / scale);
+		}
+
+		mIndices.resize(mesh->mNumFaces * 3);
+		for (unsigned int faceCount = 0; faceCount < mesh->mNumFaces; ++faceCount)
+		{
+			const unsigned int* faceIndices = mesh->mFaces[faceCount].mIndices;
+			std::copy(faceIndices, faceIndices + 3, mIndices.begin() + faceCount * 3);
+		}
+
+		mCollapseRemap.resize(numVertices);
+		for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+			mCollapseRemap[vertex] = vertex;
+
+		buildPositionRemap();
+		classifyVertices();
+		buildQuadrics();
+	}
+
+	//---------------------------------------------------------------------
+	void MeshSimplification::buildPositionRemap(void)
+	{
+		// Sort the vertices by position; equal positions are sorted by index, so the first one is the smallest
+		unsigned int numVertices = getNumVertices();
+		std::vector<unsigned int> order(numVertices);
+		for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+			order[vertex] = vertex;
+		const std::vector<Vector3>& positions = mPositions;
+		std::sort(order.begin(), order.end(), [&positions](unsigned int vertex0, unsigned int vertex1)
+		{
+			const Vector3& position0 = positions[vertex0];
+			const Vector3& position1 = positions[vertex1];
+			if (position0.x != position1.x)
+				return position0.x < position1.x;
+			if (position0.y != position1.y)
+				return position0.y < position1.y;
+			if (position0.z != position1.z)
+				return position0.z < position1.z;
+			return vertex0 < vertex1;
+		});
+
+		mPositionRemap.resize(numVertices);
+		mWedges.resize(numVertices);
+		size_t first = 0;
+		while (first < order.size())
+		{
+			size_t last = first + 1;
+			while (last < order.size() && mPositions[order[last]] == mPositions[order[first]])
+				++last;
+			for (size_t wedge = first; wedge < last; ++wedge)
+			{
+				mPositionRemap[order[wedge]] = order[first];
+				mWedges[order[wedge]] = order[wedge + 1 < last ? wedge + 1 : first];
+			}
+			first = last;
+		}
+	}
+
+	//---------------------------------------------------------------------
+	void MeshSimplification::classifyVertices(void)
+	{
+		buildHalfEdges(mIndices, 0, mHalfEdges);
+		buildHalfEdges(mIndices, &mPositionRemap, mPositionHalfEdges);
+
+		// The open half edges of each vertex: edges without a neighbouring triangle with the same vertices
+		unsigned int numVertices = getNumVertices();
+		std::vector<unsigned int> openOut(numVertices, gNoVertex);
+		std::vector<unsigned int> openIn(numVertices, gNoVertex);
+		for (size_t index = 0; index < mIndices.size(); ++index)
+		{
+			unsigned int from = mIndices[index];
+			unsigned int to = mIndices[index - index % 3 + (index + 1) % 3];
+			if (!hasHalfEdge(mHalfEdges, to, from))
+			{
+				openOut[from] = openOut[from] == gNoVertex ? to : gMultipleVertices;
+				openIn[to] = openIn[to] == gNoVertex ? from : gMultipleVertices;
+			}
+		}
+
+		mKinds.assign(numVertices, KIND_LOCKED);
+		for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+		{
+			if (mPositionRemap[vertex] != vertex)
+				continue;
+
+			unsigned char kind = KIND_LOCKED;
+			unsigned int wedge = mWedges[vertex];
+			if (wedge == vertex)
+			{
+				// A border is open at the position as well; otherwise it is the end of a seam
+				if (openOut[vertex] == gNoVertex && openIn[vertex] == gNoVertex)
+				{
+					kind = KIND_MANIFOLD;
+				}
+				else if (openOut[vertex] < gMultipleVertices && openIn[vertex] < gMultipleVertices &&
+					!hasHalfEdge(mPositionHalfEdges, mPositionRemap[openOut[vertex]], vertex) &&
+					!hasHalfEdge(mPositionHalfEdges, vertex, mPositionRemap[openIn[vertex]]))
+				{
+					kind = KIND_BORDER;
+				}
+			}
+			else if (mWedges[wedge] == vertex)
+			{
+				// Each open edge of one wedge continues as the opposite open edge of the other wedge
+				if (openOut[vertex] < gMultipleVertices && openIn[vertex] < gMultipleVertices &&
+					openOut[wedge] < gMultipleVertices && openIn[wedge] < gMultipleVertices &&
+					mPositionRemap[openOut[vertex]] == mPositionRemap[openIn[wedge]] &&
+					mPositionRemap[openIn[vertex]] == mPositionRemap[openOut[wedge]])
+				{
+					kind = KIND_SEAM;
+				}
+			}
+
+			unsigned int ring = vertex;
+			do
+			{
+				mKinds[ring] = kind;
+				ring = mWedges[ring];
+			}
+			while (ring != vertex);
+		}
+	}
+
+	//---------------------------------------------------------------------
+	void MeshSimplification::buildQuadrics(void)
+	{
+		// The planes of the triangles, weighted by area, and planes perpendicular to the borders and seams, so
+		// they don't move sideways
+		mQuadrics.resize(getNumVertices());
+		for (size_t triangle = 0; triangle < mIndices.size() / 3; ++triangle)
+		{
+			const unsigned int* triangleIndices = &mIndices[triangle * 3];
+			const Vector3& position0 = mPositions[triangleIndices[0]];
+			Vector3 normal = (mPositions[triangleIndices[1]] - position0).crossProduct(
+				mPositions[triangleIndices[2]] - position0);
+			Real doubleArea = normal.normalise();
+			if (doubleArea <= 0.0f)
+				continue;
+
+			double d = -normal.dotProduct(position0);
+			for (unsigned int corner = 0; corner < 3; ++corner)
+				mQuadrics[mPositionRemap[triangleIndices[corner]]].addPlane(normal, d, 0.5 * doubleArea);
+
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int from = triangleIndices[corner];
+				unsigned int to = triangleIndices[(corner + 1) % 3];
+				if (mKinds[from] == KIND_MANIFOLD || hasHalfEdge(mHalfEdges, to, from))
+					continue;
+
+				Vector3 edge = mPositions[to] - mPositions[from];
+				Real length = edge.normalise();
+				Vector3 edgeNormal = edge.crossProduct(normal);
+				if (length <= 0.0f || edgeNormal.normalise() <= 0.0f)
+					continue;
+
+				double edgeD = -edgeNormal.dotProduct(mPositions[from]);
+				mQuadrics[mPositionRemap[from]].addPlane(edgeNormal, edgeD, gBoundaryWeight * length);
+				mQuadrics[mPositionRemap[to]].addPlane(edgeNormal, edgeD, gBoundaryWeight * length);
+			}
+		}
+	}
+
+	//---------------------------------------------------------------------
+	double MeshSimplification::attributeDistance(unsigned int vertex0, unsigned int vertex1) const
+	{
+		double distance = 0.0;
+		if (mMesh->HasNormals())
+		{
+			aiVector3D difference = mMesh->mNormals[vertex0] - mMesh->mNormals[vertex1];
+			distance += difference.x * difference.x + difference.y * difference.y + difference.z * difference.z;
+		}
+		if (mMesh->HasTextureCoords(0))
+		{
+			aiVector3D difference = mMesh->mTextureCoords[0][vertex0] - mMesh->mTextureCoords[0][vertex1];
+			distance += difference.x * difference.x + difference.y * difference.y;
+		}
+		return distance;
+	}
+
+	//---------------------------------------------------------------------
+	bool MeshSimplification::evaluateCollapse(unsigned int source,
+		unsigned int target,
+		bool sourceIsFrom,
+		double errorLimit,
+		Collapse& collapse) const
+	{
+		collapse.source = source;
+		collapse.target = target;
+		collapse.partnerSource = gNoVertex;
+		collapse.partnerTarget = gNoVertex;
+		unsigned char kind = mKinds[source];
+		unsigned char targetKind = mKinds[target];
+		if (kind == KIND_LOCKED)
+			return false;
+
+		// Borders and seams only collapse along their open edges, into a vertex of the same kind or a corner
+		if (kind == KIND_BORDER || kind == KIND_SEAM)
+		{
+			if (targetKind != kind && targetKind != KIND_LOCKED)
+				return false;
+			unsigned int from = sourceIsFrom ? source : target;
+			unsigned int to = sourceIsFrom ? target : source;
+			if (hasHalfEdge(mHalfEdges, to, from))
+				return false;
+			bool positionOpen = !hasHalfEdge(mPositionHalfEdges, mPositionRemap[to], mPositionRemap[from]);
+			if (positionOpen != (kind == KIND_BORDER))
+				return false;
+		}
+
+		if (kind == KIND_SEAM)
+		{
+			// The other wedge has the opposite open edge to a wedge of the target position
+			unsigned int partner = mWedges[source];
+			unsigned int partnerTarget = mWedges[target];
+			while (partnerTarget != target)
+			{
+				bool found = sourceIsFrom ?
+					hasHalfEdge(mHalfEdges, partnerTarget, partner) && !hasHalfEdge(mHalfEdges, partner, partnerTarget) :
+					hasHalfEdge(mHalfEdges, partner, partnerTarget) && !hasHalfEdge(mHalfEdges, partnerTarget, partner);
+				if (found)
+					break;
+				partnerTarget = mWedges[partnerTarget];
+			}
+			if (partnerTarget == target)
+				return false;
+			collapse.partnerSource = partner;
+			collapse.partnerTarget = partnerTarget;
+		}
+
+		double error = mQuadrics[mPositionRemap[source]].error(mPositions[target]);
+		if (error > errorLimit * errorLimit)
+			return false;
+
+		// The attribute difference is weighted by the squared length of the edge, like the distance to the planes
+		double attributes = attributeDistance(source, target);
+		if (collapse.partnerSource != gNoVertex)
+			attributes += attributeDistance(collapse.partnerSource, collapse.partnerTarget);
+		double squaredLength = (mPositions[target] - mPositions[source]).squaredLength();
+		collapse.cost = error + gAttributeWeight * attributes * squaredLength;
+		collapse.error = std::sqrt(error);
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	bool MeshSimplification::flipsTriangle(unsigned int sourcePosition,
+		unsigned int targetPosition,
+		const Vector3& target) const
+	{
+		unsigned int triangleIndex = mTriangleOffsets[sourcePosition];
+		unsigned int triangleEnd = mTriangleOffsets[sourcePosition + 1];
+		while (triangleIndex < triangleEnd)
+		{
+			const unsigned int* triangleIndices = &mIndices[mTriangles[triangleIndex] * 3];
+			++triangleIndex;
+
+			// Triangles that contain the edge disappear
+			unsigned int corner = 0;
+			bool removed = false;
+			for (unsigned int index = 0; index < 3; ++index)
+			{
+				unsigned int position = mPositionRemap[triangleIndices[index]];
+				if (position == targetPosition)
+					removed = true;
+				else if (position == sourcePosition)
+					corner = index;
+			}
+			if (removed)
+				continue;
+
+			const Vector3& position0 = mPositions[triangleIndices[0]];
+			Vector3 before = (mPositions[triangleIndices[1]] - position0).crossProduct(
+				mPositions[triangleIndices[2]] - position0);
+			Vector3 moved[3] = {mPositions[triangleIndices[0]], mPositions[triangleIndices[1]], mPositions[triangleIndices[2]]};
+			moved[corner] = target;
+			Vector3 after = (moved[1] - moved[0]).crossProduct(moved[2] - moved[0]);
+			double cosine = before.dotProduct(after);
+			if (cosine < gMinFlipCosine * std::sqrt(static_cast<double>(before.squaredLength()) * after.squaredLength()))
+				return true;
+		}
+		return false;
+	}
+
+	//---------------------------------------------------------------------
+	size_t MeshSimplification::collapsePass(size_t targetTriangles, double errorLimit)
+	{
+		size_t numTriangles = mIndices.size() / 3;
+		unsigned int numVertices = getNumVertices();
+		buildHalfEdges(mIndices, 0, mHalfEdges);
+		buildHalfEdges(mIndices, &mPositionRemap, mPositionHalfEdges);
+
+		// Triangles around each position
+		mTriangleOffsets.assign(numVertices + 1, 0);
+		for (size_t index = 0; index < mIndices.size(); ++index)
+			++mTriangleOffsets[mPositionRemap[mIndices[index]] + 1];
+		for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+			mTriangleOffsets[vertex + 1] += mTriangleOffsets[vertex];
+		mTriangles.resize(mIndices.size());
+		std::vector<unsigned int> fill(mTriangleOffsets.begin(), mTriangleOffsets.end() - 1);
+		for (size_t index = 0; index < mIndices.size(); ++index)
+			mTriangles[fill[mPositionRemap[mIndices[index]]]++] = static_cast<unsigned int>(index / 3);
+
+		// The cheapest direction of each edge
+		std::vector<Collapse> collapses;
+		collapses.reserve(mIndices.size());
+		for (size_t index = 0; index < mIndices.size(); ++index)
+		{
+			unsigned int from = mIndices[index];
+			unsigned int to = mIndices[index - index % 3 + (index + 1) % 3];
+			if (mPositionRemap[from] == mPositionRemap[to])
+				continue;
+
+			// An edge between two triangles is only evaluated once
+			if (from > to && hasHalfEdge(mHalfEdges, to, from))
+				continue;
+
+			Collapse forward;
+			Collapse backward;
+			bool forwardValid = evaluateCollapse(from, to, true, errorLimit, forward);
+			bool backwardValid = evaluateCollapse(to, from, false, errorLimit, backward);
+			if (forwardValid && (!backwardValid || forward.cost <= backward.cost))
+				collapses.push_back(forward);
+			else if (backwardValid)
+				collapses.push_back(backward);
+		}
+		if (collapses.empty())
+			return 0;
+		std::sort(collapses.begin(), collapses.end());
+
+		// A collapse removes about two triangles
+		size_t goal = std::min((numTriangles - targetTriangles) / 2 + 1, numTriangles / gCollapsesPerPassDivisor + 1);
+		double costLimit = collapses[std::min(goal, collapses.size()) - 1].cost * gCostLimitFactor;
+
+		// The one-ring of a collapse is locked, so the collapses of a pass don't affect each other
+		mLocked.assign(numVertices, 0);
+		size_t numCollapses = 0;
+		size_t numRemoved = 0;
+		for (unsigned int attempt = 0; attempt < 2 && numCollapses == 0; ++attempt)
+		{
+			// If the collapses below the cost limit all flip triangles, try the more expensive ones as well
+			if (attempt == 1)
+				costLimit = std::numeric_limits<double>::max();
+
+			std::vector<Collapse>::const_iterator it = collapses.begin();
+			std::vector<Collapse>::const_iterator itEnd = collapses.end();
+			while (it != itEnd && it->cost <= costLimit && numCollapses < goal && numTriangles - numRemoved > targetTriangles)
+			{
+				unsigned int sourcePosition = mPositionRemap[it->source];
+				unsigned int targetPosition = mPositionRemap[it->target];
+				if (mLocked[sourcePosition] || mLocked[targetPosition] ||
+					flipsTriangle(sourcePosition, targetPosition, mPositions[it->target]))
+				{
+					++it;
+					continue;
+				}
+
+				// The triangles with both positions become degenerate; at least one triangle must be left
+				unsigned int triangleIndex = mTriangleOffsets[sourcePosition];
+				unsigned int triangleEnd = mTriangleOffsets[sourcePosition + 1];
+				size_t numCollapseRemoved = 0;
+				while (triangleIndex < triangleEnd)
+				{
+					const unsigned int* triangleIndices = &mIndices[mTriangles[triangleIndex] * 3];
+					for (unsigned int corner = 0; corner < 3; ++corner)
+					{
+						if (mPositionRemap[triangleIndices[corner]] == targetPosition)
+						{
+							++numCollapseRemoved;
+							break;
+						}
+					}
+					++triangleIndex;
+				}
+				if (numRemoved + numCollapseRemoved >= numTriangles)
+				{
+					++it;
+					continue;
+				}
+
+				mCollapseRemap[it->source] = it->target;
+				if (it->partnerSource != gNoVertex)
+					mCollapseRemap[it->partnerSource] = it->partnerTarget;
+				mQuadrics[targetPosition].add(mQuadrics[sourcePosition]);
+				mError = std::max(mError, it->error);
+
+				triangleIndex = mTriangleOffsets[sourcePosition];
+				while (triangleIndex < triangleEnd)
+				{
+					const unsigned int* triangleIndices = &mIndices[mTriangles[triangleIndex] * 3];
+					for (unsigned int corner = 0; corner < 3; ++corner)
+						mLocked[mPositionRemap[triangleIndices[corner]]] = 1;
+					++triangleIndex;
+				}
+				numRemoved += numCollapseRemoved;
+
+				++numCollapses;
+				++it;
+			}
+		}
+
+		// Apply the collapses and remove the triangles that became degenerate
+		size_t numKept = 0;
+		for (size_t triangle = 0; triangle < numTriangles; ++triangle)
+		{
+			unsigned int index0 = mCollapseRemap[mIndices[triangle * 3]];
+			unsigned int index1 = mCollapseRemap[mIndices[triangle * 3 + 1]];
+			unsigned int index2 = mCollapseRemap[mIndices[triangle * 3 + 2]];
+			unsigned int position0 = mPositionRemap[index0];
+			unsigned int position1 = mPositionRemap[index1];
+			unsigned int position2 = mPositionRemap[index2];
+			if (position0 == position1 || position1 == position2 || position0 == position2)
+				continue;
+
+			mIndices[numKept * 3] = index0;
+			mIndices[numKept * 3 + 1] = index1;
+			mIndices[numKept * 3 + 2] = index2;
+			++numKept;
+		}
+		mIndices.resize(numKept * 3);
+		return numCollapses;
+	}
+
+	//---------------------------------------------------------------------
+	bool MeshSimplification::simplify(size_t targetTriangles,
+		double errorLimit,
+		const AssImpImportProgress* importProgress)
+	{
+		while (mIndices.size() / 3 > targetTriangles)
+		{
+			if (importProgress && importProgress->isCancelled())
+				return false;
+			if (collapsePass(targetTriangles, errorLimit) == 0)
+				break;
+		}
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	AssImpMeshSimplifier::AssImpMeshSimplifier(void) :
+		mImportProgress(0),
+		mImportProfiler(0),
+		mMaxThreads(0),
+		mTargetType(TARGET_TRIANGLE_RATIO),
+		mNextMesh(0),
+		mSimplifiedMeshes(0)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	AssImpMeshSimplifier::~AssImpMeshSimplifier(void)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMeshSimplifier::setTargets(TargetType type, const std::vector<float>& targets)
+	{
+		for (size_t level = 0; level < targets.size(); ++level)
+		{
+			if (targets[level] <= 0.0f || (type == TARGET_TRIANGLE_RATIO && targets[level] >= 1.0f))
+				return false;
+			if (level > 0 && (type == TARGET_TRIANGLE_RATIO ? targets[level] >= targets[level - 1] :
+				targets[level] <= targets[level - 1]))
+				return false;
+		}
+
+		mTargetType = type;
+		mTargets = targets;
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshSimplifier::clear(void)
+	{
+		mLodLevels.clear();
+		mLodErrors.clear();
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpMeshSimplifier::simplifyScene(const aiScene* scene, HlmsEditorPluginData* data)
+	{
+		clear();
+		if (mTargets.empty() || scene->mNumMeshes == 0)
+			return true;
+
+		// All submeshes must have the same levels, so one mesh that cannot be simplified disables them all
+		LogManager& logManager = LogManager::getSingleton();
+		for (unsigned int meshCount = 0; meshCount < scene->mNumMeshes; ++meshCount)
+		{
+			if (!isTriangleMesh(scene->mMeshes[meshCount]))
+			{
+				logManager.logMessage("AssImpMeshSimplifier: mesh " + StringConverter::toString(meshCount) +
+					" is not a triangle mesh; no levels of detail are generated");
+				return true;
+			}
+		}
+
+		// The errors are relative to the bounding radius around the origin, like the bounding radius of the Ogre mesh
+		Real radius = 0.0f;
+		for (unsigned int meshCount = 0; meshCount < scene->mNumMeshes; ++meshCount)
+		{
+			const aiMesh* mesh = scene->mMeshes[meshCount];
+			for (unsigned int vertex = 0; vertex < mesh->mNumVertices; ++vertex)
+				radius = std::max(radius, static_cast<Real>(mesh->mVertices[vertex].SquareLength()));
+		}
+		radius = radius > 0.0f ? Math::Sqrt(radius) : 1.0f;
+
+		// Each worker takes the next mesh that is not simplified yet; this thread is one of the workers
+		mLodLevels.resize(scene->mNumMeshes);
+		mNextMesh.store(0);
+		mSimplifiedMeshes.store(0);
+		unsigned int numWorkers = mMaxThreads > 0 ? mMaxThreads : std::max(std::thread::hardware_concurrency(), 1u);
+		numWorkers = std::min(numWorkers, scene->mNumMeshes);
+		std::vector<std::thread> workers;
+		for (unsigned int worker = 1; worker < numWorkers; ++worker)
+			workers.push_back(std::thread(&AssImpMeshSimplifier::runWorker, this, scene, radius));
+		runWorker(scene, radius);
+		std::vector<std::thread>::iterator it = workers.begin();
+		std::vector<std::thread>::iterator itEnd = workers.end();
+		while (it != itEnd)
+		{
+			it->join();
+			++it;
+		}
+
+		if (mImportProgress && mImportProgress->checkCancelled(data))
+		{
+			clear();
+			return false;
+		}
+
+		// The chain ends at the first level that removes no triangle of any mesh; it would only repeat the previous one
+		size_t numLevels = 0;
+		while (numLevels < mTargets.size())
+		{
+			bool progress = false;
+			for (unsigned int meshCount = 0; meshCount < scene->mNumMeshes && !progress; ++meshCount)
+			{
+				const std::vector<LodLevel>& lodLevels = mLodLevels[meshCount];
+				size_t previousTriangles = numLevels > 0 ? lodLevels[numLevels - 1].indices.size() / 3 :
+					scene->mMeshes[meshCount]->mNumFaces;
+				progress = lodLevels[numLevels].indices.size() / 3 < previousTriangles;
+			}
+			if (!progress)
+				break;
+			++numLevels;
+		}
+		if (numLevels < mTargets.size())
+		{
+			logManager.logMessage("AssImpMeshSimplifier: only " + StringConverter::toString(numLevels) + " of " +
+				StringConverter::toString(mTargets.size()) + " levels of detail remove triangles; the others are dropped");
+			for (unsigned int meshCount = 0; meshCount < scene->mNumMeshes; ++meshCount)
+				mLodLevels[meshCount].resize(numLevels);
+		}
+
+		mLodErrors.assign(numLevels, 0.0f);
+		for (unsigned int meshCount = 0; meshCount < scene->mNumMeshes; ++meshCount)
+		{
+			const std::vector<LodLevel>& lodLevels = mLodLevels[meshCount];
+			String line = "AssImpMeshSimplifier: mesh " + StringConverter::toString(meshCount) + ": " +
+				StringConverter::toString(scene->mMeshes[meshCount]->mNumFaces) + " triangles";
+			for (size_t level = 0; level < lodLevels.size(); ++level)
+			{
+				mLodErrors[level] = std::max(mLodErrors[level], lodLevels[level].error);
+				line += " -> " + StringConverter::toString(lodLevels[level].indices.size() / 3) +
+					" (error " + StringConverter::toString(lodLevels[level].error) + ")";
+			}
+			logManager.logMessage(line);
+		}
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshSimplifier::runWorker(const aiScene* scene, float scale)
+	{
+		unsigned int meshCount = mNextMesh++;
+		while (meshCount < scene->mNumMeshes)
+		{
+			if (mImportProgress && mImportProgress->isCancelled())
+				return;
+
+			{
+				AssImpImportProfiler::Scope scope(mImportProfiler, "simplifyMesh");
+				simplifyMesh(scene->mMeshes[meshCount], scale, mLodLevels[meshCount]);
+			}
+
+			unsigned int simplifiedMeshes = ++mSimplifiedMeshes;
+			if (mImportProgress)
+				mImportProgress->setProgress(static_cast<float>(simplifiedMeshes) / static_cast<float>(scene->mNumMeshes));
+			meshCount = mNextMesh++;
+		}
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshSimplifier::simplifyMesh(const aiMesh* mesh, float scale, std::vector<LodLevel>& lodLevels) const
+	{
+		// Each level continues with the state of the previous one, so the errors only increase
+		MeshSimplification simplification(mesh, scale);
+		lodLevels.resize(mTargets.size());
+		for (size_t level = 0; level < mTargets.size(); ++level)
+		{
+			size_t targetTriangles = 1;
+			double errorLimit = std::numeric_limits<double>::max();
+			if (mTargetType == TARGET_TRIANGLE_RATIO)
+				targetTriangles = std::max(static_cast<size_t>(mTargets[level] * static_cast<float>(mesh->mNumFaces)), size_t(1));
+			else
+				errorLimit = mTargets[level];
+			if (!simplification.simplify(targetTriangles, errorLimit, mImportProgress))
+				return;
+
+			LodLevel& lodLevel = lodLevels[level];
+			lodLevel.indices = simplification.getIndices();
+			lodLevel.error = static_cast<float>(simplification.getError());
+			AssImpMeshOptimizer::optimizeVertexCache(lodLevel.indices, simplification.getNumVertices());
+		}
+	}
+
+	//---------------------------------------------------------------------
+	std::vector<float> AssImpMeshSimplifier::calculateLodPixelCounts(float pixelError) const
+	{
+		/* A level with error e (relative to the bounding radius r) is used while e * r, projected, is at most
+		 * pixelError pixels; so while the projected radius is at most pixelError / e pixels, which is a projected
+		 * area of pi * (pixelError / e)^2. The counts must decrease from level to level.
+		 */
+		std::vector<float> pixelCounts;
+		float previousPixelCount = std::numeric_limits<float>::max();
+		for (size_t level = 0; level < mLodErrors.size(); ++level)
+		{
+			float projectedRadius = pixelError / std::max(mLodErrors[level], gMinimumLodError);
+			float pixelCount = std::min(Math::PI * projectedRadius * projectedRadius, previousPixelCount);
+			pixelCounts.push_back(pixelCount);
+			previousPixelCount = pixelCount;
+		}
+		return pixelCounts;
+	}
+}
@@ -0,0 +1,315 @@
+/*
+  -----------------------------------------------------------------------------
+  This source file is part of OGRE
+  (Object-oriented Graphics Rendering Engine)
+  For the latest info, see http://www.ogre3d.org/
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+  -----------------------------------------------------------------------------
+*/
+
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+#include "AssImpMeshSplitter.h"
+#include <algorithm>
+
+namespace Ogre
+{
+	//---------------------------------------------------------------------
+	// Index of a vertex that is not in the current part
+	static const unsigned int gNotInPart = ~0u;
+
+	// Number of bits per axis of the Morton code of a triangle
+	static const unsigned int gMortonBits = 10;
+
+	//---------------------------------------------------------------------
+	// Copy the values of the vertices of a part; values may be null if the mesh does not have them
+	template <typename T>
+	static T* copyPartValues(const T* values, const std::vector<unsigned int>& vertices)
+	{
+		if (!values)
+			return 0;
+
+		T* partValues = new T[vertices.size()];
+		for (size_t vertex = 0; vertex < vertices.size(); ++vertex)
+			partValues[vertex] = values[vertices[vertex]];
+		return partValues;
+	}
+
+	//---------------------------------------------------------------------
+	AssImpMeshSplitter::AssImpMeshSplitter(unsigned int maxVertices) :
+		mMaxVertices(std::max(maxVertices, 3u))
+	{
+	}
+
+	//---------------------------------------------------------------------
+	AssImpMeshSplitter::~AssImpMeshSplitter(void)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	unsigned int AssImpMeshSplitter::splitScene(aiScene* scene)
+	{
+		std::vector<aiMesh*> meshes;
+		std::vector<unsigned int> firstNewMesh(scene->mNumMeshes);
+		std::vector<unsigned int> numNewMeshes(scene->mNumMeshes);
+		unsigned int numSplit = 0;
+		LogManager& logManager = LogManager::getSingleton();
+		for (unsigned int meshCount = 0; meshCount < scene->mNumMeshes; ++meshCount)
+		{
+			aiMesh* mesh = scene->mMeshes[meshCount];
+			firstNewMesh[meshCount] = static_cast<unsigned int>(meshes.size());
+			bool split = mesh->mNumVertices > mMaxVertices &&
+				mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE &&
+				mesh->HasFaces() && mesh->HasPositions();
+			if (split && mesh->mNumAnimMeshes > 0)
+			{
+				logManager.logMessage("AssImpMeshSplitter: mesh " + StringConverter::toString(meshCount) +
+					" has animation meshes; not split");
+				split = false;
+			}
+
+			if (split)
+			{
+				splitMesh(mesh, meshes);
+				logManager.logMessage("AssImpMeshSplitter: mesh " + StringConverter::toString(meshCount) + " with " +
+					StringConverter::toString(mesh->mNumVertices) + " vertices split into " +
+					StringConverter::toString(meshes.size() - firstNewMesh[meshCount]) + " submeshes");
+				delete mesh;
+				++numSplit;
+			}
+			else
+			{
+				meshes.push_back(mesh);
+			}
+			numNewMeshes[meshCount] = static_cast<unsigned int>(meshes.size()) - firstNewMesh[meshCount];
+		}
+
+		if (numSplit == 0)
+			return 0;
+
+		// The scene owns the array of meshes and deletes it with delete[]
+		delete [] scene->mMeshes;
+		scene->mNumMeshes = static_cast<unsigned int>(meshes.size());
+		scene->mMeshes = new aiMesh*[meshes.size()];
+		std::copy(meshes.begin(), meshes.end(), scene->mMeshes);
+		if (scene->mRootNode)
+			remapNodeMeshes(scene->mRootNode, firstNewMesh, numNewMeshes);
+		return numSplit;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshSplitter::splitMesh(const aiMesh* mesh, std::vector<aiMesh*>& parts) const
+	{
+		// Bounds of the mesh; the Morton codes are relative to them
+		aiVector3D minimum = mesh->mVertices[0];
+		aiVector3D maximum = mesh->mVertices[0];
+		for (unsigned int vertex = 1; vertex < mesh->mNumVertices; ++vertex)
+		{
+			const aiVector3D& position = mesh->mVertices[vertex];
+			minimum.x = std::min(minimum.x, position.x);
+			minimum.y = std::min(minimum.y, position.y);
+			minimum.z = std::min(minimum.z, position.z);
+			maximum.x = std::max(maximum.x, position.x);
+			maximum.y = std::max(maximum.y, position.y);
+			maximum.z = std::max(maximum.z, position.z);
+		}
+		const float maxCoordinate = static_cast<float>((1u << gMortonBits) - 1);
+		float scaleX = maximum.x > minimum.x ? maxCoordinate / (maximum.x - minimum.x) : 0.0f;
+		float scaleY = maximum.y > minimum.y ? maxCoordinate / (maximum.y - minimum.y) : 0.0f;
+		float scaleZ = maximum.z > minimum.z ? maxCoordinate / (maximum.z - minimum.z) : 0.0f;
+
+		// The triangles in the Morton order of their centroids; neighbouring triangles end up in the same part
+		std::vector<std::pair<uint32, unsigned int> > faceOrder(mesh->mNumFaces);
+		for (unsigned int faceCount = 0; faceCount < mesh->mNumFaces; ++faceCount)
+		{
+			const aiFace& face = mesh->mFaces[faceCount];
+			float x = 0.0f;
+			float y = 0.0f;
+			float z = 0.0f;
+			for (unsigned int index = 0; index < face.mNumIndices; ++index)
+			{
+				const aiVector3D& position = mesh->mVertices[face.mIndices[index]];
+				x += position.x;
+				y += position.y;
+				z += position.z;
+			}
+			float scale = face.mNumIndices > 0 ? 1.0f / static_cast<float>(face.mNumIndices) : 0.0f;
+			uint32 mortonX = static_cast<uint32>((x * scale - minimum.x) * scaleX + 0.5f);
+			uint32 mortonY = static_cast<uint32>((y * scale - minimum.y) * scaleY + 0.5f);
+			uint32 mortonZ = static_cast<uint32>((z * scale - minimum.z) * scaleZ + 0.5f);
+			faceOrder[faceCount] = std::make_pair(mortonCode(mortonX, mortonY, mortonZ), faceCount);
+		}
+		std::sort(faceOrder.begin(), faceOrder.end());
+
+		// Fill each part with the next triangles until the next one does not fit anymore
+		std::vector<unsigned int> partVertex(mesh->mNumVertices, gNotInPart);
+		std::vector<unsigned int> vertices;
+		std::vector<unsigned int> faces;
+		for (size_t order = 0; order < faceOrder.size(); ++order)
+		{
+			const aiFace& face = mesh->mFaces[faceOrder[order].second];
+			unsigned int newVertices = 0;
+			for (unsigned int index = 0; index < face.mNumIndices; ++index)
+			{
+				unsigned int vertex = face.mIndices[index];
+				if (partVertex[vertex] == gNotInPart &&
+					std::find(face.mIndices, face.mIndices + index, vertex) == face.mIndices + index)
+					++newVertices;
+			}
+
+			if (vertices.size() + newVertices > mMaxVertices)
+			{
+				parts.push_back(createPart(mesh, faces, vertices, partVertex));
+				for (size_t vertex = 0; vertex < vertices.size(); ++vertex)
+					partVertex[vertices[vertex]] = gNotInPart;
+				vertices.clear();
+				faces.clear();
+			}
+
+			for (unsigned int index = 0; index < face.mNumIndices; ++index)
+			{
+				unsigned int vertex = face.mIndices[index];
+				if (partVertex[vertex] == gNotInPart)
+				{
+					partVertex[vertex] = static_cast<unsigned int>(vertices.size());
+					vertices.push_back(vertex);
+				}
+			}
+			faces.push_back(faceOrder[order].second);
+		}
+		if (!faces.empty())
+			parts.push_back(createPart(mesh, faces, vertices, partVertex));
+	}
+
+	//---------------------------------------------------------------------
+	aiMesh* AssImpMeshSplitter::createPart(const aiMesh* mesh,
+		const std::vector<unsigned int>& faces,
+		const std::vector<unsigned int>& vertices,
+		const std::vector<unsigned int>& partVertex) const
+	{
+		// The part is deleted by the scene, so everything is allocated the way assimp allocates it
+		aiMesh* part = new aiMesh();
+		part->mPrimitiveTypes = mesh->mPrimitiveTypes;
+		part->mMaterialIndex = mesh->mMaterialIndex;
+		part->mName = mesh->mName;
+		part->mNumVertices = static_cast<unsigned int>(vertices.size());
+		part->mVertices = copyPartValues(mesh->mVertices, vertices);
+		part->mNormals = copyPartValues(mesh->mNormals, vertices);
+		part->mTangents = copyPartValues(mesh->mTangents, vertices);
+		part->mBitangents = copyPartValues(mesh->mBitangents, vertices);
+		for (unsigned int set = 0; set < AI_MAX_NUMBER_OF_COLOR_SETS; ++set)
+			part->mColors[set] = copyPartValues(mesh->mColors[set], vertices);
+		for (unsigned int set = 0; set < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++set)
+		{
+			part->mTextureCoords[set] = copyPartValues(mesh->mTextureCoords[set], vertices);
+			part->mNumUVComponents[set] = mesh->mNumUVComponents[set];
+		}
+
+		part->mNumFaces = static_cast<unsigned int>(faces.size());
+		part->mFaces = new aiFace[faces.size()];
+		for (size_t faceCount = 0; faceCount < faces.size(); ++faceCount)
+		{
+			const aiFace& face = mesh->mFaces[faces[faceCount]];
+			aiFace& partFace = part->mFaces[faceCount];
+			partFace.mNumIndices = face.mNumIndices;
+			partFace.mIndices = new unsigned int[face.mNumIndices];
+			for (unsigned int index = 0; index < face.mNumIndices; ++index)
+				partFace.mIndices[index] = partVertex[face.mIndices[index]];
+		}
+
+		// Only the bones that influence a vertex of the part are kept
+		std::vector<aiBone*> bones;
+		for (unsigned int boneCount = 0; boneCount < mesh->mNumBones; ++boneCount)
+		{
+			const aiBone* bone = mesh->mBones[boneCount];
+			std::vector<aiVertexWeight> weights;
+			for (unsigned int weightCount = 0; weightCount < bone->mNumWeights; ++weightCount)
+			{
+				aiVertexWeight weight = bone->mWeights[weightCount];
+				if (weight.mVertexId < partVertex.size() && partVertex[weight.mVertexId] != gNotInPart)
+				{
+					weight.mVertexId = partVertex[weight.mVertexId];
+					weights.push_back(weight);
+				}
+			}
+			if (weights.empty())
+				continue;
+
+			aiBone* partBone = new aiBone();
+			partBone->mName = bone->mName;
+			partBone->mOffsetMatrix = bone->mOffsetMatrix;
+			partBone->mNumWeights = static_cast<unsigned int>(weights.size());
+			partBone->mWeights = new aiVertexWeight[weights.size()];
+			std::copy(weights.begin(), weights.end(), partBone->mWeights);
+			bones.push_back(partBone);
+		}
+		if (!bones.empty())
+		{
+			part->mNumBones = static_cast<unsigned int>(bones.size());
+			part->mBones = new aiBone*[bones.size()];
+			std::copy(bones.begin(), bones.end(), part->mBones);
+		}
+		return part;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpMeshSplitter::remapNodeMeshes(aiNode* node,
+		const std::vector<unsigned int>& firstNewMesh,
+		const std::vector<unsigned int>& numNewMeshes)
+	{
+		if (node->mNumMeshes > 0)
+		{
+			std::vector<unsigned int> meshes;
+			for (unsigned int meshCount = 0; meshCount < node->mNumMeshes; ++meshCount)
+			{
+				unsigned int mesh = node->mMeshes[meshCount];
+				for (unsigned int newMesh = 0; newMesh < numNewMeshes[mesh]; ++newMesh)
+					meshes.push_back(firstNewMesh[mesh] + newMesh);
+			}
+
+			delete [] node->mMeshes;
+			node->mNumMeshes = static_cast<unsigned int>(meshes.size());
+			node->mMeshes = new unsigned int[meshes.size()];
+			std::copy(meshes.begin(), meshes.end(), node->mMeshes);
+		}
+
+		for (unsigned int childCount = 0; childCount < node->mNumChildren; ++childCount)
+			remapNodeMeshes(node->mChildren[childCount], firstNewMesh, numNewMeshes);
+	}
+
+	//---------------------------------------------------------------------
+	uint32 AssImpMeshSplitter::mortonCode(uint32 x, uint32 y, uint32 z)
+	{
+		// Spread the 10 bits of each coordinate, so there are two zero bits between two bits
+		uint32 coordinates[3] = {x, y, z};
+		for (unsigned int axis = 0; axis < 3; ++axis)
+		{
+			uint32 value = std::min(coordinates[axis], (1u << gMortonBits) - 1);
+			value = (value | (value << 16)) & 0x030000FF;
+			value = (value | (value << 8)) & 0x0300F00F;
+			value = (value | (value << 4)) & 0x030C30C3;
+			value = (value | (value << 2)) & 0x09249249;
+			coordinates[axis] = value;
+		}
+		return coordinates[0] | (coordinates[1] << 1) | (coordinates[2] << 2);
+	}
+}
@@ -32,20 +32,64 @@ Copyright (c) 2000-2014 Torus Knot Software Ltd
 #include "OgreLogManager.h"
 #include "OgreMeshManager.h"
 #include "OgreMeshManager2.h"
+#include "OgreString.h"
+#include "OgreStringConverter.h"
 #include "OgreMesh2.h"
+#include "OgreWindowEventUtilities.h"
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include "XmlMeshSerializer.h"
+#include "AssImpMeshBuilder.h"
+#include "AssImpPluginProperties.h"
+#include "AssImpImportCache.h"
+#include "AssImpMappedIOSystem.h"
+#include "AssImpMeshOptimizer.h"
+#include "AssImpMeshSplitter.h"
+#include "AssImpMeshSimplifier.h"
+#include <set>
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
 
 namespace Ogre
 {
 	static const String gImportMenuText = "Import 3D models";
 	static const String gExportMenuText = "";
+	static const String gImportCacheDir = "AssImpCache/";
+	static const uint64 gImportCacheMaxSize = 512 * 1024 * 1024;
+	static const size_t gBatchJobsAheadPerWorker = 2;
+
+	// Prefix of the meshes that are only created to be saved; the editor never uses these names
+	static const String gSavedMeshPrefix = "AssImpPlugin/";
+
+	// The batch import pattern matches file names like the file system does
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+	static const bool gCaseSensitiveFileNames = false;
+#else
+	static const bool gCaseSensitiveFileNames = true;
+#endif
+
+	// Interval in which the calling thread pumps the window messages while an import runs
+	static const std::chrono::milliseconds gPumpInterval(15);
 	//---------------------------------------------------------------------
-	AssImpPlugin::AssImpPlugin()
+	AssImpPlugin::AssImpPlugin() :
+		mImportRunning(false),
+		mImportStarted(false),
+		mImportResult(false),
+		mBatchImportRunning(false)
     {
     }
 	//---------------------------------------------------------------------
+	AssImpPlugin::~AssImpPlugin()
+	{
+		// Don't leave a running import behind
+		if (mImportThread.joinable())
+		{
+			cancelImport();
+			mImportThread.join();
+		}
+	}
+	//---------------------------------------------------------------------
     const String& AssImpPlugin::getName() const
     {
         return GENERAL_HLMS_PLUGIN_NAME;
@@ -119,7 +163,7 @@ namespace Ogre
 		HlmsEditorPluginData::PLUGIN_PROPERTY property;
 		property.propertyName = "generate_tangents";
 		property.labelName = "Generate tangents";
-		property.info = "";
+		property.info = "Let OgreMeshTool recalculate the tangents when importing via xml. The tangents calculated by assimp are always written, by both import paths";
 		property.type = HlmsEditorPluginData::BOOL;
 		property.boolValue = false;
 		mProperties[property.propertyName] = property;
@@ -140,6 +184,133 @@ namespace Ogre
 		property.boolValue = true;
 		mProperties[property.propertyName] = property;
 
+		// Precision of floats in the xml file
+		property.propertyName = "xml_float_precision";
+		property.labelName = "Xml float precision";
+		property.info = "Number of significant digits of floats in the Ogre xml file; 0 means full precision";
+		property.type = HlmsEditorPluginData::INT;
+		property.intValue = 0;
+		mProperties[property.propertyName] = property;
+
+		// Use the import cache
+		property.propertyName = "use_import_cache";
+		property.labelName = "Use import cache";
+		property.info = "Reuse the mesh of a previous import if the file and the settings did not change";
+		property.type = HlmsEditorPluginData::BOOL;
+		property.boolValue = true;
+		mProperties[property.propertyName] = property;
+
+		// Batch import
+		property.propertyName = "batch_import_pattern";
+		property.labelName = "Batch import pattern";
+		property.info = "Import all files in the directory of the selected file that match this pattern, e.g. *.fbx;*.obj. Leave empty to import only the selected file";
+		property.type = HlmsEditorPluginData::STRING;
+		property.stringValue = "";
+		mProperties[property.propertyName] = property;
+
+		property.propertyName = "batch_import_threads";
+		property.labelName = "Batch import threads";
+		property.info = "Number of files that are imported at the same time; 0 means one per core";
+		property.type = HlmsEditorPluginData::INT;
+		property.intValue = 0;
+		mProperties[property.propertyName] = property;
+
+		// Import report
+		property.propertyName = "write_import_report";
+		property.labelName = "Write import report";
+		property.info = "Write the timings of the import stages to <name>.import.json in the import directory";
+		property.type = HlmsEditorPluginData::BOOL;
+		property.boolValue = false;
+		mProperties[property.propertyName] = property;
+
+		// Optimize vertex cache
+		property.propertyName = "optimize_vertex_cache";
+		property.labelName = "Optimize vertex cache";
+		property.info = "Reorder the triangles and vertices of each submesh for the vertex cache of the GPU, instead of assimp's own 'improve cache locality' step";
+		property.type = HlmsEditorPluginData::BOOL;
+		property.boolValue = false;
+		mProperties[property.propertyName] = property;
+
+		// Optimize overdraw
+		property.propertyName = "optimize_overdraw";
+		property.labelName = "Optimize overdraw";
+		property.info = "Draw the outer parts of each submesh first, so less of the geometry behind them is shaded; needs 'Optimize vertex cache'";
+		property.type = HlmsEditorPluginData::BOOL;
+		property.boolValue = false;
+		mProperties[property.propertyName] = property;
+
+		// Overdraw threshold
+		property.propertyName = "overdraw_threshold";
+		property.labelName = "Overdraw threshold";
+		property.info = "Vertex cache efficiency that may be traded for less overdraw; 1.05 allows 5% more transformed vertices";
+		property.type = HlmsEditorPluginData::FLOAT;
+		property.floatValue = 1.05f;
+		mProperties[property.propertyName] = property;
+
+		// Split large submeshes
+		property.propertyName = "split_large_submeshes";
+		property.labelName = "Split large submeshes";
+		property.info = "Split submeshes with more than 65535 vertices into spatially coherent submeshes that use 16 bit indices";
+		property.type = HlmsEditorPluginData::BOOL;
+		property.boolValue = false;
+		mProperties[property.propertyName] = property;
+
+		// Quantize vertices
+		property.propertyName = "quantize_vertices";
+		property.labelName = "Quantize vertices";
+		property.info = "Use compact vertex formats (unorm16 positions, octahedral normals, unorm16/half texture coordinates, unorm8 colours). The shader must dequantize the positions with the parameters in <name>.quantization.json. The editor shows <name>.preview.mesh, which is not quantized";
+		property.type = HlmsEditorPluginData::BOOL;
+		property.boolValue = false;
+		mProperties[property.propertyName] = property;
+
+		// Quantization tolerance
+		property.propertyName = "quantization_tolerance";
+		property.labelName = "Quantization tolerance";
+		property.info = "Maximum error of a quantized attribute; positions are relative to the size of the submesh. Attributes with a larger error are written as floats";
+		property.type = HlmsEditorPluginData::FLOAT;
+		property.floatValue = 0.002f;
+		mProperties[property.propertyName] = property;
+
+		// Generate levels of detail
+		property.propertyName = "generate_lods";
+		property.labelName = "Generate levels of detail";
+		property.info = "Simplify the meshes with quadric error edge collapses and add the levels to the mesh. The mesh is imported via xml, because the levels are converted by OgreMeshTool";
+		property.type = HlmsEditorPluginData::BOOL;
+		property.boolValue = false;
+		mProperties[property.propertyName] = property;
+
+		// Targets of the levels of detail
+		property.propertyName = "lod_targets";
+		property.labelName = "LOD targets";
+		property.info = "Target of each level, separated by spaces: a decreasing fraction of the triangles (e.g. 0.5 0.25 0.125) or, with 'LOD error targets', an increasing error relative to the bounding radius (e.g. 0.002 0.01 0.05)";
+		property.type = HlmsEditorPluginData::STRING;
+		property.stringValue = "0.5 0.25 0.125";
+		mProperties[property.propertyName] = property;
+
+		// The targets are errors instead of triangle ratios
+		property.propertyName = "lod_error_targets";
+		property.labelName = "LOD error targets";
+		property.info = "The LOD targets are maximum errors relative to the bounding radius instead of triangle ratios";
+		property.type = HlmsEditorPluginData::BOOL;
+		property.boolValue = false;
+		mProperties[property.propertyName] = property;
+
+		// Screen-space error of the levels of detail
+		property.propertyName = "lod_pixel_error";
+		property.labelName = "LOD pixel error";
+		property.info = "A level is used while its error is at most this number of pixels on the screen";
+		property.type = HlmsEditorPluginData::FLOAT;
+		property.floatValue = 1.0f;
+		mProperties[property.propertyName] = property;
+
+		// Import via xml
+		property.propertyName = "import_via_xml";
+		property.labelName = "Import via Ogre xml";
+		property.info = "Convert the model to an Ogre xml file first and use OgreMeshTool to create the mesh";
+		property.type = HlmsEditorPluginData::BOOL;
+		property.boolValue = false;
+		mProperties[property.propertyName] = property;
+
 		return mProperties;
 	}
 
@@ -156,6 +327,429 @@ namespace Ogre
 	//---------------------------------------------------------------------
 	bool AssImpPlugin::executeImport (HlmsEditorPluginData* data)
 	{
+		if (!getStringProperty(data, "batch_import_pattern", "").empty())
+			return executeBatchImport(data);
+
+		// The editor only calls executeImport, so the import runs on the worker thread while this thread keeps
+		// the windows responsive; the editor can follow and cancel it with the functions in AssImpPluginDll.cpp
+		if (!startImport(data))
+			return false;
+
+		AssImpImportProgress::Stage loggedStage = AssImpImportProgress::STAGE_IDLE;
+		int loggedPercentage = -1;
+		while (isImportRunning())
+		{
+			pumpImport(loggedStage, loggedPercentage);
+			std::this_thread::sleep_for(gPumpInterval);
+		}
+
+		return finishImport(data);
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpPlugin::pumpImport (AssImpImportProgress::Stage& loggedStage, int& loggedPercentage)
+	{
+		WindowEventUtilities::messagePump();
+
+		// Log each stage and its progress in steps of 10%
+		AssImpImportProgress::Stage stage = mImportProgress.getStage();
+		int percentage = static_cast<int>(mImportProgress.getProgress() * 10.0f) * 10;
+		if (stage == AssImpImportProgress::STAGE_IDLE || (stage == loggedStage && percentage == loggedPercentage))
+			return;
+
+		loggedStage = stage;
+		loggedPercentage = percentage;
+		LogManager::getSingleton().logMessage("AssImpPlugin: " + mImportProgress.getStageName() + " " +
+			StringConverter::toString(percentage) + "%");
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpPlugin::startImport (HlmsEditorPluginData* data)
+	{
+		// A batch import pumps the window messages, so an import can be started while it runs
+		if (mImportStarted || mBatchImportRunning)
+		{
+			data->mOutErrorText = "Another import is still running";
+			return false;
+		}
+
+		mImportProgress.reset();
+		mImportContext.progress = &mImportProgress;
+		mImportStarted = true;
+		mImportResult = false;
+		mImportRunning.store(true);
+		mImportThread = std::thread(&AssImpPlugin::runImport, this, data);
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpPlugin::finishImport (HlmsEditorPluginData* data)
+	{
+		if (!mImportStarted)
+		{
+			data->mOutErrorText = "No import was started";
+			return false;
+		}
+
+		mImportThread.join();
+		mImportStarted = false;
+
+		// The mesh is created on this thread, because it needs the rendersystem
+		bool result = mImportResult && completeImport(data, mImportContext);
+		reportImport(data, mImportContext, result);
+		mImportProgress.setStage(AssImpImportProgress::STAGE_DONE);
+		return result;
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpPlugin::isImportRunning (void) const
+	{
+		return mImportRunning.load();
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpPlugin::cancelImport (void)
+	{
+		mImportProgress.cancel();
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpPlugin::runImport (HlmsEditorPluginData* data)
+	{
+		Assimp::Importer importer;
+		mImportContext.importer = &importer;
+		mImportResult = prepareImport(data, mImportContext);
+		mImportContext.importer = 0;
+		mImportRunning.store(false);
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpPlugin::prepareImport (HlmsEditorPluginData* data, ImportContext& context)
+	{
+		context.meshPrepared = false;
+		context.cacheHit = false;
+		context.profiler.reset(data->mInFileDialogName);
+
+		// Return the cached mesh if the same file was imported before with the same settings
+		String fileName = data->mInFileDialogPath + data->mInFileDialogName;
+		String meshFileName = data->mInImportPath + data->mInFileDialogBaseName + ".mesh";
+		context.importCache.setCacheDir(data->mInImportPath + gImportCacheDir, gImportCacheMaxSize);
+		if (getBoolProperty(data, "use_import_cache", true))
+		{
+			AssImpImportProfiler::Scope scope(&context.profiler, "cacheLookup");
+			String previewFileName = AssImpMeshBuilder::getPreviewFileName(meshFileName);
+			if (context.importCache.calculateKey(fileName, data) &&
+				context.importCache.fetch(meshFileName, AssImpMeshBuilder::getQuantizationFileName(meshFileName), previewFileName))
+			{
+				scope.addBytes(AssImpImportProfiler::getFileSize(meshFileName));
+				data->mOutReference = AssImpImportProfiler::getFileSize(previewFileName) > 0 ? previewFileName : meshFileName;
+				context.cacheHit = true;
+				return true;
+			}
+		}
+
+		return importFile(data, context);
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpPlugin::completeImport (HlmsEditorPluginData* data, ImportContext& context)
+	{
+		bool result = true;
+		if (context.meshPrepared)
+		{
+			context.progress->setStage(AssImpImportProgress::STAGE_CREATE_MESH);
+			result = !context.progress->checkCancelled(data) && createMesh(data, context);
+			context.meshPrepared = false;
+		}
+		context.meshBuilder.clear();
+
+		// Every path (cached, xml or direct) has written the file now
+		if (result)
+			reloadEditorMesh(data->mOutReference);
+
+		if (result && !context.cacheHit && getBoolProperty(data, "use_import_cache", true))
+		{
+			AssImpImportProfiler::Scope scope(&context.profiler, "cacheStore");
+			String meshFileName = data->mInImportPath + data->mInFileDialogBaseName + ".mesh";
+			context.importCache.store(meshFileName, AssImpMeshBuilder::getQuantizationFileName(meshFileName),
+				AssImpMeshBuilder::getPreviewFileName(meshFileName));
+		}
+
+		return result;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpPlugin::reportImport (HlmsEditorPluginData* data, ImportContext& context, bool result)
+	{
+		context.profiler.logStages();
+		if (!getBoolProperty(data, "write_import_report", false))
+			return;
+
+		// A report that cannot be written does not fail the import
+		String reportFileName = data->mInImportPath + data->mInFileDialogBaseName + ".import.json";
+		if (!context.profiler.writeReport(reportFileName, result))
+			LogManager::getSingleton().logMessage("AssImpPlugin: could not write " + reportFileName);
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpPlugin::executeBatchImport (HlmsEditorPluginData* data)
+	{
+		// The batch shares the progress of the plugin with the asynchronous import
+		if (mImportStarted || mBatchImportRunning)
+		{
+			data->mOutErrorText = "Another import is still running";
+			return false;
+		}
+
+		String pattern = getStringProperty(data, "batch_import_pattern", "");
+		StringVector fileNames = findBatchFiles(data, pattern);
+		if (fileNames.empty())
+		{
+			data->mOutErrorText = "No files in " + data->mInFileDialogPath + " match " + pattern;
+			return false;
+		}
+
+		// Each file is written to the import path, so two files with the same base name would overwrite each other
+		BatchState state;
+		std::set<String> baseNames;
+		StringVector::const_iterator it = fileNames.begin();
+		StringVector::const_iterator itEnd = fileNames.end();
+		while (it != itEnd)
+		{
+			BatchJob* job = new BatchJob();
+			job->data = *data;
+			job->data.mInFileDialogName = *it;
+			job->data.mOutErrorText = "";
+			job->data.mOutReference = "";
+			String extension;
+			StringUtil::splitBaseFilename(*it, job->data.mInFileDialogBaseName, extension);
+			if (!baseNames.insert(job->data.mInFileDialogBaseName).second)
+			{
+				job->prepared = true;
+				job->data.mOutErrorText = "Another file with base name " + job->data.mInFileDialogBaseName + " is imported";
+			}
+
+			job->progress.setParent(&mImportProgress);
+			job->context.progress = &job->progress;
+			state.jobs.push_back(job);
+			++it;
+		}
+
+		// A bounded pool of workers; a value of 0 means one worker per core
+		size_t numWorkers = static_cast<size_t>(std::max(getIntProperty(data, "batch_import_threads", 0), 0));
+		if (numWorkers == 0)
+			numWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+		numWorkers = std::min(numWorkers, state.jobs.size());
+
+		// The files are already imported in parallel, so each file gets a share of the cores; otherwise every
+		// worker would start a thread per core in the optimizer, the simplifier and the xml writer
+		unsigned int maxThreadsPerJob = std::max(std::thread::hardware_concurrency() / static_cast<unsigned int>(numWorkers), 1u);
+		std::vector<BatchJob*>::iterator itJob = state.jobs.begin();
+		std::vector<BatchJob*>::iterator itJobEnd = state.jobs.end();
+		while (itJob != itJobEnd)
+		{
+			(*itJob)->context.maxThreads = maxThreadsPerJob;
+			++itJob;
+		}
+
+		// Workers don't run too far ahead of the mesh creation, because every prepared mesh keeps its buffers in memory
+		state.nextJob.store(0);
+		state.numCompleted = 0;
+		state.maxPending = numWorkers * gBatchJobsAheadPerWorker;
+
+		// Busy until the workers are joined; nothing returns in between
+		mBatchImportRunning = true;
+		mImportProgress.reset();
+		mImportProgress.setStage(AssImpImportProgress::STAGE_CONVERT);
+		Timer timer;
+		std::vector<std::thread> workers;
+		size_t i = 0;
+		while (i < numWorkers)
+		{
+			workers.push_back(std::thread(&AssImpPlugin::runBatchWorker, this, &state));
+			++i;
+		}
+
+		// Create the meshes on this thread, in the order of the files; the window messages are pumped while
+		// it waits for a worker
+		AssImpImportProgress::Stage loggedStage = AssImpImportProgress::STAGE_IDLE;
+		int loggedPercentage = -1;
+		size_t numFailed = 0;
+		String meshFileName;
+		i = 0;
+		while (i < state.jobs.size())
+		{
+			BatchJob* job = state.jobs[i];
+			{
+				std::unique_lock<std::mutex> lock(state.mutex);
+				while (!state.condition.wait_for(lock, gPumpInterval, [job] {return job->prepared;}))
+				{
+					lock.unlock();
+					pumpImport(loggedStage, loggedPercentage);
+					lock.lock();
+				}
+			}
+
+			if (job->result)
+			{
+				Timer completeTimer;
+				job->result = completeImport(&job->data, job->context);
+				job->completeMicroseconds = completeTimer.getMicroseconds();
+			}
+			reportImport(&job->data, job->context, job->result);
+
+			if (job->result)
+				meshFileName = job->data.mOutReference;
+			else
+				++numFailed;
+
+			{
+				std::lock_guard<std::mutex> lock(state.mutex);
+				++state.numCompleted;
+			}
+			state.condition.notify_all();
+			mImportProgress.setProgress(static_cast<float>(i + 1) / static_cast<float>(state.jobs.size()));
+			++i;
+		}
+
+		std::vector<std::thread>::iterator itWorker = workers.begin();
+		std::vector<std::thread>::iterator itWorkerEnd = workers.end();
+		while (itWorker != itWorkerEnd)
+		{
+			itWorker->join();
+			++itWorker;
+		}
+		mBatchImportRunning = false;
+
+		logBatchSummary(state, timer.getMicroseconds());
+		mImportProgress.setStage(AssImpImportProgress::STAGE_DONE);
+
+		itJob = state.jobs.begin();
+		while (itJob != itJobEnd)
+		{
+			delete *itJob;
+			++itJob;
+		}
+
+		if (mImportProgress.checkCancelled(data))
+			return false;
+
+		if (numFailed > 0)
+		{
+			data->mOutErrorText = StringConverter::toString(numFailed) + " of " +
+				StringConverter::toString(fileNames.size()) + " files could not be imported; see the log for details";
+			return false;
+		}
+
+		data->mOutReference = meshFileName;
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	StringVector AssImpPlugin::findBatchFiles (HlmsEditorPluginData* data, const String& pattern)
+	{
+		// The pattern may contain more than one wildcard pattern, separated by ';' (e.g. *.fbx;*.obj)
+		// The directory is listed directly; loading it with the ArchiveManager would unload the archive of the
+		// editor if the directory is one of its resource locations
+		std::set<String> fileNames;
+		StringVector directoryFileNames = AssImpImportCache::listFiles(data->mInFileDialogPath);
+		StringVector patterns = StringUtil::split(pattern, ";");
+		StringVector::const_iterator it = patterns.begin();
+		StringVector::const_iterator itEnd = patterns.end();
+		while (it != itEnd)
+		{
+			String filePattern = *it;
+			StringUtil::trim(filePattern);
+			if (!filePattern.empty())
+			{
+				StringVector::const_iterator itFile = directoryFileNames.begin();
+				StringVector::const_iterator itFileEnd = directoryFileNames.end();
+				while (itFile != itFileEnd)
+				{
+					if (StringUtil::match(*itFile, filePattern, gCaseSensitiveFileNames))
+						fileNames.insert(*itFile);
+					++itFile;
+				}
+			}
+			++it;
+		}
+
+		return StringVector(fileNames.begin(), fileNames.end());
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpPlugin::runBatchWorker (BatchState* state)
+	{
+		// The importer is reused for all files of this worker
+		Assimp::Importer importer;
+		size_t numJobs = state->jobs.size();
+		size_t jobIndex = state->nextJob.fetch_add(1);
+		while (jobIndex < numJobs)
+		{
+			BatchJob* job = state->jobs[jobIndex];
+			{
+				std::unique_lock<std::mutex> lock(state->mutex);
+				state->condition.wait(lock, [state, jobIndex] {return jobIndex < state->numCompleted + state->maxPending;});
+			}
+
+			// Jobs that are not yet started when the batch is cancelled, are skipped
+			if (!job->prepared)
+			{
+				if (!job->progress.checkCancelled(&job->data))
+				{
+					Timer timer;
+					job->context.importer = &importer;
+					job->result = prepareImport(&job->data, job->context);
+					job->context.importer = 0;
+					job->prepareMicroseconds = timer.getMicroseconds();
+				}
+
+				std::lock_guard<std::mutex> lock(state->mutex);
+				job->prepared = true;
+			}
+			state->condition.notify_all();
+			jobIndex = state->nextJob.fetch_add(1);
+		}
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpPlugin::logBatchSummary (const BatchState& state, unsigned long microseconds)
+	{
+		size_t numSucceeded = 0;
+		LogManager& logManager = LogManager::getSingleton();
+		std::vector<BatchJob*>::const_iterator it = state.jobs.begin();
+		std::vector<BatchJob*>::const_iterator itEnd = state.jobs.end();
+		while (it != itEnd)
+		{
+			const BatchJob* job = *it;
+			String line = "AssImpPlugin: " + job->data.mInFileDialogName + ": ";
+			if (job->result)
+			{
+				++numSucceeded;
+				line += "imported in " + StringConverter::toString(job->prepareMicroseconds / 1000) + " ms";
+				if (job->completeMicroseconds > 0)
+					line += " + " + StringConverter::toString(job->completeMicroseconds / 1000) + " ms mesh creation";
+				if (job->context.cacheHit)
+					line += " (cached)";
+			}
+			else
+			{
+				line += "FAILED: " + job->data.mOutErrorText;
+			}
+			logManager.logMessage(line);
+			++it;
+		}
+
+		logManager.logMessage("AssImpPlugin: batch import of " + StringConverter::toString(state.jobs.size()) +
+			" files: " + StringConverter::toString(numSucceeded) + " imported, " +
+			StringConverter::toString(state.jobs.size() - numSucceeded) + " failed in " +
+			StringConverter::toString(microseconds / 1000) + " ms");
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpPlugin::importFile (HlmsEditorPluginData* data, ImportContext& context)
+	{
+		AssImpImportProgress* importProgress = context.progress;
 		bool fileIsOgreMeshXml = false;
 		std::string::size_type idx = data->mInFileDialogName.rfind('.');
 		if (idx != std::string::npos)
@@ -168,24 +762,54 @@ namespace Ogre
 		if (fileIsOgreMeshXml)
 		{
 			// It is an Ogre mesh xml file?
+			importProgress->setStage(AssImpImportProgress::STAGE_CONVERT);
 			XmlSerializer xmlSerializer;
+			xmlSerializer.setImportProgress(importProgress);
+			xmlSerializer.setImportProfiler(&context.profiler);
+			xmlSerializer.setMaxThreads(context.maxThreads);
 			if (!xmlSerializer.importOgreMeshXml(xmlFileName, data))
 				return false;
 
+			// The mesh is not quantized; the cache must not store the files of an older, quantized import with it
+			importProgress->setStage(AssImpImportProgress::STAGE_CREATE_MESH);
 			String meshFileName = data->mInImportPath + data->mInFileDialogBaseName + ".mesh";
-			xmlSerializer.convertXmlFileToMesh(xmlFileName, meshFileName, data);
+			std::remove(AssImpMeshBuilder::getQuantizationFileName(meshFileName).c_str());
+			std::remove(AssImpMeshBuilder::getPreviewFileName(meshFileName).c_str());
+			if (!xmlSerializer.convertXmlFileToMesh(xmlFileName, meshFileName, data))
+				return false;
 			data->mOutReference = meshFileName;
 			return true;
 		}
 		else
 		{
 			// It is not an Ogre mesh xml, so let assimp do the work
-			Assimp::Importer importer;
+			// The source file and the files it references are memory mapped; the importer owns the IOSystem
+			// and the progress handler
+			importProgress->setStage(AssImpImportProgress::STAGE_PARSE);
+			Assimp::Importer& importer = *context.importer;
+			AssImpMappedIOSystem* ioSystem = new AssImpMappedIOSystem();
+			importer.SetIOHandler(ioSystem);
+			importer.SetProgressHandler(new AssImpProgressHandler(importProgress));
 			String name = data->mInFileDialogPath + data->mInFileDialogName;
-			const aiScene* scene = importer.ReadFile(name,
-				aiProcessPreset_TargetRealtime_Quality |
+			unsigned int postProcessSteps = aiProcessPreset_TargetRealtime_Quality |
 				aiProcess_TransformUVCoords |
-				aiProcess_FlipUVs);
+				aiProcess_FlipUVs;
+
+			// The mesh optimizer replaces assimp's own cache locality step
+			bool optimizeVertexCache = getBoolProperty(data, "optimize_vertex_cache", false);
+			if (optimizeVertexCache)
+				postProcessSteps &= ~aiProcess_ImproveCacheLocality;
+
+			const aiScene* scene = 0;
+			{
+				AssImpImportProfiler::Scope scope(&context.profiler, "ReadFile");
+				scene = importer.ReadFile(name, postProcessSteps);
+				scope.addBytes(ioSystem->getTotalBytesRead());
+			}
+			ioSystem->logBytesRead();
+
+			if (importProgress->checkCancelled(data))
+				return false;
 
 			if (!scene)
 			{
@@ -194,11 +818,58 @@ namespace Ogre
 				return false;
 			}
 
+			// The scene is owned by the importer, but nothing else uses it until it is freed below
+			aiScene* optimizedScene = const_cast<aiScene*>(scene);
+			if (getBoolProperty(data, "split_large_submeshes", false))
+			{
+				importProgress->setStage(AssImpImportProgress::STAGE_OPTIMIZE);
+				AssImpImportProfiler::Scope scope(&context.profiler, "splitMeshes");
+				AssImpMeshSplitter meshSplitter;
+				meshSplitter.splitScene(optimizedScene);
+				if (importProgress->checkCancelled(data))
+					return false;
+			}
+
+			if (optimizeVertexCache)
+			{
+				importProgress->setStage(AssImpImportProgress::STAGE_OPTIMIZE);
+				AssImpImportProfiler::Scope scope(&context.profiler, "optimizeMeshes");
+				AssImpMeshOptimizer meshOptimizer;
+				meshOptimizer.setImportProgress(importProgress);
+				meshOptimizer.setImportProfiler(&context.profiler);
+				meshOptimizer.setMaxThreads(context.maxThreads);
+				meshOptimizer.setOverdrawOptimization(getBoolProperty(data, "optimize_overdraw", false),
+					getFloatProperty(data, "overdraw_threshold", 1.05f));
+				if (!meshOptimizer.optimizeScene(optimizedScene, data))
+					return false;
+			}
 
-			if (!parseScene(scene, data))
+			// The levels of detail are index lists into the optimised vertices, so they are generated last
+			context.meshSimplifier.clear();
+			if (getBoolProperty(data, "generate_lods", false))
 			{
-				return false;
+				importProgress->setStage(AssImpImportProgress::STAGE_SIMPLIFY);
+				AssImpImportProfiler::Scope scope(&context.profiler, "simplifyMeshes");
+				if (!setLodTargets(data, context.meshSimplifier))
+					return false;
+				context.meshSimplifier.setImportProgress(importProgress);
+				context.meshSimplifier.setImportProfiler(&context.profiler);
+				context.meshSimplifier.setMaxThreads(context.maxThreads);
+				if (!context.meshSimplifier.simplifyScene(optimizedScene, data))
+					return false;
 			}
+
+			importProgress->setStage(AssImpImportProgress::STAGE_CONVERT);
+			bool result = false;
+			{
+				AssImpImportProfiler::Scope scope(&context.profiler, "parseScene");
+				result = parseScene(scene, data, context);
+			}
+			context.meshSimplifier.clear();
+
+			// The scene is owned by the importer; release it now, because the importer may be reused
+			importer.FreeScene();
+			return result;
 		}
 
 		return true;
@@ -212,7 +883,7 @@ namespace Ogre
 	}
 
 	//---------------------------------------------------------------------
-	bool AssImpPlugin::parseScene (const aiScene* scene, HlmsEditorPluginData* data)
+	bool AssImpPlugin::parseScene (const aiScene* scene, HlmsEditorPluginData* data, ImportContext& context)
 	{
 		// The scene must have at least one model
 		if (!scene->HasMeshes())
@@ -221,10 +892,120 @@ namespace Ogre
 			return false;
 		}
 
+		// The v2 mesh has no public interface to set the values of its levels of detail, so they are written
+		// to the xml file and converted by OgreMeshTool
+		bool importViaXml = getBoolProperty(data, "import_via_xml", false);
+		if (!importViaXml && context.meshSimplifier.getNumLodLevels() > 0)
+		{
+			LogManager::getSingleton().logMessage("AssImpPlugin: Levels of detail are generated; importing via xml");
+			importViaXml = true;
+		}
+
+		if (importViaXml)
+		{
+			// OgreMeshTool has no equivalent of the quantization profile
+			if (getBoolProperty(data, "quantize_vertices", false))
+				LogManager::getSingleton().logMessage("AssImpPlugin: Vertex quantization is not supported when importing via xml; ignored");
+			String meshFileName = data->mInImportPath + data->mInFileDialogBaseName + ".mesh";
+			std::remove(AssImpMeshBuilder::getQuantizationFileName(meshFileName).c_str());
+			std::remove(AssImpMeshBuilder::getPreviewFileName(meshFileName).c_str());
+			return parseSceneViaXml(scene, data, context);
+		}
+
+		// Build the v2 mesh directly from the assimp scene
+		// Only the vertex and index data is prepared here; the mesh itself is created by createMesh
+		context.meshBuilder.setImportProgress(context.progress);
+		if (!context.meshBuilder.prepareSubMeshes(scene, data))
+		{
+			// The detailed error is set in the prepareSubMeshes function
+			return false;
+		}
+
+		context.meshPrepared = true;
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpPlugin::createMesh (HlmsEditorPluginData* data, ImportContext& context)
+	{
+		// The mesh is only created to be saved, so it gets a name of its own and is removed afterwards;
+		// like on the other paths, the editor loads the file
+		String meshFileName = data->mInImportPath + data->mInFileDialogBaseName + ".mesh";
+		MeshPtr mesh;
+
+		// The HLMS of the editor doesn't dequantize, so it loads a preview without quantization instead.
+		// The preview is created first, because the mesh takes over the packed data.
+		bool quantized = context.meshBuilder.isQuantized();
+		if (quantized)
+		{
+			AssImpImportProfiler::Scope scope(&context.profiler, "savePreviewMesh");
+			mesh = context.meshBuilder.createMesh(gSavedMeshPrefix + data->mInFileDialogBaseName + ".preview.mesh",
+				ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+				data,
+				true);
+			if (mesh.isNull())
+				return false;
+			bool saved = context.meshBuilder.savePreviewMesh(mesh, meshFileName, data);
+			MeshManager::getSingleton().remove(mesh->getHandle());
+			if (!saved)
+				return false;
+		}
+
+		{
+			AssImpImportProfiler::Scope scope(&context.profiler, "createMesh");
+			mesh = context.meshBuilder.createMesh(gSavedMeshPrefix + data->mInFileDialogBaseName + ".mesh",
+				ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+				data);
+			if (mesh.isNull())
+				return false;
+		}
+
+		// Write the v2 binary mesh in-process; no need to run OgreMeshTool
+		AssImpImportProfiler::Scope scope(&context.profiler, "saveMesh");
+		bool saved = context.meshBuilder.saveMesh(mesh, meshFileName, data);
+		MeshManager::getSingleton().remove(mesh->getHandle());
+		if (!saved)
+			return false;
+		scope.addBytes(AssImpImportProfiler::getFileSize(meshFileName));
+
+		data->mOutReference = quantized ? AssImpMeshBuilder::getPreviewFileName(meshFileName) : meshFileName;
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	void AssImpPlugin::reloadEditorMesh (const String& meshFileName)
+	{
+		// The editor loads the mesh by its file name; if a previous import of the file is still loaded, it
+		// would get the old geometry
+		String meshName;
+		String path;
+		StringUtil::splitFilename(meshFileName, meshName, path);
+		MeshPtr mesh = MeshManager::getSingleton().getByName(meshName);
+		if (mesh.isNull() || !mesh->isLoaded())
+			return;
+
+		try
+		{
+			mesh->reload();
+			LogManager::getSingleton().logMessage("AssImpPlugin: Reloaded " + meshName);
+		}
+		catch (Exception& e)
+		{
+			LogManager::getSingleton().logMessage("AssImpPlugin: Could not reload " + meshName + ": " + e.getDescription());
+		}
+	}
+
+	//---------------------------------------------------------------------
+	bool AssImpPlugin::parseSceneViaXml (const aiScene* scene, HlmsEditorPluginData* data, ImportContext& context)
+	{
 		// Convert the assimp scene to a neutral Ogre xml format first and save it
 		// After conversion to xml, Ogre's MeshSerializer converts it to the actual mesh
 
 		XmlSerializer xmlSerializer;
+		xmlSerializer.setImportProgress(context.progress);
+		xmlSerializer.setImportProfiler(&context.profiler);
+		xmlSerializer.setMaxThreads(context.maxThreads);
+		xmlSerializer.setMeshSimplifier(&context.meshSimplifier, getFloatProperty(data, "lod_pixel_error", 1.0f));
 		String xmlFileName = data->mInImportPath + data->mInFileDialogBaseName + ".xml";
 		String meshFileName = data->mInImportPath + data->mInFileDialogBaseName + ".mesh";
 		if (!xmlSerializer.convertAssImpMeshToXml(scene, xmlFileName, data))
@@ -232,9 +1013,45 @@ namespace Ogre
 			// The detailed error is set in the convertAssImpMeshToXml function
 			return false;
 		}
-		xmlSerializer.convertXmlFileToMesh(xmlFileName, meshFileName, data);
+
+		context.progress->setStage(AssImpImportProgress::STAGE_CREATE_MESH);
+		if (!xmlSerializer.convertXmlFileToMesh(xmlFileName, meshFileName, data))
+			return false;
 		data->mOutReference = meshFileName;
 		return true;
 	}
 
+	//---------------------------------------------------------------------
+	bool AssImpPlugin::setLodTargets (HlmsEditorPluginData* data, AssImpMeshSimplifier& meshSimplifier)
+	{
+		// The targets may be separated by spaces, commas or semicolons
+		String targetsText = getStringProperty(data, "lod_targets", "0.5 0.25 0.125");
+		StringVector targetStrings = StringUtil::split(targetsText, " ,;");
+		std::vector<float> targets;
+		StringVector::const_iterator it = targetStrings.begin();
+		StringVector::const_iterator itEnd = targetStrings.end();
+		while (it != itEnd)
+		{
+			if (!StringConverter::isNumber(*it))
+			{
+				data->mOutErrorText = "LOD target '" + *it + "' is not a number";
+				return false;
+			}
+			targets.push_back(StringConverter::parseReal(*it));
+			++it;
+		}
+
+		bool errorTargets = getBoolProperty(data, "lod_error_targets", false);
+		if (!meshSimplifier.setTargets(errorTargets ? AssImpMeshSimplifier::TARGET_ERROR : AssImpMeshSimplifier::TARGET_TRIANGLE_RATIO, targets))
+		{
+			if (errorTargets)
+				data->mOutErrorText = "The LOD targets must be increasing errors larger than 0";
+			else
+				data->mOutErrorText = "The LOD targets must be decreasing triangle ratios between 0 and 1";
+			return false;
+		}
+
+		return true;
+	}
+
 }
@@ -46,6 +46,23 @@ namespace Ogre
         Root::getSingleton().uninstallPlugin(plugin);
         OGRE_DELETE plugin;
     }
+
+    // Follow and cancel the running import; executeImport pumps the window messages of the editor while the
+    // import runs, so these can be called from its event handlers
+    extern "C" float _AssImpPluginExport dllGetImportProgress(void)
+    {
+        return plugin->getImportProgress().getProgress();
+    }
+
+    extern "C" const char* _AssImpPluginExport dllGetImportStageName(void)
+    {
+        return plugin->getImportProgress().getStageName().c_str();
+    }
+
+    extern "C" void _AssImpPluginExport dllCancelImport(void)
+    {
+        plugin->cancelImport();
+    }
 }
 
 #endif
@@ -0,0 +1,177 @@
+/*
+  -----------------------------------------------------------------------------
+  This source file is part of OGRE
+  (Object-oriented Graphics Rendering Engine)
+  For the latest info, see http://www.ogre3d.org/
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+  -----------------------------------------------------------------------------
+*/
+
+#include "NumberFormat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#if (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)) && defined(__has_include)
+#	if __has_include(<charconv>)
+#		include <charconv>
+#	endif
+#endif
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#	define ASSIMP_PLUGIN_USE_TO_CHARS 1
+#endif
+
+namespace Ogre
+{
+	// Maximum number of significant digits needed to round trip a float
+	static const unsigned int gMaxFloatDigits = 9;
+	// Maximum number of significant digits needed to round trip a double
+	static const unsigned int gMaxDoubleDigits = 17;
+
+	//---------------------------------------------------------------------
+	size_t NumberFormat::formatInt(char* buffer, int value)
+	{
+		if (value >= 0)
+			return formatUnsignedInt(buffer, static_cast<unsigned int>(value));
+
+		// Negate as unsigned, so INT_MIN does not overflow
+		buffer[0] = '-';
+		return 1 + formatUnsignedInt(buffer + 1, 0u - static_cast<unsigned int>(value));
+	}
+
+	//---------------------------------------------------------------------
+	size_t NumberFormat::formatUnsignedInt(char* buffer, unsigned int value)
+	{
+		// Write the digits backwards into a scratch buffer and copy them in the right order
+		char digits[16];
+		size_t length = 0;
+		do
+		{
+			digits[length++] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		} while (value != 0);
+
+		for (size_t i = 0; i < length; ++i)
+			buffer[i] = digits[length - 1 - i];
+		buffer[length] = 0;
+		return length;
+	}
+
+	//---------------------------------------------------------------------
+	size_t NumberFormat::formatFloat(char* buffer, float value, unsigned int precision)
+	{
+		if (precision > gMaxFloatDigits)
+			precision = gMaxFloatDigits;
+
+#ifdef ASSIMP_PLUGIN_USE_TO_CHARS
+		std::to_chars_result result;
+		if (precision == PRECISION_SHORTEST)
+			result = std::to_chars(buffer, buffer + BUFFER_SIZE - 1, value);
+		else
+			result = std::to_chars(buffer, buffer + BUFFER_SIZE - 1, value, std::chars_format::general, static_cast<int>(precision));
+		*result.ptr = 0;
+		return static_cast<size_t>(result.ptr - buffer);
+#else
+		if (precision != PRECISION_SHORTEST)
+			return static_cast<size_t>(snprintf(buffer, BUFFER_SIZE, "%.*g", static_cast<int>(precision), value));
+
+		// Find the smallest number of digits that reads back as the same float. A float never needs more
+		// than 9 digits, and %g drops trailing zeros, so starting at 6 digits still gives the shortest result.
+		int length = 0;
+		for (unsigned int digits = 6; digits <= gMaxFloatDigits; ++digits)
+		{
+			length = snprintf(buffer, BUFFER_SIZE, "%.*g", static_cast<int>(digits), value);
+			if (static_cast<float>(strtod(buffer, 0)) == value)
+				break;
+		}
+		return static_cast<size_t>(length);
+#endif
+	}
+
+	//---------------------------------------------------------------------
+	size_t NumberFormat::formatDouble(char* buffer, double value)
+	{
+#ifdef ASSIMP_PLUGIN_USE_TO_CHARS
+		std::to_chars_result result = std::to_chars(buffer, buffer + BUFFER_SIZE - 1, value);
+		*result.ptr = 0;
+		return static_cast<size_t>(result.ptr - buffer);
+#else
+		// Same approach as formatFloat; 15 digits always read back as the same decimal
+		int length = 0;
+		for (unsigned int digits = 15; digits <= gMaxDoubleDigits; ++digits)
+		{
+			length = snprintf(buffer, BUFFER_SIZE, "%.*g", static_cast<int>(digits), value);
+			if (strtod(buffer, 0) == value)
+				break;
+		}
+		return static_cast<size_t>(length);
+#endif
+	}
+
+	//---------------------------------------------------------------------
+	// Skip what sscanf skips in front of a number, but which from_chars does not accept
+	static const char* skipNumberPrefix(const char* text)
+	{
+		while (isspace(static_cast<unsigned char>(*text)))
+			++text;
+		if (*text == '+' && text[1] != '-')
+			++text;
+		return text;
+	}
+
+	//---------------------------------------------------------------------
+	bool NumberFormat::parseInt(const char* text, int& value)
+	{
+		text = skipNumberPrefix(text);
+#ifdef ASSIMP_PLUGIN_USE_TO_CHARS
+		std::from_chars_result result = std::from_chars(text, text + strlen(text), value);
+		return result.ec == std::errc();
+#else
+		char* end;
+		errno = 0;
+		long number = strtol(text, &end, 10);
+		if (end == text || errno == ERANGE || number < INT_MIN || number > INT_MAX)
+			return false;
+		value = static_cast<int>(number);
+		return true;
+#endif
+	}
+
+	//---------------------------------------------------------------------
+	bool NumberFormat::parseDouble(const char* text, double& value)
+	{
+		text = skipNumberPrefix(text);
+#ifdef ASSIMP_PLUGIN_USE_TO_CHARS
+		std::from_chars_result result = std::from_chars(text, text + strlen(text), value);
+		return result.ec == std::errc();
+#else
+		char* end;
+		double number = strtod(text, &end);
+		if (end == text)
+			return false;
+		value = number;
+		return true;
+#endif
+	}
+}
@@ -30,20 +30,388 @@ distribution.
 #endif
 
 #include "XML/tinyxml.h"
+#include "NumberFormat.h"
+
+#if defined( _WIN32 )
+#   ifndef WIN32_LEAN_AND_MEAN
+#       define WIN32_LEAN_AND_MEAN
+#   endif
+#   include <windows.h>
+#   include <io.h>
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
 
 
 bool TiXmlBase::condenseWhiteSpace = true;
 
-void TiXmlBase::PutString( const TIXML_STRING& str, TIXML_STRING* outString )
+// Every object allocated by TiXmlBase::operator new is preceded by this header, so operator delete
+// knows whether the object lives in an arena.
+union TiXmlAllocationHeader
+{
+    TiXmlArena* arena;
+    double      align;
+};
+
+
+TiXmlArena::TiXmlArena() : blocks( 0 ), current( 0 ), end( 0 ), bytesAllocated( 0 )
+{
+}
+
+
+TiXmlArena::~TiXmlArena()
+{
+    Release();
+}
+
+
+void* TiXmlArena::Allocate( size_t size )
+{
+    size = ( size + ALIGNMENT - 1 ) & ~( static_cast< size_t >( ALIGNMENT ) - 1 );
+    if ( static_cast< size_t >( end - current ) < size )
+    {
+        // Objects that don't fit in a normal block get a block of their own
+        size_t blockSize = sizeof( Block ) + size;
+        if ( blockSize < BLOCK_SIZE )
+            blockSize = BLOCK_SIZE;
+
+        char* memory = new char[ blockSize ];
+        Block* block = reinterpret_cast< Block* >( memory );
+        block->next = blocks;
+        block->size = blockSize;
+        blocks = block;
+        current = memory + sizeof( Block );
+        end = memory + blockSize;
+    }
+
+    void* p = current;
+    current += size;
+    bytesAllocated += size;
+    return p;
+}
+
+
+void TiXmlArena::Release()
+{
+    while ( blocks )
+    {
+        Block* next = blocks->next;
+        delete [] reinterpret_cast< char* >( blocks );
+        blocks = next;
+    }
+    current = 0;
+    end = 0;
+    bytesAllocated = 0;
+}
+
+
+const TIXML_STRING TiXmlName::empty;
+
+
+const TiXmlName* TiXmlName::Create( const char* str, size_t length )
+{
+    if ( !length )
+        return 0;
+
+    TiXmlName* name = new TiXmlName();
+    name->str.assign( str, length );
+    name->hash = 0;
+    name->table = 0;
+    return name;
+}
+
+
+const TiXmlName* TiXmlName::Create( TIXML_STRING* str )
+{
+    if ( str->empty() )
+        return 0;
+
+    TiXmlName* name = new TiXmlName();
+    name->str.swap( *str );
+    name->hash = 0;
+    name->table = 0;
+    return name;
+}
+
+
+TiXmlNameTable::TiXmlNameTable() : slots( 0 ), size( 0 ), count( 0 )
+{
+}
+
+
+TiXmlNameTable::~TiXmlNameTable()
+{
+    for( int i = 0; i < size; ++i )
+        delete slots[ i ];
+    delete [] slots;
+}
+
+
+const TiXmlName* TiXmlNameTable::Intern( const char* name, size_t length )
+{
+    unsigned int hash = Hash( name, length );
+    if ( size )
+    {
+        int slot = FindSlot( name, length, hash );
+        if ( slots[ slot ] )
+            return slots[ slot ];
+    }
+
+    // Keep the table at most half full
+    if ( ( count + 1 ) * 2 > size )
+    {
+        TiXmlName** oldSlots = slots;
+        int oldSize = size;
+        size = size ? size * 2 : 64;
+        slots = new TiXmlName*[ size ];
+        memset( slots, 0, size * sizeof( TiXmlName* ) );
+        for( int i = 0; i < oldSize; ++i )
+        {
+            if ( oldSlots[ i ] )
+                slots[ FindSlot( oldSlots[ i ]->str.c_str(), oldSlots[ i ]->str.length(), oldSlots[ i ]->hash ) ] = oldSlots[ i ];
+        }
+        delete [] oldSlots;
+    }
+
+    TiXmlName* interned = new TiXmlName();
+    interned->str.assign( name, length );
+    interned->hash = hash;
+    interned->table = this;
+    slots[ FindSlot( name, length, hash ) ] = interned;
+    ++count;
+    return interned;
+}
+
+
+const TiXmlName* TiXmlNameTable::Find( const char* name, size_t length ) const
+{
+    if ( !size )
+        return 0;
+    return slots[ FindSlot( name, length, Hash( name, length ) ) ];
+}
+
+
+unsigned int TiXmlNameTable::Hash( const char* name, size_t length )
+{
+    unsigned int hash = 2166136261u;
+    for( size_t i = 0; i < length; ++i )
+    {
+        hash ^= (unsigned char) name[ i ];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+int TiXmlNameTable::FindSlot( const char* name, size_t length, unsigned int hash ) const
+{
+    int mask = size - 1;
+    int slot = hash & mask;
+    while (    slots[ slot ]
+            && (    slots[ slot ]->hash != hash
+                 || slots[ slot ]->str.length() != length
+                 || memcmp( slots[ slot ]->str.c_str(), name, length ) != 0 ) )
+    {
+        slot = ( slot + 1 ) & mask;
+    }
+    return slot;
+}
+
+
+// Compares node values with a name. Values interned in the name table of the document are
+// compared by pointer; the name is looked up in that table once per search.
+class TiXmlValueMatch
+{
+public:
+    TiXmlValueMatch( const char* _value ) : value( _value ), interned( 0 ), resolved( false ) {}
+
+    bool Equals( const TiXmlName* nodeValue )
+    {
+        if ( !nodeValue || !nodeValue->table )
+            return strcmp( TiXmlName::Str( nodeValue ).c_str(), value ) == 0;
+
+        if ( !resolved )
+        {
+            interned = nodeValue->table->Find( value, strlen( value ) );
+            resolved = true;
+        }
+        return nodeValue == interned;
+    }
+
+private:
+    const char*         value;
+    const TiXmlName*    interned;
+    bool                resolved;
+};
+
+
+TiXmlOutput::TiXmlOutput( FILE* _file )
+{
+    Init();
+    file = _file;
+    buffer = new char[ BUFFER_SIZE ];
+}
+
+
+TiXmlOutput::TiXmlOutput( int _fileDescriptor )
+{
+    Init();
+    fileDescriptor = _fileDescriptor;
+    buffer = new char[ BUFFER_SIZE ];
+}
+
+
+TiXmlOutput::TiXmlOutput( TIXML_STRING* _memory )
+{
+    Init();
+    memory = _memory;
+}
+
+
+TiXmlOutput::TiXmlOutput( Callback _callback, void* _userData )
+{
+    Init();
+    callback = _callback;
+    userData = _userData;
+    buffer = new char[ BUFFER_SIZE ];
+}
+
+
+TiXmlOutput::~TiXmlOutput()
+{
+    Flush();
+    delete [] buffer;
+}
+
+
+void TiXmlOutput::Init()
+{
+    file = 0;
+    fileDescriptor = -1;
+    memory = 0;
+    callback = 0;
+    userData = 0;
+    buffer = 0;
+    used = 0;
+    compact = false;
+    error = false;
+}
+
+
+void TiXmlOutput::Write( const char* data, size_t length )
+{
+    if ( memory )
+    {
+        memory->append( data, length );
+        return;
+    }
+
+    if ( used + length > BUFFER_SIZE )
+    {
+        Flush();
+        // Large pieces are not copied into the buffer first
+        if ( length >= BUFFER_SIZE )
+        {
+            if ( !WriteTarget( data, length ) )
+                error = true;
+            return;
+        }
+    }
+    memcpy( buffer + used, data, length );
+    used += length;
+}
+
+
+void TiXmlOutput::Indent( int depth )
+{
+    if ( compact )
+        return;
+    for ( int i=0; i<depth; i++ )
+        Write( "    ", 4 );
+}
+
+
+bool TiXmlOutput::Flush()
+{
+    if ( used )
+    {
+        if ( !WriteTarget( buffer, used ) )
+            error = true;
+        used = 0;
+    }
+    if ( file && fflush( file ) != 0 )
+        error = true;
+    return !error;
+}
+
+
+bool TiXmlOutput::WriteTarget( const char* data, size_t length )
+{
+    if ( file )
+        return fwrite( data, 1, length, file ) == length;
+
+    if ( callback )
+        return callback( data, length, userData );
+
+    // A file descriptor may take less than it is given
+    while ( length )
+    {
+#if defined( _WIN32 )
+        int written = _write( fileDescriptor, data, (unsigned int) length );
+#else
+        ssize_t written = write( fileDescriptor, data, length );
+#endif
+        if ( written <= 0 )
+            return false;
+        data += written;
+        length -= (size_t) written;
+    }
+    return true;
+}
+
+
+void TiXmlBase::Print( FILE* cfile, int depth ) const
+{
+    assert( cfile );
+    TiXmlOutput out( cfile );
+    PrintTo( &out, depth );
+}
+
+
+void* TiXmlBase::operator new( size_t size, TiXmlArena* arena )
+{
+    size += sizeof( TiXmlAllocationHeader );
+    TiXmlAllocationHeader* header = static_cast< TiXmlAllocationHeader* >( arena ? arena->Allocate( size ) : ::operator new( size ) );
+    header->arena = arena;
+    return header + 1;
+}
+
+
+void TiXmlBase::operator delete( void* p )
+{
+    if ( !p )
+        return;
+
+    // Objects in an arena are freed when the arena is released
+    TiXmlAllocationHeader* header = static_cast< TiXmlAllocationHeader* >( p ) - 1;
+    if ( !header->arena )
+        ::operator delete( header );
+}
+
+
+void TiXmlBase::PutString( const char* str, size_t length, TIXML_STRING* outString )
 {
     int i=0;
 
-    while( i<(int)str.length() )
+    while( i<(int)length )
     {
         unsigned char c = (unsigned char) str[i];
 
         if (    c == '&' 
-             && i < ( (int)str.length() - 2 )
+             && i < ( (int)length - 2 )
              && str[i+1] == '#'
              && str[i+2] == 'x' )
         {
@@ -57,9 +425,9 @@ void TiXmlBase::PutString( const TIXML_STRING& str, TIXML_STRING* outString )
             // while fails (error case) and break (semicolon found).
             // However, there is no mechanism (currently) for
             // this function to return an error.
-            while ( i<(int)str.length()-1 )
+            while ( i<(int)length-1 )
             {
-                outString->append( str.c_str() + i, 1 );
+                outString->append( str + i, 1 );
                 ++i;
                 if ( str[i] == ';' )
                     break;
@@ -122,6 +490,7 @@ TiXmlNode::TiXmlNode( NodeType _type ) : TiXmlBase()
 {
     parent = 0;
     type = _type;
+    value = 0;
     firstChild = 0;
     lastChild = 0;
     prev = 0;
@@ -140,12 +509,13 @@ TiXmlNode::~TiXmlNode()
         node = node->next;
         delete temp;
     }   
+    TiXmlName::Release( value );
 }
 
 
 void TiXmlNode::CopyTo( TiXmlNode* target ) const
 {
-    target->SetValue (value.c_str() );
+    target->SetValue (ValueTStr().c_str() );
     target->userData = userData; 
 }
 
@@ -164,6 +534,14 @@ void TiXmlNode::Clear()
 
     firstChild = 0;
     lastChild = 0;
+
+    // All nodes of a document are deleted now, so the memory of its arena can be reused
+    TiXmlDocument* document = ToDocument();
+    if ( document )
+    {
+        document->Arena()->Release();
+        document->ReleaseInSitu();
+    }
 }
 
 
@@ -325,10 +703,11 @@ bool TiXmlNode::RemoveChild( TiXmlNode* removeThis )
 
 const TiXmlNode* TiXmlNode::FirstChild( const char * _value ) const
 {
+    TiXmlValueMatch match( _value );
     const TiXmlNode* node;
     for ( node = firstChild; node; node = node->next )
     {
-        if ( strcmp( node->Value(), _value ) == 0 )
+        if ( match.Equals( node->value ) )
             return node;
     }
     return 0;
@@ -337,10 +716,11 @@ const TiXmlNode* TiXmlNode::FirstChild( const char * _value ) const
 
 const TiXmlNode* TiXmlNode::LastChild( const char * _value ) const
 {
+    TiXmlValueMatch match( _value );
     const TiXmlNode* node;
     for ( node = lastChild; node; node = node->prev )
     {
-        if ( strcmp( node->Value(), _value ) == 0 )
+        if ( match.Equals( node->value ) )
             return node;
     }
     return 0;
@@ -377,10 +757,11 @@ const TiXmlNode* TiXmlNode::IterateChildren( const char * val, const TiXmlNode*
 
 const TiXmlNode* TiXmlNode::NextSibling( const char * _value ) const 
 {
+    TiXmlValueMatch match( _value );
     const TiXmlNode* node;
     for ( node = next; node; node = node->next )
     {
-        if ( strcmp( node->Value(), _value ) == 0 )
+        if ( match.Equals( node->value ) )
             return node;
     }
     return 0;
@@ -389,10 +770,11 @@ const TiXmlNode* TiXmlNode::NextSibling( const char * _value ) const
 
 const TiXmlNode* TiXmlNode::PreviousSibling( const char * _value ) const
 {
+    TiXmlValueMatch match( _value );
     const TiXmlNode* node;
     for ( node = prev; node; node = node->prev )
     {
-        if ( strcmp( node->Value(), _value ) == 0 )
+        if ( match.Equals( node->value ) )
             return node;
     }
     return 0;
@@ -491,7 +873,7 @@ TiXmlElement::TiXmlElement (const char * _value)
     : TiXmlNode( TiXmlNode::ELEMENT )
 {
     firstChild = lastChild = 0;
-    value = _value;
+    SetValue( _value );
 }
 
 
@@ -500,7 +882,7 @@ TiXmlElement::TiXmlElement( const TIXML_STRING& _value )
     : TiXmlNode( TiXmlNode::ELEMENT )
 {
     firstChild = lastChild = 0;
-    value = _value;
+    SetValue( _value );
 }
 #endif
 
@@ -668,35 +1050,54 @@ int TiXmlElement::QueryDoubleAttribute( const TIXML_STRING& name, double* dval )
 
 void TiXmlElement::SetAttribute( const char * name, int val )
 {   
-    char buf[64];
-    #if defined(TIXML_SNPRINTF)     
-        TIXML_SNPRINTF( buf, sizeof(buf), "%d", val );
-    #else
-        sprintf( buf, "%d", val );
-    #endif
-    SetAttribute( name, buf );
+    TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
+    if ( attrib )
+    {
+        attrib->SetIntValue( val );
+    }
+    else
+    {
+        TiXmlDocument* document = GetDocument();
+        if ( document ) document->SetError( TIXML_ERROR_OUT_OF_MEMORY, 0, 0, TIXML_ENCODING_UNKNOWN );
+    }
 }
 
 
 #ifdef TIXML_USE_STL
 void TiXmlElement::SetAttribute( const TIXML_STRING& name, int val )
 {   
-   Ogre::StringStream oss;
-   oss << val;
-   SetAttribute( name, oss.str().c_str() );
+    SetAttribute( name.c_str(), val );
 }
 #endif
 
 
 void TiXmlElement::SetDoubleAttribute( const char * name, double val )
 {   
-    char buf[256];
-    #if defined(TIXML_SNPRINTF)     
-        TIXML_SNPRINTF( buf, sizeof(buf), "%f", val );
-    #else
-        sprintf( buf, "%f", val );
-    #endif
-    SetAttribute( name, buf );
+    TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
+    if ( attrib )
+    {
+        attrib->SetDoubleValue( val );
+    }
+    else
+    {
+        TiXmlDocument* document = GetDocument();
+        if ( document ) document->SetError( TIXML_ERROR_OUT_OF_MEMORY, 0, 0, TIXML_ENCODING_UNKNOWN );
+    }
+}
+
+
+void TiXmlElement::SetFloatAttribute( const char * name, float val )
+{   
+    TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
+    if ( attrib )
+    {
+        attrib->SetFloatValue( val );
+    }
+    else
+    {
+        TiXmlDocument* document = GetDocument();
+        if ( document ) document->SetError( TIXML_ERROR_OUT_OF_MEMORY, 0, 0, TIXML_ENCODING_UNKNOWN );
+    }
 }
 
 
@@ -754,21 +1155,17 @@ void TiXmlElement::SetAttribute( const TIXML_STRING& name, const TIXML_STRING& _
 #endif
 
 
-void TiXmlElement::Print( FILE* cfile, int depth ) const
+void TiXmlElement::PrintTo( TiXmlOutput* out, int depth ) const
 {
-    int i;
-    assert( cfile );
-    for ( i=0; i<depth; i++ ) {
-        fprintf( cfile, "    " );
-    }
-
-    fprintf( cfile, "<%s", value.c_str() );
+    out->Indent( depth );
+    out->Put( '<' );
+    out->Write( ValueTStr() );
 
     const TiXmlAttribute* attrib;
     for ( attrib = attributeSet.First(); attrib; attrib = attrib->Next() )
     {
-        fprintf( cfile, " " );
-        attrib->Print( cfile, depth );
+        out->Put( ' ' );
+        attrib->PrintTo( out, depth );
     }
 
     // There are 3 different formatting approaches:
@@ -778,31 +1175,33 @@ void TiXmlElement::Print( FILE* cfile, int depth ) const
     TiXmlNode* node;
     if ( !firstChild )
     {
-        fprintf( cfile, " />" );
+        out->Write( " />", 3 );
     }
     else if ( firstChild == lastChild && firstChild->ToText() )
     {
-        fprintf( cfile, ">" );
-        firstChild->Print( cfile, depth + 1 );
-        fprintf( cfile, "</%s>", value.c_str() );
+        out->Put( '>' );
+        firstChild->PrintTo( out, depth + 1 );
+        out->Write( "</", 2 );
+        out->Write( ValueTStr() );
+        out->Put( '>' );
     }
     else
     {
-        fprintf( cfile, ">" );
+        out->Put( '>' );
 
         for ( node = firstChild; node; node=node->NextSibling() )
         {
             if ( !node->ToText() )
             {
-                fprintf( cfile, "\n" );
+                out->NewLine();
             }
-            node->Print( cfile, depth+1 );
-        }
-        fprintf( cfile, "\n" );
-        for( i=0; i<depth; ++i ) {
-            fprintf( cfile, "    " );
+            node->PrintTo( out, depth+1 );
         }
-        fprintf( cfile, "</%s>", value.c_str() );
+        out->NewLine();
+        out->Indent( depth );
+        out->Write( "</", 2 );
+        out->Write( ValueTStr() );
+        out->Put( '>' );
     }
 }
 
@@ -869,37 +1268,53 @@ const char* TiXmlElement::GetText() const
 
 TiXmlDocument::TiXmlDocument() : TiXmlNode( TiXmlNode::DOCUMENT )
 {
-    tabsize = 4;
-    useMicrosoftBOM = false;
-    ClearError();
+    Init();
 }
 
 TiXmlDocument::TiXmlDocument( const char * documentName ) : TiXmlNode( TiXmlNode::DOCUMENT )
 {
-    tabsize = 4;
-    useMicrosoftBOM = false;
-    value = documentName;
-    ClearError();
+    Init();
+    SetValue( documentName );
 }
 
 
 #ifdef TIXML_USE_STL
 TiXmlDocument::TiXmlDocument( const TIXML_STRING& documentName ) : TiXmlNode( TiXmlNode::DOCUMENT )
 {
-    tabsize = 4;
-    useMicrosoftBOM = false;
-    value = documentName;
-    ClearError();
+    Init();
+    SetValue( documentName );
 }
 #endif
 
 
 TiXmlDocument::TiXmlDocument( const TiXmlDocument& copy ) : TiXmlNode( TiXmlNode::DOCUMENT )
 {
+    Init();
     copy.CopyTo( this );
 }
 
 
+void TiXmlDocument::Init()
+{
+    tabsize = 4;
+    condenseWhiteSpace = TiXmlBase::IsWhiteSpaceCondensed();
+    trackLocations = true;
+    useMicrosoftBOM = false;
+    inSitu = false;
+    situBuffer = 0;
+    situLength = 0;
+    situMapped = false;
+    ClearError();
+}
+
+
+TiXmlDocument::~TiXmlDocument()
+{
+    // The children must be deleted before the arena they live in
+    Clear();
+}
+
+
 void TiXmlDocument::operator=( const TiXmlDocument& copy )
 {
     Clear();
@@ -938,10 +1353,18 @@ bool TiXmlDocument::LoadFile( const char* _filename, TiXmlEncoding encoding )
     // like a bug in the Microsoft STL implementation.
     // Add an extra string to avoid the crash.
     TIXML_STRING filename( _filename );
-    value = filename;
+    SetValue( filename.c_str() );
+
+    if ( inSitu )
+    {
+        Clear();
+        location.Clear();
+        if ( MapFile( Value() ) )
+            return ParseInSitu( encoding );
+    }
 
     // reading in binary mode so that tinyxml can normalize the EOL
-    FILE* file = fopen( value.c_str (), "rb" ); 
+    FILE* file = fopen( Value(), "rb" ); 
 
     if ( file )
     {
@@ -1020,6 +1443,15 @@ bool TiXmlDocument::LoadFile( FILE* file, TiXmlEncoding encoding )
     const char* p = buf;
 
     buf[length] = 0;
+    if ( inSitu )
+    {
+        // The buffer is kept; the attribute values point into it
+        situBuffer = buf;
+        situLength = length;
+        situMapped = false;
+        return ParseInSitu( encoding );
+    }
+
     while( *p ) {
         assert( p < (buf+length) );
         if ( *p == 0xa ) {
@@ -1071,6 +1503,117 @@ bool TiXmlDocument::LoadFile( FILE* file, TiXmlEncoding encoding )
 }
 
 
+bool TiXmlDocument::MapFile( const char* filename )
+{
+    // The bytes after the end of the file up to the end of its last page are zero, so they
+    // terminate the buffer. A file that ends at a page boundary has no room for that.
+#if defined( _WIN32 )
+    HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    if ( file == INVALID_HANDLE_VALUE )
+        return false;
+
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo( &systemInfo );
+    LARGE_INTEGER fileSize;
+    if (    !GetFileSizeEx( file, &fileSize )
+         || fileSize.QuadPart == 0
+         || fileSize.QuadPart % systemInfo.dwPageSize == 0 )
+    {
+        CloseHandle( file );
+        return false;
+    }
+
+    // The view keeps the file and the mapping open
+    HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+    CloseHandle( file );
+    if ( !mapping )
+        return false;
+    void* data = MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 );
+    CloseHandle( mapping );
+    if ( !data )
+        return false;
+
+    situLength = (size_t) fileSize.QuadPart;
+#else
+    int file = open( filename, O_RDONLY );
+    if ( file < 0 )
+        return false;
+
+    struct stat fileStat;
+    if (    fstat( file, &fileStat ) != 0
+         || !S_ISREG( fileStat.st_mode )
+         || fileStat.st_size == 0
+         || fileStat.st_size % sysconf( _SC_PAGESIZE ) == 0 )
+    {
+        close( file );
+        return false;
+    }
+
+    // The mapping stays valid after closing the file descriptor
+    void* data = mmap( 0, (size_t) fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0 );
+    close( file );
+    if ( data == MAP_FAILED )
+        return false;
+
+    situLength = (size_t) fileStat.st_size;
+#endif
+    situBuffer = (char*) data;
+    situMapped = true;
+    return true;
+}
+
+
+bool TiXmlDocument::ParseInSitu( TiXmlEncoding encoding )
+{
+    // Normalise the line endings the same way LoadFile( FILE* ) does. Nothing is written
+    // before the first carriage return, so files without them are never copied.
+    char* out = (char*) memchr( situBuffer, 0xd, situLength );
+    if ( out )
+    {
+        const char* p = out;
+        const char* end = situBuffer + situLength;
+        while ( p < end )
+        {
+            if ( *p == 0xd )
+            {
+                *out++ = 0xa;
+                if ( ++p < end && *p == 0xa )
+                    ++p;
+            }
+            else
+            {
+                *out++ = *p++;
+            }
+        }
+        *out = 0;
+    }
+
+    Parse( situBuffer, 0, encoding );
+    return !Error();
+}
+
+
+void TiXmlDocument::ReleaseInSitu()
+{
+    if ( situMapped )
+    {
+#if defined( _WIN32 )
+        UnmapViewOfFile( situBuffer );
+#else
+        munmap( situBuffer, situLength );
+#endif
+    }
+    else
+    {
+        delete [] situBuffer;
+    }
+    situBuffer = 0;
+    situLength = 0;
+    situMapped = false;
+}
+
+
 bool TiXmlDocument::SaveFile( const char * filename ) const
 {
     // The old c stuff lives on...
@@ -1086,6 +1629,14 @@ bool TiXmlDocument::SaveFile( const char * filename ) const
 
 
 bool TiXmlDocument::SaveFile( FILE* fp ) const
+{
+    TiXmlOutput out( fp );
+    SaveFile( &out );
+    return (ferror(fp) == 0);
+}
+
+
+bool TiXmlDocument::SaveFile( TiXmlOutput* out ) const
 {
     if ( useMicrosoftBOM ) 
     {
@@ -1093,12 +1644,12 @@ bool TiXmlDocument::SaveFile( FILE* fp ) const
         const unsigned char TIXML_UTF_LEAD_1 = 0xbbU;
         const unsigned char TIXML_UTF_LEAD_2 = 0xbfU;
 
-        fputc( TIXML_UTF_LEAD_0, fp );
-        fputc( TIXML_UTF_LEAD_1, fp );
-        fputc( TIXML_UTF_LEAD_2, fp );
+        out->Put( (char) TIXML_UTF_LEAD_0 );
+        out->Put( (char) TIXML_UTF_LEAD_1 );
+        out->Put( (char) TIXML_UTF_LEAD_2 );
     }
-    Print( fp, 0 );
-    return (ferror(fp) == 0);
+    PrintTo( out, 0 );
+    return out->Flush();
 }
 
 
@@ -1108,6 +1659,8 @@ void TiXmlDocument::CopyTo( TiXmlDocument* target ) const
 
     target->error = error;
     target->errorDesc = errorDesc.c_str ();
+    target->condenseWhiteSpace = condenseWhiteSpace;
+    target->trackLocations = trackLocations;
 
     TiXmlNode* node = 0;
     for ( node = firstChild; node; node = node->NextSibling() )
@@ -1128,13 +1681,12 @@ TiXmlNode* TiXmlDocument::Clone() const
 }
 
 
-void TiXmlDocument::Print( FILE* cfile, int depth ) const
+void TiXmlDocument::PrintTo( TiXmlOutput* out, int depth ) const
 {
-    assert( cfile );
     for ( const TiXmlNode* node=FirstChild(); node; node=node->NextSibling() )
     {
-        node->Print( cfile, depth );
-        fprintf( cfile, "\n" );
+        node->PrintTo( out, depth );
+        out->NewLine();
     }
 }
 
@@ -1153,11 +1705,33 @@ bool TiXmlDocument::Accept( TiXmlVisitor* visitor ) const
 }
 
 
+void TiXmlAttribute::SetName( const char* _name )
+{
+    const TiXmlName* old = name;
+    name = TiXmlName::Create( _name, strlen( _name ) );
+    TiXmlName::Release( old );
+    if ( set )
+        set->Rename( this );
+}
+
+
+#ifdef TIXML_USE_STL
+void TiXmlAttribute::SetName( const TIXML_STRING& _name )
+{
+    const TiXmlName* old = name;
+    name = TiXmlName::Create( _name.c_str(), _name.length() );
+    TiXmlName::Release( old );
+    if ( set )
+        set->Rename( this );
+}
+#endif
+
+
 const TiXmlAttribute* TiXmlAttribute::Next() const
 {
     // We are using knowledge of the sentinel. The sentinel
     // have a value or name.
-    if ( next->value.empty() && next->name.empty() )
+    if ( next->value.empty() && next->NameTStr().empty() )
         return 0;
     return next;
 }
@@ -1167,7 +1741,7 @@ TiXmlAttribute* TiXmlAttribute::Next()
 {
     // We are using knowledge of the sentinel. The sentinel
     // have a value or name.
-    if ( next->value.empty() && next->name.empty() )
+    if ( next->value.empty() && next->NameTStr().empty() )
         return 0;
     return next;
 }
@@ -1177,7 +1751,7 @@ const TiXmlAttribute* TiXmlAttribute::Previous() const
 {
     // We are using knowledge of the sentinel. The sentinel
     // have a value or name.
-    if ( prev->value.empty() && prev->name.empty() )
+    if ( prev->value.empty() && prev->NameTStr().empty() )
         return 0;
     return prev;
 }
@@ -1187,82 +1761,160 @@ TiXmlAttribute* TiXmlAttribute::Previous()
 {
     // We are using knowledge of the sentinel. The sentinel
     // have a value or name.
-    if ( prev->value.empty() && prev->name.empty() )
+    if ( prev->value.empty() && prev->NameTStr().empty() )
         return 0;
     return prev;
 }
 */
 
-void TiXmlAttribute::Print( FILE* cfile, int /*depth*/, TIXML_STRING* str ) const
+void TiXmlAttribute::Print( FILE* cfile, int depth, TIXML_STRING* str ) const
 {
-    TIXML_STRING n, v;
+    if ( cfile )
+    {
+        TiXmlOutput out( cfile );
+        PrintTo( &out, depth );
+    }
+    if ( str )
+    {
+        TiXmlOutput out( str );
+        PrintTo( &out, depth );
+    }
+}
 
-    PutString( name, &n );
-    PutString( value, &v );
 
-    if (value.find ('\"') == TIXML_STRING::npos) {
-        if ( cfile ) {
-        fprintf (cfile, "%s=\"%s\"", n.c_str(), v.c_str() );
-        }
-        if ( str ) {
-            (*str) += n; (*str) += "=\""; (*str) += v; (*str) += "\"";
-        }
+void TiXmlAttribute::PrintTo( TiXmlOutput* out, int /*depth*/ ) const
+{
+    TIXML_STRING* escaped = out->Scratch();
+    PutString( NameTStr(), escaped );
+    out->Write( *escaped );
+
+    if ( valueType != TEXT_VALUE )
+    {
+        // Numbers need no escaping and are not kept as text
+        char buffer[ Ogre::NumberFormat::BUFFER_SIZE ];
+        size_t length = FormatNumber( buffer );
+        out->Write( "=\"", 2 );
+        out->Write( buffer, length );
+        out->Put( '\"' );
+        return;
     }
-    else {
-        if ( cfile ) {
-        fprintf (cfile, "%s='%s'", n.c_str(), v.c_str() );
-        }
-        if ( str ) {
-            (*str) += n; (*str) += "='"; (*str) += v; (*str) += "'";
-        }
+
+    const char* _value = Value();
+    const char quote = strchr( _value, '\"' ) ? '\'' : '\"';
+    out->Put( '=' );
+    out->Put( quote );
+    escaped = out->Scratch();
+    PutString( _value, strlen( _value ), escaped );
+    out->Write( *escaped );
+    out->Put( quote );
+}
+
+
+const TIXML_STRING& TiXmlAttribute::ValueTStr() const
+{
+    // Only the place where the value is kept changes, not the value itself
+    TiXmlAttribute* self = const_cast< TiXmlAttribute* >( this );
+    if ( situValue )
+    {
+        self->value = situValue;
+        self->situValue = 0;
+    }
+    else if ( valueType != TEXT_VALUE && value.empty() )
+    {
+        char buffer[ Ogre::NumberFormat::BUFFER_SIZE ];
+        size_t length = FormatNumber( buffer );
+        self->value.assign( buffer, length );
+    }
+    return value;
+}
+
+
+size_t TiXmlAttribute::FormatNumber( char* buffer ) const
+{
+    switch ( valueType )
+    {
+    case INT_VALUE:
+        return Ogre::NumberFormat::formatInt( buffer, number.i );
+    case FLOAT_VALUE:
+        return Ogre::NumberFormat::formatFloat( buffer, number.f );
+    case DOUBLE_VALUE:
+        return Ogre::NumberFormat::formatDouble( buffer, number.d );
+    default:
+        buffer[0] = 0;
+        return 0;
     }
 }
 
 
 int TiXmlAttribute::QueryIntValue( int* ival ) const
 {
-    if ( sscanf( value.c_str(), "%d", ival ) == 1 )
+    if ( valueType == INT_VALUE )
+    {
+        *ival = number.i;
+        return TIXML_SUCCESS;
+    }
+    if ( Ogre::NumberFormat::parseInt( Value(), *ival ) )
         return TIXML_SUCCESS;
     return TIXML_WRONG_TYPE;
 }
 
 int TiXmlAttribute::QueryDoubleValue( double* dval ) const
 {
-    if ( sscanf( value.c_str(), "%lf", dval ) == 1 )
+    switch ( valueType )
+    {
+    case INT_VALUE:
+        *dval = number.i;
+        return TIXML_SUCCESS;
+    case FLOAT_VALUE:
+        *dval = number.f;
+        return TIXML_SUCCESS;
+    case DOUBLE_VALUE:
+        *dval = number.d;
+        return TIXML_SUCCESS;
+    default:
+        break;
+    }
+    if ( Ogre::NumberFormat::parseDouble( Value(), *dval ) )
         return TIXML_SUCCESS;
     return TIXML_WRONG_TYPE;
 }
 
 void TiXmlAttribute::SetIntValue( int _value )
 {
-    char buf [64];
-    #if defined(TIXML_SNPRINTF)     
-        TIXML_SNPRINTF(buf, sizeof(buf), "%d", _value);
-    #else
-        sprintf (buf, "%d", _value);
-    #endif
-    SetValue (buf);
+    value = "";
+    situValue = 0;
+    valueType = INT_VALUE;
+    number.i = _value;
+}
+
+void TiXmlAttribute::SetFloatValue( float _value )
+{
+    value = "";
+    situValue = 0;
+    valueType = FLOAT_VALUE;
+    number.f = _value;
 }
 
 void TiXmlAttribute::SetDoubleValue( double _value )
 {
-    char buf [256];
-    #if defined(TIXML_SNPRINTF)     
-        TIXML_SNPRINTF( buf, sizeof(buf), "%lf", _value);
-    #else
-        sprintf (buf, "%lf", _value);
-    #endif
-    SetValue (buf);
+    value = "";
+    situValue = 0;
+    valueType = DOUBLE_VALUE;
+    number.d = _value;
 }
 
 int TiXmlAttribute::IntValue() const
 {
-    return atoi (value.c_str ());
+    int i = 0;
+    QueryIntValue( &i );
+    return i;
 }
 
 double  TiXmlAttribute::DoubleValue() const
 {
-    return atof (value.c_str ());
+    double d = 0.0;
+    QueryDoubleValue( &d );
+    return d;
 }
 
 
@@ -1279,14 +1931,12 @@ void TiXmlComment::operator=( const TiXmlComment& base )
 }
 
 
-void TiXmlComment::Print( FILE* cfile, int depth ) const
+void TiXmlComment::PrintTo( TiXmlOutput* out, int depth ) const
 {
-    assert( cfile );
-    for ( int i=0; i<depth; i++ )
-    {
-        fprintf( cfile,  "    " );
-    }
-    fprintf( cfile, "<!--%s-->", value.c_str() );
+    out->Indent( depth );
+    out->Write( "<!--", 4 );
+    out->Write( ValueTStr() );
+    out->Write( "-->", 3 );
 }
 
 
@@ -1314,23 +1964,22 @@ TiXmlNode* TiXmlComment::Clone() const
 }
 
 
-void TiXmlText::Print( FILE* cfile, int depth ) const
+void TiXmlText::PrintTo( TiXmlOutput* out, int depth ) const
 {
-    assert( cfile );
     if ( cdata )
     {
-        int i;
-        fprintf( cfile, "\n" );
-        for ( i=0; i<depth; i++ ) {
-            fprintf( cfile, "    " );
-        }
-        fprintf( cfile, "<![CDATA[%s]]>\n", value.c_str() );    // unformatted output
+        out->NewLine();
+        out->Indent( depth );
+        out->Write( "<![CDATA[", 9 );
+        out->Write( ValueTStr() );               // unformatted output
+        out->Write( "]]>", 3 );
+        out->NewLine();
     }
     else
     {
-        TIXML_STRING buffer;
-        PutString( value, &buffer );
-        fprintf( cfile, "%s", buffer.c_str() );
+        TIXML_STRING* escaped = out->Scratch();
+        PutString( ValueTStr(), escaped );
+        out->Write( *escaped );
     }
 }
 
@@ -1399,25 +2048,35 @@ void TiXmlDeclaration::operator=( const TiXmlDeclaration& copy )
 }
 
 
-void TiXmlDeclaration::Print( FILE* cfile, int /*depth*/, TIXML_STRING* str ) const
+void TiXmlDeclaration::Print( FILE* cfile, int depth, TIXML_STRING* str ) const
 {
-    if ( cfile ) fprintf( cfile, "<?xml " );
-    if ( str )   (*str) += "<?xml ";
+    if ( cfile )
+    {
+        TiXmlOutput out( cfile );
+        PrintTo( &out, depth );
+    }
+    if ( str )
+    {
+        TiXmlOutput out( str );
+        PrintTo( &out, depth );
+    }
+}
+
+
+void TiXmlDeclaration::PrintTo( TiXmlOutput* out, int /*depth*/ ) const
+{
+    out->Write( "<?xml ", 6 );
 
     if ( !version.empty() ) {
-        if ( cfile ) fprintf (cfile, "version=\"%s\" ", version.c_str ());
-        if ( str ) { (*str) += "version=\""; (*str) += version; (*str) += "\" "; }
+        out->Write( "version=\"", 9 ); out->Write( version ); out->Write( "\" ", 2 );
     }
     if ( !encoding.empty() ) {
-        if ( cfile ) fprintf (cfile, "encoding=\"%s\" ", encoding.c_str ());
-        if ( str ) { (*str) += "encoding=\""; (*str) += encoding; (*str) += "\" "; }
+        out->Write( "encoding=\"", 10 ); out->Write( encoding ); out->Write( "\" ", 2 );
     }
     if ( !standalone.empty() ) {
-        if ( cfile ) fprintf (cfile, "standalone=\"%s\" ", standalone.c_str ());
-        if ( str ) { (*str) += "standalone=\""; (*str) += standalone; (*str) += "\" "; }
+        out->Write( "standalone=\"", 12 ); out->Write( standalone ); out->Write( "\" ", 2 );
     }
-    if ( cfile ) fprintf( cfile, "?>" );
-    if ( str )   (*str) += "?>";
+    out->Write( "?>", 2 );
 }
 
 
@@ -1449,11 +2108,12 @@ TiXmlNode* TiXmlDeclaration::Clone() const
 }
 
 
-void TiXmlUnknown::Print( FILE* cfile, int depth ) const
+void TiXmlUnknown::PrintTo( TiXmlOutput* out, int depth ) const
 {
-    for ( int i=0; i<depth; i++ )
-        fprintf( cfile, "    " );
-    fprintf( cfile, "<%s>", value.c_str() );
+    out->Indent( depth );
+    out->Put( '<' );
+    out->Write( ValueTStr() );
+    out->Put( '>' );
 }
 
 
@@ -1481,7 +2141,12 @@ TiXmlNode* TiXmlUnknown::Clone() const
 }
 
 
-TiXmlAttributeSet::TiXmlAttributeSet()
+TiXmlAttributeSet::TiXmlAttributeSet() :
+    entries( inlineEntries ),
+    count( 0 ),
+    capacity( INLINE_CAPACITY ),
+    index( 0 ),
+    indexSize( 0 )
 {
     sentinel.next = &sentinel;
     sentinel.prev = &sentinel;
@@ -1492,6 +2157,10 @@ TiXmlAttributeSet::~TiXmlAttributeSet()
 {
     assert( sentinel.next == &sentinel );
     assert( sentinel.prev == &sentinel );
+
+    if ( entries != inlineEntries )
+        delete [] entries;
+    delete [] index;
 }
 
 
@@ -1508,6 +2177,37 @@ void TiXmlAttributeSet::Add( TiXmlAttribute* addMe )
 
     sentinel.prev->next = addMe;
     sentinel.prev      = addMe;
+    addMe->set = this;
+
+    if ( count == capacity )
+    {
+        Entry* grown = new Entry[ capacity * 2 ];
+        memcpy( grown, entries, count * sizeof( Entry ) );
+        if ( entries != inlineEntries )
+            delete [] entries;
+        entries = grown;
+        capacity *= 2;
+    }
+
+    // Parsed attributes already have the hash of their name
+    const TIXML_STRING& name = addMe->NameTStr();
+    entries[ count ].hash = ( addMe->name && addMe->name->table ) ? addMe->name->hash : TiXmlNameTable::Hash( name.c_str(), name.length() );
+    entries[ count ].attribute = addMe;
+    ++count;
+
+    // Keep the index at most half full
+    if ( count > INDEX_THRESHOLD && count * 2 > indexSize )
+    {
+        BuildIndex();
+    }
+    else if ( index )
+    {
+        int mask = indexSize - 1;
+        int slot = entries[ count - 1 ].hash & mask;
+        while ( index[ slot ] )
+            slot = ( slot + 1 ) & mask;
+        index[ slot ] = count;
+    }
 }
 
 void TiXmlAttributeSet::Remove( TiXmlAttribute* removeMe )
@@ -1522,6 +2222,18 @@ void TiXmlAttributeSet::Remove( TiXmlAttribute* removeMe )
             node->next->prev = node->prev;
             node->next = 0;
             node->prev = 0;
+            node->set = 0;
+
+            // The entries stay in the order of the list
+            int i = 0;
+            while ( entries[ i ].attribute != removeMe )
+                ++i;
+            memmove( entries + i, entries + i + 1, ( count - i - 1 ) * sizeof( Entry ) );
+            --count;
+
+            // Removing is rare, so the index is simply rebuilt
+            if ( index )
+                BuildIndex();
             return;
         }
     }
@@ -1529,52 +2241,106 @@ void TiXmlAttributeSet::Remove( TiXmlAttribute* removeMe )
 }
 
 
-#ifdef TIXML_USE_STL
-const TiXmlAttribute* TiXmlAttributeSet::Find( const TIXML_STRING& name ) const
+void TiXmlAttributeSet::Rename( TiXmlAttribute* attribute )
 {
-    for( const TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
-    {
-        if ( node->name == name )
-            return node;
-    }
-    return 0;
+    int i = 0;
+    while ( i < count && entries[ i ].attribute != attribute )
+        ++i;
+    assert( i < count );
+    if ( i == count )
+        return;
+
+    const TIXML_STRING& name = attribute->NameTStr();
+    entries[ i ].hash = TiXmlNameTable::Hash( name.c_str(), name.length() );
+    if ( index )
+        BuildIndex();
 }
 
-/*
-TiXmlAttribute* TiXmlAttributeSet::Find( const TIXML_STRING& name )
+
+TiXmlAttribute* TiXmlAttributeSet::FindOrCreate( const char* _name )
 {
-    for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+    TiXmlAttribute* attrib = Find( _name );
+    if ( !attrib )
     {
-        if ( node->name == name )
-            return node;
+        attrib = new TiXmlAttribute();
+        if ( attrib )
+        {
+            attrib->SetName( _name );
+            Add( attrib );
+        }
     }
-    return 0;
+    return attrib;
 }
-*/
-#endif
 
 
-const TiXmlAttribute* TiXmlAttributeSet::Find( const char* name ) const
+int TiXmlAttributeSet::FindEntry( const char* name, size_t length ) const
 {
-    for( const TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+    unsigned int hash = TiXmlNameTable::Hash( name, length );
+    if ( index )
     {
-        if ( strcmp( node->name.c_str(), name ) == 0 )
-            return node;
+        int mask = indexSize - 1;
+        for( int slot = hash & mask; index[ slot ]; slot = ( slot + 1 ) & mask )
+        {
+            const Entry& entry = entries[ index[ slot ] - 1 ];
+            if (    entry.hash == hash
+                 && entry.attribute->NameTStr().length() == length
+                 && memcmp( entry.attribute->NameTStr().c_str(), name, length ) == 0 )
+                return index[ slot ] - 1;
+        }
+        return -1;
     }
-    return 0;
+
+    for( int i = 0; i < count; ++i )
+    {
+        const Entry& entry = entries[ i ];
+        if (    entry.hash == hash
+             && entry.attribute->NameTStr().length() == length
+             && memcmp( entry.attribute->NameTStr().c_str(), name, length ) == 0 )
+            return i;
+    }
+    return -1;
 }
 
-/*
-TiXmlAttribute* TiXmlAttributeSet::Find( const char* name )
+
+void TiXmlAttributeSet::BuildIndex()
 {
-    for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+    delete [] index;
+    index = 0;
+    indexSize = 0;
+    if ( count <= INDEX_THRESHOLD )
+        return;
+
+    indexSize = 1;
+    while ( indexSize < count * 4 )
+        indexSize *= 2;
+    index = new int[ indexSize ];
+    memset( index, 0, indexSize * sizeof( int ) );
+
+    int mask = indexSize - 1;
+    for( int i = 0; i < count; ++i )
     {
-        if ( strcmp( node->name.c_str(), name ) == 0 )
-            return node;
+        int slot = entries[ i ].hash & mask;
+        while ( index[ slot ] )
+            slot = ( slot + 1 ) & mask;
+        index[ slot ] = i + 1;
     }
-    return 0;
 }
-*/
+
+
+#ifdef TIXML_USE_STL
+const TiXmlAttribute* TiXmlAttributeSet::Find( const TIXML_STRING& name ) const
+{
+    int i = FindEntry( name.c_str(), name.length() );
+    return ( i < 0 ) ? 0 : entries[ i ].attribute;
+}
+#endif
+
+
+const TiXmlAttribute* TiXmlAttributeSet::Find( const char* name ) const
+{
+    int i = FindEntry( name, strlen( name ) );
+    return ( i < 0 ) ? 0 : entries[ i ].attribute;
+}
 
 #ifdef TIXML_USE_STL    
 std::istream& operator>> (std::istream & in, TiXmlNode & base)
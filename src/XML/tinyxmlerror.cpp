@@ -31,7 +31,7 @@ distribution.
 // It also cleans up the code a bit.
 //
 
-const char* TiXmlBase::errorString[ TIXML_ERROR_STRING_COUNT ] =
+const char* const TiXmlBase::errorString[ TIXML_ERROR_STRING_COUNT ] =
 {
     "No error",
     "Error",
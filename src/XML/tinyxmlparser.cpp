@@ -26,6 +26,15 @@ distribution.
 #include <stddef.h>
 
 #include "XML/tinyxml.h"
+#include "NumberFormat.h"
+
+#if defined( _M_X64 ) || defined( __x86_64__ ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) || defined( __SSE2__ )
+#   define TIXML_SCAN_SSE2
+#   if defined( _MSC_VER )
+#       include <intrin.h>
+#   endif
+#   include <immintrin.h>
+#endif
 
 //#define DEBUG_PARSER
 #if defined( DEBUG_PARSER )
@@ -42,7 +51,7 @@ distribution.
 // Note tha "PutString" hardcodes the same list. This
 // is less flexible than it appears. Changing the entries
 // or order will break putstring.   
-TiXmlBase::Entity TiXmlBase::entity[ NUM_ENTITY ] = 
+const TiXmlBase::Entity TiXmlBase::entity[ NUM_ENTITY ] = 
 {
     { "&amp;",  5, '&' },
     { "&lt;",   4, '<' },
@@ -175,32 +184,52 @@ class TiXmlParsingData
     friend class TiXmlDocument;
   public:
     void Stamp( const char* now, TiXmlEncoding encoding );
-
-    const TiXmlCursor& Cursor() { return cursor; }
+    // Stamp the location of an error. Without location tracking the location is found by
+    // walking from the start of the data, which is only done once.
+    void StampError( const char* now, TiXmlEncoding encoding );
+    // Stamp the text before an in-situ load rewrites it, also when the locations are not tracked.
+    // Decoding an entity moves the rest of the text, which can't be walked afterwards.
+    void StampRewrite( const char* now, TiXmlEncoding encoding );
+
+    // The location of the last stamp; unknown (-1) when the locations are not tracked.
+    TiXmlCursor Cursor() const { return trackLocations ? cursor : TiXmlCursor(); }
+    // The white space setting of the document that is parsed.
+    bool IsWhiteSpaceCondensed() const { return condenseWhiteSpace; }
 
   private:
     // Only used by the document!
-    TiXmlParsingData( const char* start, int _tabsize, int row, int col )
+    TiXmlParsingData( const char* start, int _tabsize, int row, int col, bool _condenseWhiteSpace, bool _trackLocations )
     {
         assert( start );
         stamp = start;
         tabsize = _tabsize;
         cursor.row = row;
         cursor.col = col;
+        condenseWhiteSpace = _condenseWhiteSpace;
+        trackLocations = _trackLocations;
     }
 
     TiXmlCursor     cursor;
     const char*     stamp;
     int             tabsize;
+    bool            condenseWhiteSpace;
+    bool            trackLocations;
 };
 
 
+// Nodes that are parsed without a document use the global white space setting.
+inline static bool IsWhiteSpaceCondensed( const TiXmlParsingData* data )
+{
+    return data ? data->IsWhiteSpaceCondensed() : TiXmlBase::IsWhiteSpaceCondensed();
+}
+
+
 void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
 {
     assert( now );
 
-    // Do nothing if the tabsize is 0.
-    if ( tabsize < 1 )
+    // Do nothing if the tabsize is 0 or the locations are not tracked.
+    if ( tabsize < 1 || !trackLocations )
     {
         return;
     }
@@ -219,9 +248,11 @@ void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
         // Code contributed by Fletcher Dunn: (modified by lee)
         switch (*pU) {
             case 0:
-                // We *should* never get here, but in case we do, don't
-                // advance past the terminating null character, ever
-                return;
+                // The end of the data is never before now, so this is the terminator an
+                // in-situ load wrote over a closing quote. It takes the column of the quote.
+                ++p;
+                ++col;
+                break;
 
             case '\r':
                 // bump down to the next line
@@ -276,6 +307,12 @@ void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
                         else
                             { p +=3; ++col; }   // A normal character.
                     }
+                    else
+                    {
+                        // A broken character before an in-situ terminator
+                        ++p;
+                        ++col;
+                    }
                 }
                 else
                 {
@@ -313,6 +350,231 @@ void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
 }
 
 
+void TiXmlParsingData::StampError( const char* now, TiXmlEncoding encoding )
+{
+    // Without tracking, stamp and cursor are still at the start of the data
+    trackLocations = true;
+    Stamp( now, encoding );
+}
+
+
+void TiXmlParsingData::StampRewrite( const char* now, TiXmlEncoding encoding )
+{
+    bool track = trackLocations;
+    trackLocations = true;
+    Stamp( now, encoding );
+    trackLocations = track;
+}
+
+
+/*  Scanners for the long runs in large documents: the indentation between elements and
+    the text of attribute values. They return the first byte that needs a closer look,
+    which the scalar code after them handles as before. The vector versions only use
+    aligned loads, so they never read past the page of the terminating zero; the bytes
+    before p in the first block are masked off. The fastest version the cpu supports
+    is chosen the first time a scanner is used.
+*/
+
+// First byte from p on that is not ' ', '\t', '\n' or '\r'. Other white space stops it too.
+typedef const char* (*TiXmlScanWhiteSpaceFunction)( const char* p );
+// First byte from p on that is zero, '&', endChar or not ascii.
+typedef const char* (*TiXmlScanTextFunction)( const char* p, char endChar );
+
+#ifdef TIXML_SCAN_SSE2
+
+// The scanners read whole aligned blocks around the text, which address sanitizers report
+#if defined( __clang__ ) || defined( __GNUC__ )
+#   define TIXML_SCAN_NO_SANITIZE __attribute__(( no_sanitize_address ))
+#   define TIXML_SCAN_AVX2 __attribute__(( target( "avx2" ) )) TIXML_SCAN_NO_SANITIZE
+#else
+#   define TIXML_SCAN_NO_SANITIZE
+#   define TIXML_SCAN_AVX2
+#endif
+
+inline static int FirstBit( unsigned int bits )
+{
+#if defined( _MSC_VER )
+    unsigned long index;
+    _BitScanForward( &index, bits );
+    return (int) index;
+#else
+    return __builtin_ctz( bits );
+#endif
+}
+
+TIXML_SCAN_NO_SANITIZE static const char* ScanWhiteSpaceSSE2( const char* p )
+{
+    const int offset = (int) ( (size_t) p & 15 );
+    const char* block = p - offset;
+    unsigned int mask = 0xffffu << offset;
+    for( ;; )
+    {
+        __m128i c = _mm_load_si128( (const __m128i*) block );
+        __m128i space = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( c, _mm_set1_epi8( ' ' ) ),
+                                                    _mm_cmpeq_epi8( c, _mm_set1_epi8( '\t' ) ) ),
+                                      _mm_or_si128( _mm_cmpeq_epi8( c, _mm_set1_epi8( '\n' ) ),
+                                                    _mm_cmpeq_epi8( c, _mm_set1_epi8( '\r' ) ) ) );
+        unsigned int bits = ~(unsigned int) _mm_movemask_epi8( space ) & mask;
+        if ( bits )
+            return block + FirstBit( bits );
+        block += 16;
+        mask = 0xffffu;
+    }
+}
+
+TIXML_SCAN_NO_SANITIZE static const char* ScanTextSSE2( const char* p, char endChar )
+{
+    const int offset = (int) ( (size_t) p & 15 );
+    const char* block = p - offset;
+    unsigned int mask = 0xffffu << offset;
+    for( ;; )
+    {
+        __m128i c = _mm_load_si128( (const __m128i*) block );
+        __m128i stop = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( c, _mm_setzero_si128() ),
+                                                   _mm_cmpeq_epi8( c, _mm_set1_epi8( '&' ) ) ),
+                                     _mm_or_si128( _mm_cmpeq_epi8( c, _mm_set1_epi8( endChar ) ), c ) );
+        unsigned int bits = (unsigned int) _mm_movemask_epi8( stop ) & mask;
+        if ( bits )
+            return block + FirstBit( bits );
+        block += 16;
+        mask = 0xffffu;
+    }
+}
+
+TIXML_SCAN_AVX2 static const char* ScanWhiteSpaceAVX2( const char* p )
+{
+    const int offset = (int) ( (size_t) p & 31 );
+    const char* block = p - offset;
+    unsigned int mask = 0xffffffffu << offset;
+    for( ;; )
+    {
+        __m256i c = _mm256_load_si256( (const __m256i*) block );
+        __m256i space = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( c, _mm256_set1_epi8( ' ' ) ),
+                                                          _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '\t' ) ) ),
+                                         _mm256_or_si256( _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '\n' ) ),
+                                                          _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '\r' ) ) ) );
+        unsigned int bits = ~(unsigned int) _mm256_movemask_epi8( space ) & mask;
+        if ( bits )
+            return block + FirstBit( bits );
+        block += 32;
+        mask = 0xffffffffu;
+    }
+}
+
+TIXML_SCAN_AVX2 static const char* ScanTextAVX2( const char* p, char endChar )
+{
+    const int offset = (int) ( (size_t) p & 31 );
+    const char* block = p - offset;
+    unsigned int mask = 0xffffffffu << offset;
+    for( ;; )
+    {
+        __m256i c = _mm256_load_si256( (const __m256i*) block );
+        __m256i stop = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( c, _mm256_setzero_si256() ),
+                                                         _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '&' ) ) ),
+                                        _mm256_or_si256( _mm256_cmpeq_epi8( c, _mm256_set1_epi8( endChar ) ), c ) );
+        unsigned int bits = (unsigned int) _mm256_movemask_epi8( stop ) & mask;
+        if ( bits )
+            return block + FirstBit( bits );
+        block += 32;
+        mask = 0xffffffffu;
+    }
+}
+
+// AVX2 needs support of both the cpu and the operating system (saving the ymm registers)
+static bool HasAVX2()
+{
+#if defined( _MSC_VER )
+    int info[4];
+    __cpuid( info, 0 );
+    if ( info[0] < 7 )
+        return false;
+    __cpuid( info, 1 );
+    const int osxsave = 1 << 27;
+    const int avx = 1 << 28;
+    if ( ( info[2] & ( osxsave | avx ) ) != ( osxsave | avx ) )
+        return false;
+    if ( ( _xgetbv( 0 ) & 6 ) != 6 )
+        return false;
+    __cpuidex( info, 7, 0 );
+    return ( info[1] & ( 1 << 5 ) ) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+}
+
+#else
+
+static const char* ScanWhiteSpaceScalar( const char* p )
+{
+    while ( *p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' )
+        ++p;
+    return p;
+}
+
+static const char* ScanTextScalar( const char* p, char endChar )
+{
+    while ( *p && *p != '&' && *p != endChar && !( *p & 0x80 ) )
+        ++p;
+    return p;
+}
+
+#endif
+
+struct TiXmlScanner
+{
+    TiXmlScanWhiteSpaceFunction scanWhiteSpace;
+    TiXmlScanTextFunction scanText;
+
+    TiXmlScanner()
+    {
+    #ifdef TIXML_SCAN_SSE2
+        if ( HasAVX2() )
+        {
+            scanWhiteSpace = ScanWhiteSpaceAVX2;
+            scanText = ScanTextAVX2;
+        }
+        else
+        {
+            scanWhiteSpace = ScanWhiteSpaceSSE2;
+            scanText = ScanTextSSE2;
+        }
+    #else
+        scanWhiteSpace = ScanWhiteSpaceScalar;
+        scanText = ScanTextScalar;
+    #endif
+    }
+};
+
+// The initialisation of a function-local static is thread safe, so documents on different
+// threads share the scanner without a race.
+static const TiXmlScanner& Scanner()
+{
+    static const TiXmlScanner scanner;
+    return scanner;
+}
+
+inline static bool IsScannedWhiteSpace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline static const char* ScanWhiteSpace( const char* p )
+{
+    // Most runs between attributes are empty or a single space; those are not worth a vector
+    if ( !IsScannedWhiteSpace( p[0] ) )
+        return p;
+    if ( !IsScannedWhiteSpace( p[1] ) )
+        return p + 1;
+    return Scanner().scanWhiteSpace( p + 2 );
+}
+
+inline static const char* ScanText( const char* p, char endChar )
+{
+    return Scanner().scanText( p, endChar );
+}
+
+
 const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 {
     if ( !p || !*p )
@@ -323,6 +585,7 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
     {
         while ( *p )
         {
+            p = ScanWhiteSpace( p );
             const unsigned char* pU = (const unsigned char*)p;
             
             // Skip the stupid Microsoft UTF-8 Byte order marks
@@ -356,6 +619,7 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
     }
     else
     {
+        p = ScanWhiteSpace( p );
 		while ( *p && ( IsWhiteSpace( *p ) || *p == '\n' || *p =='\r' ) )
             ++p;
     }
@@ -581,14 +845,25 @@ const char* TiXmlBase::ReadText(    const char* p,
                                     TiXmlEncoding encoding )
 {
     *text = "";
-    if (    !trimWhiteSpace         // certain tags always keep whitespace
-         || !condenseWhiteSpace )   // if true, whitespace is always kept
+    if ( !trimWhiteSpace )      // certain tags and documents always keep whitespace
     {
-        // Keep all the white space.
+        // Keep all the white space. Runs of plain ascii are copied at once if the
+        // text ends with a single character.
+        const bool scan = endTag[0] && !endTag[1] && !caseInsensitive;
         while (    p && *p
                 && !StringEqual( p, endTag, caseInsensitive, encoding )
               )
         {
+            if ( scan )
+            {
+                const char* run = ScanText( p, *endTag );
+                if ( run != p )
+                {
+                    text->append( p, run - p );
+                    p = run;
+                    continue;
+                }
+            }
             int len;
             char cArr[4] = { 0, 0, 0, 0 };
             p = GetChar( p, cArr, &len, encoding );
@@ -638,6 +913,38 @@ const char* TiXmlBase::ReadText(    const char* p,
     return p;
 }
 
+const char* TiXmlBase::ReadTextInSitu( char* p, const char** text, char endChar, TiXmlEncoding encoding )
+{
+    // A character never takes more room than the text it is read from, so the text can be
+    // written behind the read position.
+    char* out = p;
+    *text = out;
+    while ( p && *p && *p != endChar )
+    {
+        const char* run = ScanText( p, endChar );
+        if ( run != p )
+        {
+            if ( out != p )
+                memmove( out, p, run - p );
+            out += run - p;
+            p = const_cast< char* >( run );
+            continue;
+        }
+        int len;
+        char cArr[4] = { 0, 0, 0, 0 };
+        const char* next = GetChar( p, cArr, &len, encoding );
+        for( int i = 0; i < len; ++i )
+            *out++ = cArr[i];
+        p = const_cast< char* >( next );
+    }
+    if ( !p || !*p )
+        return 0;
+
+    // The end character is read already, so it can be replaced by the terminator
+    *out = 0;
+    return p + 1;
+}
+
 #ifdef TIXML_USE_STL
 
 void TiXmlDocument::StreamIn( std::istream * in, TIXML_STRING * tag )
@@ -730,7 +1037,7 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
         location.row = 0;
         location.col = 0;
     }
-    TiXmlParsingData data( p, TabSize(), location.row, location.col );
+    TiXmlParsingData data( p, TabSize(), location.row, location.col, condenseWhiteSpace, trackLocations );
     location = data.Cursor();
 
     if ( encoding == TIXML_ENCODING_UNKNOWN )
@@ -811,7 +1118,7 @@ void TiXmlDocument::SetError( int err, const char* pError, TiXmlParsingData* dat
     errorLocation.Clear();
     if ( pError && data )
     {
-        data->Stamp( pError, encoding );
+        data->StampError( pError, encoding );
         errorLocation = data->Cursor();
     }
 }
@@ -828,6 +1135,7 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
     }
 
     TiXmlDocument* doc = GetDocument();
+    TiXmlArena* arena = doc ? doc->Arena() : 0;
     p = SkipWhiteSpace( p, encoding );
 
     if ( !p || !*p )
@@ -852,21 +1160,21 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
         #ifdef DEBUG_PARSER
             TIXML_LOG( "XML parsing Declaration\n" );
         #endif
-        returnNode = new TiXmlDeclaration();
+        returnNode = new( arena ) TiXmlDeclaration();
     }
     else if ( StringEqual( p, commentHeader, false, encoding ) )
     {
         #ifdef DEBUG_PARSER
             TIXML_LOG( "XML parsing Comment\n" );
         #endif
-        returnNode = new TiXmlComment();
+        returnNode = new( arena ) TiXmlComment();
     }
     else if ( StringEqual( p, cdataHeader, false, encoding ) )
     {
         #ifdef DEBUG_PARSER
             TIXML_LOG( "XML parsing CDATA\n" );
         #endif
-        TiXmlText* text = new TiXmlText( "" );
+        TiXmlText* text = new( arena ) TiXmlText( "" );
         text->SetCDATA( true );
         returnNode = text;
     }
@@ -875,7 +1183,7 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
         #ifdef DEBUG_PARSER
             TIXML_LOG( "XML parsing Unknown(1)\n" );
         #endif
-        returnNode = new TiXmlUnknown();
+        returnNode = new( arena ) TiXmlUnknown();
     }
     else if (    IsAlpha( *(p+1), encoding )
               || *(p+1) == '_' )
@@ -883,14 +1191,14 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
         #ifdef DEBUG_PARSER
             TIXML_LOG( "XML parsing Element\n" );
         #endif
-        returnNode = new TiXmlElement( "" );
+        returnNode = new( arena ) TiXmlElement( "" );
     }
     else
     {
         #ifdef DEBUG_PARSER
             TIXML_LOG( "XML parsing Unknown(2)\n" );
         #endif
-        returnNode = new TiXmlUnknown();
+        returnNode = new( arena ) TiXmlUnknown();
     }
 
     if ( returnNode )
@@ -1076,15 +1384,22 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
     // Read the name.
     const char* pErr = p;
 
-    p = ReadName( p, &value, encoding );
+    TIXML_STRING name;
+    p = ReadName( p, &name, encoding );
     if ( !p || !*p )
     {
         if ( document ) document->SetError( TIXML_ERROR_FAILED_TO_READ_ELEMENT_NAME, pErr, data, encoding );
         return 0;
     }
 
+    // Point to the name in the table of the document, so lookups by name compare pointers
+    if ( document )
+        ReplaceValue( document->Names()->Intern( name.c_str(), name.length() ) );
+    else
+        ReplaceValue( TiXmlName::Create( name.c_str(), name.length() ) );
+
     TIXML_STRING endTag ("</");
-    endTag += value;
+    endTag += name;
     endTag += ">";
 
     // Check for and read attributes. Also look for an empty
@@ -1134,7 +1449,7 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
         else
         {
             // Try to read an attribute:
-            TiXmlAttribute* attrib = new TiXmlAttribute();
+            TiXmlAttribute* attrib = new( document ? document->Arena() : 0 ) TiXmlAttribute();
             if ( !attrib )
             {
                 if ( document ) document->SetError( TIXML_ERROR_OUT_OF_MEMORY, pErr, data, encoding );
@@ -1185,7 +1500,7 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
         if ( *p != '<' )
         {
             // Take what we have, make a text element.
-            TiXmlText* textNode = new TiXmlText( "" );
+            TiXmlText* textNode = new( document ? document->Arena() : 0 ) TiXmlText( "" );
 
             if ( !textNode )
             {
@@ -1193,7 +1508,7 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
                     return 0;
             }
 
-            if ( TiXmlBase::IsWhiteSpaceCondensed() )
+            if ( ::IsWhiteSpaceCondensed( data ) )
             {
                 p = textNode->Parse( p, data, encoding );
             }
@@ -1285,13 +1600,14 @@ const char* TiXmlUnknown::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
         return 0;
     }
     ++p;
-    value = "";
+    TIXML_STRING text;
 
     while ( p && *p && *p != '>' )
     {
-        value += *p;
+        text += *p;
         ++p;
     }
+    ReplaceValue( TiXmlName::Create( &text ) );
 
     if ( !p )
     {
@@ -1333,7 +1649,7 @@ void TiXmlComment::StreamIn( std::istream * in, TIXML_STRING * tag )
 const char* TiXmlComment::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
     TiXmlDocument* document = GetDocument();
-    value = "";
+    ReplaceValue( 0 );
 
     p = SkipWhiteSpace( p, encoding );
 
@@ -1351,7 +1667,9 @@ const char* TiXmlComment::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
         return 0;
     }
     p += strlen( startTag );
-    p = ReadText( p, &value, false, endTag, false, encoding );
+    TIXML_STRING text;
+    p = ReadText( p, &text, false, endTag, false, encoding );
+    ReplaceValue( TiXmlName::Create( &text ) );
     return p;
 }
 
@@ -1372,12 +1690,20 @@ const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlE
     }
     // Read the name, the '=' and the value.
     const char* pErr = p;
-    p = ReadName( p, &name, encoding );
+    TIXML_STRING parsedName;
+    p = ReadName( p, &parsedName, encoding );
     if ( !p || !*p )
     {
         if ( document ) document->SetError( TIXML_ERROR_READING_ATTRIBUTES, pErr, data, encoding );
         return 0;
     }
+
+    // Point to the name in the table of the document, so lookups by name compare pointers
+    TiXmlName::Release( name );
+    if ( document )
+        name = document->Names()->Intern( parsedName.c_str(), parsedName.length() );
+    else
+        name = TiXmlName::Create( &parsedName );
     p = SkipWhiteSpace( p, encoding );
     if ( !p || !*p || *p != '=' )
     {
@@ -1397,7 +1723,25 @@ const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlE
     const char SINGLE_QUOTE = '\'';
     const char DOUBLE_QUOTE = '\"';
 
-    if ( *p == SINGLE_QUOTE )
+    if ( ( *p == SINGLE_QUOTE || *p == DOUBLE_QUOTE ) && document && document->IsInSituBuffer( p ) )
+    {
+        // The value stays in the buffer of the document
+        char quote = *p;
+        ++p;
+        if ( data )
+        {
+            // Only a value with an entity is moved; the others just lose their closing quote
+            const char stops[] = { quote, '&', 0 };
+            const char* run = p + strcspn( p, stops );
+            if ( *run == '&' )
+            {
+                const char* end = strchr( run, quote );
+                data->StampRewrite( end ? end : run + strlen( run ), encoding );
+            }
+        }
+        p = ReadTextInSitu( const_cast< char* >( p ), &situValue, quote, encoding );
+    }
+    else if ( *p == SINGLE_QUOTE )
     {
         ++p;
         end = "\'";     // single quote in string
@@ -1467,7 +1811,7 @@ void TiXmlText::StreamIn( std::istream * in, TIXML_STRING * tag )
 
 const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
-    value = "";
+    ReplaceValue( 0 );
     TiXmlDocument* document = GetDocument();
 
     if ( data )
@@ -1491,13 +1835,15 @@ const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncodi
         p += strlen( startTag );
 
         // Keep all the white space, ignore the encoding, etc.
+        TIXML_STRING text;
         while (    p && *p
                 && !StringEqual( p, endTag, false, encoding )
               )
         {
-            value += *p;
+            text += *p;
             ++p;
         }
+        ReplaceValue( TiXmlName::Create( &text ) );
 
         TIXML_STRING dummy; 
         p = ReadText( p, &dummy, false, endTag, false, encoding );
@@ -1505,10 +1851,12 @@ const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncodi
     }
     else
     {
-        bool ignoreWhite = true;
+        bool ignoreWhite = ::IsWhiteSpaceCondensed( data );
 
         const char* end = "<";
-        p = ReadText( p, &value, ignoreWhite, end, false, encoding );
+        TIXML_STRING text;
+        p = ReadText( p, &text, ignoreWhite, end, false, encoding );
+        ReplaceValue( TiXmlName::Create( &text ) );
         if ( p )
             return p-1; // don't truncate the '<'
         return 0;
@@ -1600,9 +1948,484 @@ const char* TiXmlDeclaration::Parse( const char* p, TiXmlParsingData* data, TiXm
 
 bool TiXmlText::Blank() const
 {
-    for ( unsigned i=0; i<value.length(); i++ )
-        if ( !IsWhiteSpace( value[i] ) )
+    const TIXML_STRING& text = ValueTStr();
+    for ( unsigned i=0; i<text.length(); i++ )
+        if ( !IsWhiteSpace( text[i] ) )
             return false;
     return true;
 }
 
+
+TiXmlPullReader::TiXmlPullReader( size_t bufferSize )
+{
+    file = 0;
+    ownsFile = false;
+    buffer = 0;
+    capacity = bufferSize < 64 ? 64 : bufferSize;
+    begin = end = 0;
+    bytesRead = 0;
+    endOfFile = true;
+    rootRead = false;
+    pendingEnd = false;
+    finalEvent = EVENT_END_DOCUMENT;
+    encoding = TIXML_ENCODING_UNKNOWN;
+    condenseWhiteSpace = TiXmlBase::IsWhiteSpaceCondensed();
+    attributes = 0;
+    attributeCount = 0;
+    attributeCapacity = 0;
+    openElements = 0;
+    depth = 0;
+    openCapacity = 0;
+    errorId = 0;
+}
+
+
+TiXmlPullReader::~TiXmlPullReader()
+{
+    Close();
+    delete [] attributes;
+    delete [] openElements;
+}
+
+
+bool TiXmlPullReader::Open( const char* filename )
+{
+    // Binary mode, so the line endings can be normalized like TiXmlDocument::LoadFile does
+    FILE* f = fopen( filename, "rb" );
+    if ( !f )
+    {
+        Close();
+        SetError( TiXmlBase::TIXML_ERROR_OPENING_FILE );
+        return false;
+    }
+    Open( f );
+    ownsFile = true;
+    return true;
+}
+
+
+bool TiXmlPullReader::Open( FILE* f )
+{
+    Close();
+    file = f;
+    buffer = new char[ capacity + 1 ];
+    buffer[ 0 ] = 0;
+    begin = end = 0;
+    bytesRead = 0;
+    endOfFile = false;
+    rootRead = false;
+    pendingEnd = false;
+    finalEvent = EVENT_END_DOCUMENT;
+    encoding = TIXML_ENCODING_UNKNOWN;
+    attributeCount = 0;
+    depth = 0;
+    errorId = 0;
+    errorDesc = "";
+
+    // Skip the UTF-8 byte order mark
+    Fill();
+    const unsigned char* pU = (const unsigned char*) buffer;
+    if (    end >= 3
+         && pU[0] == TIXML_UTF_LEAD_0
+         && pU[1] == TIXML_UTF_LEAD_1
+         && pU[2] == TIXML_UTF_LEAD_2 )
+    {
+        encoding = TIXML_ENCODING_UTF8;
+        begin = 3;
+    }
+    return true;
+}
+
+
+void TiXmlPullReader::Close()
+{
+    if ( file && ownsFile )
+        fclose( file );
+    file = 0;
+    ownsFile = false;
+    delete [] buffer;
+    buffer = 0;
+    begin = end = 0;
+    endOfFile = true;
+}
+
+
+bool TiXmlPullReader::Fill()
+{
+    if ( endOfFile || !file )
+        return false;
+
+    // Make room: move the unread data to the front, or grow the buffer if the token fills it
+    if ( begin > 0 )
+    {
+        memmove( buffer, buffer + begin, end - begin );
+        end -= begin;
+        begin = 0;
+    }
+    else if ( end == capacity )
+    {
+        char* grown = new char[ capacity * 2 + 1 ];
+        memcpy( grown, buffer, end );
+        delete [] buffer;
+        buffer = grown;
+        capacity *= 2;
+    }
+
+    size_t length = fread( buffer + end, 1, capacity - end, file );
+    if ( length == 0 )
+    {
+        endOfFile = true;
+        buffer[ end ] = 0;
+        return false;
+    }
+    bytesRead += length;
+
+    // Normalize the line endings of the new data, as TiXmlDocument::LoadFile does
+    char* out = buffer + end;
+    const char* p = out;
+    const char* last = out + length;
+    while ( p < last )
+    {
+        if ( *p == 0xd )
+        {
+            *out++ = 0xa;
+            ++p;
+            if ( p < last )
+            {
+                if ( *p == 0xa )
+                    ++p;
+            }
+            else
+            {
+                // The data ends with a carriage return; the line feed may follow in the file
+                int next = fgetc( file );
+                if ( next == 0xa )
+                    ++bytesRead;
+                else if ( next != EOF )
+                    ungetc( next, file );
+            }
+        }
+        else if ( *p == 0 )
+        {
+            // The tokenizer stops at a zero
+            SetError( TiXmlBase::TIXML_ERROR_EMBEDDED_NULL );
+            endOfFile = true;
+            buffer[ end ] = 0;
+            return false;
+        }
+        else
+        {
+            *out++ = *p++;
+        }
+    }
+    end = out - buffer;
+    buffer[ end ] = 0;
+    return true;
+}
+
+
+bool TiXmlPullReader::FindTokenEnd( size_t* tokenEnd ) const
+{
+    const char* p = buffer + begin;
+    const char* last = buffer + end;
+
+    // Text runs up to the next tag
+    if ( *p != '<' )
+    {
+        const char* tag = (const char*) memchr( p, '<', last - p );
+        if ( !tag && !endOfFile )
+            return false;
+        *tokenEnd = tag ? tag - buffer : end;
+        return true;
+    }
+
+    // Enough to tell the kind of tag
+    const char* cdataHeader = "<![CDATA[";
+    if ( last - p < (ptrdiff_t) strlen( cdataHeader ) && !endOfFile )
+        return false;
+
+    const char* open = "<";
+    const char* close = 0;
+    if ( TiXmlBase::StringEqual( p, "<!--", false, encoding ) )
+    {
+        open = "<!--";
+        close = "-->";
+    }
+    else if ( TiXmlBase::StringEqual( p, cdataHeader, false, encoding ) )
+    {
+        open = cdataHeader;
+        close = "]]>";
+    }
+    else if ( TiXmlBase::StringEqual( p, "<?", false, encoding ) )
+    {
+        open = "<?";
+        close = "?>";
+    }
+    else if ( p[1] == '!' )
+    {
+        close = ">";
+    }
+
+    if ( close )
+    {
+        const char* found = strstr( p + strlen( open ), close );
+        if ( !found )
+            return false;
+        *tokenEnd = found + strlen( close ) - buffer;
+        return true;
+    }
+
+    // A start or end tag ends at the first '>' outside an attribute value
+    char quote = 0;
+    for ( const char* q = p + 1; q < last; ++q )
+    {
+        if ( quote )
+        {
+            if ( *q == quote )
+                quote = 0;
+        }
+        else if ( *q == '\"' || *q == '\'' )
+        {
+            quote = *q;
+        }
+        else if ( *q == '>' )
+        {
+            *tokenEnd = q + 1 - buffer;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+TiXmlPullReader::Event TiXmlPullReader::Next()
+{
+    if ( !buffer )
+        return finalEvent;
+
+    attributeCount = 0;
+    if ( pendingEnd )
+    {
+        pendingEnd = false;
+        --depth;
+        return EVENT_END_ELEMENT;
+    }
+
+    for ( ;; )
+    {
+        size_t tokenEnd = 0;
+        while ( begin == end || !FindTokenEnd( &tokenEnd ) )
+        {
+            if ( !Fill() )
+            {
+                if ( errorId )
+                    return EVENT_ERROR;
+                if ( begin != end && FindTokenEnd( &tokenEnd ) )
+                    break;
+                if ( begin != end )
+                    return SetError( TiXmlBase::TIXML_ERROR_PARSING_ELEMENT );
+                if ( !rootRead )
+                    return SetError( TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY );
+                if ( depth > 0 )
+                    return SetError( TiXmlBase::TIXML_ERROR_READING_END_TAG );
+                finalEvent = EVENT_END_DOCUMENT;
+                Close();
+                return finalEvent;
+            }
+        }
+
+        char* p = buffer + begin;
+        const char* tokenLast = buffer + tokenEnd;
+        begin = tokenEnd;
+
+        if ( *p != '<' )
+        {
+            // White space between the tags is not reported, nor text outside the root element
+            if ( depth == 0 )
+                continue;
+            // TiXmlBase::ReadText stops at the '<' of the next token or at the terminator
+            TiXmlBase::ReadText( p, &text, condenseWhiteSpace, "<", false, encoding );
+
+            size_t i = 0;
+            while ( i < text.length() && TiXmlBase::IsWhiteSpace( text[ i ] ) )
+                ++i;
+            if ( i == text.length() )
+                continue;
+            return EVENT_TEXT;
+        }
+        else if ( TiXmlBase::StringEqual( p, "<![CDATA[", false, encoding ) )
+        {
+            const char* start = p + strlen( "<![CDATA[" );
+            text.assign( start, tokenLast - strlen( "]]>" ) - start );
+            return EVENT_TEXT;
+        }
+        else if ( TiXmlBase::StringEqual( p, "<?xml", true, encoding ) )
+        {
+            ReadDeclaration( p );
+        }
+        else if ( p[1] == '!' || p[1] == '?' )
+        {
+            // Comment, DTD or processing instruction
+        }
+        else if ( p[1] == '/' )
+        {
+            return ReadEndTag( p );
+        }
+        else
+        {
+            return ReadStartTag( p );
+        }
+    }
+}
+
+
+TiXmlPullReader::Event TiXmlPullReader::ReadStartTag( char* p )
+{
+    p = const_cast< char* >( TiXmlBase::ReadName( p + 1, &name, encoding ) );
+    if ( !p || name.empty() )
+        return SetError( TiXmlBase::TIXML_ERROR_FAILED_TO_READ_ELEMENT_NAME );
+
+    for ( ;; )
+    {
+        p = const_cast< char* >( TiXmlBase::SkipWhiteSpace( p, encoding ) );
+        if ( !p || !*p )
+            return SetError( TiXmlBase::TIXML_ERROR_PARSING_ELEMENT );
+        if ( *p == '>' )
+            break;
+        if ( *p == '/' )
+        {
+            if ( p[1] != '>' )
+                return SetError( TiXmlBase::TIXML_ERROR_PARSING_EMPTY );
+            pendingEnd = true;
+            break;
+        }
+
+        if ( attributeCount == attributeCapacity )
+        {
+            int grownCapacity = attributeCapacity ? attributeCapacity * 2 : 16;
+            PullAttribute* grown = new PullAttribute[ grownCapacity ];
+            for ( int i = 0; i < attributeCount; ++i )
+            {
+                grown[ i ].name = attributes[ i ].name;
+                grown[ i ].value = attributes[ i ].value;
+            }
+            delete [] attributes;
+            attributes = grown;
+            attributeCapacity = grownCapacity;
+        }
+
+        // The value is decoded in place, so it stays in the buffer until the next event
+        PullAttribute& attribute = attributes[ attributeCount ];
+        p = const_cast< char* >( TiXmlBase::ReadName( p, &attribute.name, encoding ) );
+        if ( !p || attribute.name.empty() )
+            return SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES );
+        p = const_cast< char* >( TiXmlBase::SkipWhiteSpace( p, encoding ) );
+        if ( !p || *p != '=' )
+            return SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES );
+        p = const_cast< char* >( TiXmlBase::SkipWhiteSpace( p + 1, encoding ) );
+        if ( !p || ( *p != '\"' && *p != '\'' ) )
+            return SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES );
+        char quote = *p;
+        p = const_cast< char* >( TiXmlBase::ReadTextInSitu( p + 1, &attribute.value, quote, encoding ) );
+        if ( !p )
+            return SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES );
+        ++attributeCount;
+    }
+
+    if ( depth == openCapacity )
+    {
+        int grownCapacity = openCapacity ? openCapacity * 2 : 16;
+        TIXML_STRING* grown = new TIXML_STRING[ grownCapacity ];
+        for ( int i = 0; i < depth; ++i )
+            grown[ i ] = openElements[ i ];
+        delete [] openElements;
+        openElements = grown;
+        openCapacity = grownCapacity;
+    }
+    openElements[ depth++ ] = name;
+    rootRead = true;
+    return EVENT_START_ELEMENT;
+}
+
+
+TiXmlPullReader::Event TiXmlPullReader::ReadEndTag( const char* p )
+{
+    p = TiXmlBase::ReadName( p + 2, &name, encoding );
+    if ( p )
+        p = TiXmlBase::SkipWhiteSpace( p, encoding );
+    if ( !p || *p != '>' || depth == 0 || openElements[ depth - 1 ] != name )
+        return SetError( TiXmlBase::TIXML_ERROR_READING_END_TAG );
+    --depth;
+    return EVENT_END_ELEMENT;
+}
+
+
+void TiXmlPullReader::ReadDeclaration( const char* p )
+{
+    // Same rules as TiXmlDocument::Parse
+    if ( encoding != TIXML_ENCODING_UNKNOWN )
+        return;
+
+    TiXmlDeclaration declaration;
+    declaration.Parse( p, 0, encoding );
+    const char* enc = declaration.Encoding();
+    if ( *enc == 0 )
+        encoding = TIXML_ENCODING_UTF8;
+    else if ( TiXmlBase::StringEqual( enc, "UTF-8", true, TIXML_ENCODING_UNKNOWN ) )
+        encoding = TIXML_ENCODING_UTF8;
+    else if ( TiXmlBase::StringEqual( enc, "UTF8", true, TIXML_ENCODING_UNKNOWN ) )
+        encoding = TIXML_ENCODING_UTF8; // incorrect, but be nice
+    else 
+        encoding = TIXML_ENCODING_LEGACY;
+}
+
+
+TiXmlPullReader::Event TiXmlPullReader::SetError( int err )
+{
+    assert( err > 0 && err < TiXmlBase::TIXML_ERROR_STRING_COUNT );
+    errorId = err;
+    errorDesc = TiXmlBase::errorString[ err ];
+    finalEvent = EVENT_ERROR;
+    attributeCount = 0;
+    Close();
+    return finalEvent;
+}
+
+
+const char* TiXmlPullReader::Attribute( const char* _name ) const
+{
+    for ( int i = 0; i < attributeCount; ++i )
+    {
+        if ( attributes[ i ].name == _name )
+            return attributes[ i ].value;
+    }
+    return 0;
+}
+
+
+int TiXmlPullReader::QueryIntAttribute( const char* _name, int* _value ) const
+{
+    const char* value = Attribute( _name );
+    if ( !value )
+        return TIXML_NO_ATTRIBUTE;
+    return Ogre::NumberFormat::parseInt( value, *_value ) ? TIXML_SUCCESS : TIXML_WRONG_TYPE;
+}
+
+
+int TiXmlPullReader::QueryDoubleAttribute( const char* _name, double* _value ) const
+{
+    const char* value = Attribute( _name );
+    if ( !value )
+        return TIXML_NO_ATTRIBUTE;
+    return Ogre::NumberFormat::parseDouble( value, *_value ) ? TIXML_SUCCESS : TIXML_WRONG_TYPE;
+}
+
+
+int TiXmlPullReader::QueryFloatAttribute( const char* _name, float* _value ) const
+{
+    double d;
+    int result = QueryDoubleAttribute( _name, &d );
+    if ( result == TIXML_SUCCESS )
+        *_value = (float) d;
+    return result;
+}
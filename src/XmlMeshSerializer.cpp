@@ -28,36 +28,91 @@ Copyright (c) 2000-2014 Torus Knot Software Ltd
 
 #include "Ogre.h"
 #include "XmlMeshSerializer.h"
+#include "NumberFormat.h"
+#include "AssImpPluginProperties.h"
+#include <algorithm>
 
 namespace Ogre
 {
+	// Attribute names of the indices of a triangle
+	static const String gFaceIndexNames[3] = {"v1", "v2", "v3"};
+
+	// Number of faces and vertices that a worker thread converts to text in one go
+	static const unsigned int gFacesPerChunk = 32768;
+	static const unsigned int gVerticesPerChunk = 8192;
+
+	// Depth of the face and vertex elements in the document: mesh/submeshes/submesh/faces/face and
+	// mesh/submeshes/submesh/geometry/vertexbuffer/vertex
+	static const size_t gFaceDepth = 4;
+	static const size_t gVertexDepth = 5;
+
+	// Number of chunks the workers may run ahead of the chunk that is written to the file
+	static const size_t gChunksAheadPerWorker = 2;
+
 	//---------------------------------------------------------------------
-	XmlSerializer::XmlSerializer(void)
+	XmlSerializer::XmlSerializer(void) :
+		mImportProgress(0),
+		mImportProfiler(0),
+		mMaxThreads(0),
+		mMeshSimplifier(0),
+		mLodPixelError(1.0f),
+		mFloatPrecision(NumberFormat::PRECISION_SHORTEST),
+		mNextChunk(0),
+		mWrittenChunks(0),
+		mChunksAhead(0),
+		mAbortChunks(false)
 	{
 	}
 
 	//---------------------------------------------------------------------
 	XmlSerializer::~XmlSerializer(void)
 	{
+		stopChunkWorkers();
 	}
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::importOgreMeshXml(const String& xmlFileName, HlmsEditorPluginData* data)
 	{
 		LogManager::getSingleton().logMessage("XmlSerializer::importOgreMeshXml " + xmlFileName + "...");
-		TiXmlDocument xmlDocument (xmlFileName);
-		xmlDocument.LoadFile();
-		if (xmlDocument.Error())
+		// The xml file is streamed instead of loaded as a document, so validating it takes constant memory
+		TiXmlPullReader reader;
+		AssImpImportProfiler::Scope scope(mImportProfiler, "LoadFile");
+		if (!reader.Open(xmlFileName.c_str()))
 		{
-			data->mOutErrorText = xmlDocument.ErrorDesc();
+			data->mOutErrorText = reader.ErrorDesc();
 			return false;
 		}
-		TiXmlElement* root = xmlDocument.RootElement();
-		String rootValue(root->Value());
-		LogManager::getSingleton().logMessage("XmlSerializer::importOgreMeshXml root" + rootValue + "...");
-		if (rootValue != "mesh")
+
+		TiXmlPullReader::Event event = reader.Next();
+		if (event == TiXmlPullReader::EVENT_START_ELEMENT)
+		{
+			String rootValue(reader.Name());
+			LogManager::getSingleton().logMessage("XmlSerializer::importOgreMeshXml root" + rootValue + "...");
+			if (rootValue != "mesh")
+			{
+				data->mOutErrorText = "The xml file is not an Ogre mesh xml file";
+				return false;
+			}
+		}
+
+		uint64 fileSize = AssImpImportProfiler::getFileSize(xmlFileName);
+		size_t numEvents = 0;
+		while (event > TiXmlPullReader::EVENT_END_DOCUMENT)
+		{
+			if (mImportProgress && (++numEvents & 0xffff) == 0)
+			{
+				if (fileSize > 0)
+					mImportProgress->setProgress(static_cast<float>(reader.BytesRead()) / static_cast<float>(fileSize));
+				if (mImportProgress->checkCancelled(data))
+					return false;
+			}
+			event = reader.Next();
+		}
+		scope.addBytes(reader.BytesRead());
+
+		if (event == TiXmlPullReader::EVENT_ERROR)
 		{
-			data->mOutErrorText = "The xml file is not an Ogre mesh xml file";
+			data->mOutErrorText = reader.ErrorDesc();
 			return false;
 		}
 
@@ -70,52 +125,96 @@ namespace Ogre
 		HlmsEditorPluginData* data)
 	{
 		// All meshes in the scene become submeshes in Ogre
-		TiXmlDocument xmlDocument;
-
-		// root node
-		TiXmlElement* root = new TiXmlElement("mesh");
-		xmlDocument.LinkEndChild(root);
-		
-		// shared geometry
-		if (!writeSharedGeometry("sharedgeometry", root, scene, data))
+		XmlStreamWriter writer;
+		if (!writer.open(fileNameXml))
+		{
+			data->mOutErrorText = "Could not write " + fileNameXml;
 			return false;
+		}
 
-		// submeshes
-		if (!writeSubMeshes("submeshes", root, scene, data))
-			return false;
+		// 0 means full precision
+		int floatPrecision = getIntProperty(data, "xml_float_precision", 0);
+		mFloatPrecision = floatPrecision > 0 ? static_cast<unsigned int>(floatPrecision) : NumberFormat::PRECISION_SHORTEST;
+		writer.setFloatPrecision(mFloatPrecision);
 
-		// skeleton link
-		if (!writeSkeletonLink("skeletonlink", root, scene, data))
+		// The faces and vertices are converted to text by worker threads, while this thread writes the file
+		if (!startChunkWorkers(scene, data))
+		{
+			writer.close();
+			remove(fileNameXml.c_str());
 			return false;
+		}
 
-		//Lod
-		if (!writeLodInfo("levelofdetail", root, scene, data))
+		// root node
+		writer.openElement("mesh");
+		bool success = writeMeshElements(writer, scene, data);
+		stopChunkWorkers();
+		if (!success)
+		{
+			// Don't leave a partially written file behind
+			writer.close();
+			remove(fileNameXml.c_str());
 			return false;
+		}
+		writer.closeElement();
 
-		// submesh names
-		if (!writeSubMeshNames("submeshnames", root, scene, data))
+		// Flush the remaining buffered data
+		AssImpImportProfiler::Scope scope(mImportProfiler, "saveXml");
+		scope.addBytes(writer.getBytesWritten());
+		if (!writer.close())
+		{
+			data->mOutErrorText = "Could not write " + fileNameXml;
+			remove(fileNameXml.c_str());
 			return false;
+		}
 
-		// submesh extremes
-		if (!writeExtremes("extremes", root, scene, data))
-			return false;
+		return true;
+	}
 
-		// poses
-		if (!writePoses("poses", root, scene, data))
-			return false;
+	//---------------------------------------------------------------------
+	bool XmlSerializer::writeMeshElements(XmlStreamWriter& writer,
+		const aiScene* scene,
+		HlmsEditorPluginData* data)
+	{
+		// The level 2 elements in the order of the mesh xml format
+		typedef bool (XmlSerializer::*WriteElementFunction)(const String&, XmlStreamWriter&, const aiScene*, HlmsEditorPluginData*);
+		struct MeshElement
+		{
+			const char* elementId;
+			const char* stageName;
+			WriteElementFunction writeElement;
+		};
+		static const MeshElement meshElements[] =
+		{
+			{"sharedgeometry", "writeSharedGeometry", &XmlSerializer::writeSharedGeometry},
+			{"submeshes", "writeSubMeshes", &XmlSerializer::writeSubMeshes},
+			{"skeletonlink", "writeSkeletonLink", &XmlSerializer::writeSkeletonLink},
+			{"levelofdetail", "writeLodInfo", &XmlSerializer::writeLodInfo},
+			{"submeshnames", "writeSubMeshNames", &XmlSerializer::writeSubMeshNames},
+			{"extremes", "writeExtremes", &XmlSerializer::writeExtremes},
+			{"poses", "writePoses", &XmlSerializer::writePoses},
+			{"animations", "writeAnimations", &XmlSerializer::writeAnimations}
+		};
+		static const size_t numMeshElements = sizeof(meshElements) / sizeof(meshElements[0]);
 
-		// animations
-		if (!writeAnimations("animations", root, scene, data))
-			return false;
+		// Each element is timed separately; the bytes are the size of the element in the file
+		for (size_t element = 0; element < numMeshElements; ++element)
+		{
+			const MeshElement& meshElement = meshElements[element];
+			AssImpImportProfiler::Scope scope(mImportProfiler, meshElement.stageName);
+			uint64 bytesWritten = writer.getBytesWritten();
+			bool written = (this->*meshElement.writeElement)(meshElement.elementId, writer, scene, data);
+			scope.addBytes(writer.getBytesWritten() - bytesWritten);
+			if (!written)
+				return false;
+		}
 
-		//String fileName = data->mInImportPath + data->mInFileDialogBaseName + ".xml";
-		xmlDocument.SaveFile(fileNameXml);
 		return true;
 	}
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writeSharedGeometry(const String& sharedGeometryId,
-		TiXmlElement* root,
+		XmlStreamWriter& writer,
 		const aiScene* scene,
 		HlmsEditorPluginData* data)
 	{
@@ -124,7 +223,7 @@ namespace Ogre
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writeSubMeshes (const String& submMeshesId,
-		TiXmlElement* root, 
+		XmlStreamWriter& writer,
 		const aiScene* scene,
 		HlmsEditorPluginData* data)
 	{
@@ -134,30 +233,29 @@ namespace Ogre
 			return false;
 		}
 
-		TiXmlElement* subMeshesNode;
-		subMeshesNode = new TiXmlElement(submMeshesId);
-		root->LinkEndChild(subMeshesNode);
+		writer.openElement(submMeshesId);
 
 		// SubMeshes
 		unsigned int meshCount = 0;
 		while (meshCount < scene->mNumMeshes)
 		{
 			// Add 'n' number of submesh elements
-			TiXmlElement* subMeshNode = new TiXmlElement("submesh");
-			subMeshesNode->LinkEndChild(subMeshNode);
-			if (!writeSubMesh("submesh", subMeshNode, scene->mMeshes[meshCount], data))
+			writer.openElement("submesh");
+			if (!writeSubMesh("submesh", writer, scene->mMeshes[meshCount], data))
 				return false;
+			writer.closeElement();
 
 			++meshCount;
 		}
 
+		writer.closeElement();
 		return true;
 	}
 
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writeSkeletonLink (const String& skeletonlinkId,
-		TiXmlElement* root, 
+		XmlStreamWriter& writer,
 		const aiScene* scene,
 		HlmsEditorPluginData* data)
 	{
@@ -166,24 +264,61 @@ namespace Ogre
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writeLodInfo (const String& lodInfoId,
-		TiXmlElement* root, 
+		XmlStreamWriter& writer,
 		const aiScene* scene,
 		HlmsEditorPluginData* data)
 	{
+		if (!mMeshSimplifier || mMeshSimplifier->getNumLodLevels() == 0)
+			return true;
+
+		// The number of levels includes the full-detail level; each generated level has a face list per submesh,
+		// which uses the vertices of the submesh
+		size_t numLodLevels = mMeshSimplifier->getNumLodLevels();
+		std::vector<float> pixelCounts = mMeshSimplifier->calculateLodPixelCounts(mLodPixelError);
+		writer.openElement(lodInfoId);
+		writer.attribute("strategy", String("pixel_count"));
+		writer.attribute("numlevels", static_cast<unsigned int>(numLodLevels + 1));
+		writer.attribute("manual", String("false"));
+		for (size_t level = 0; level < numLodLevels; ++level)
+		{
+			if (mImportProgress && mImportProgress->checkCancelled(data))
+				return false;
+
+			writer.openElement("lodgenerated");
+			writer.attribute("value", pixelCounts[level]);
+			for (unsigned int meshCount = 0; meshCount < scene->mNumMeshes; ++meshCount)
+			{
+				const std::vector<unsigned int>& indices = mMeshSimplifier->getLodLevels(meshCount)[level].indices;
+				writer.openElement("lodfacelist");
+				writer.attribute("submeshindex", meshCount);
+				writer.attribute("numfaces", static_cast<unsigned int>(indices.size() / 3));
+				for (size_t index = 0; index < indices.size(); index += 3)
+				{
+					writer.openElement("face");
+					writer.attribute(gFaceIndexNames[0], indices[index]);
+					writer.attribute(gFaceIndexNames[1], indices[index + 1]);
+					writer.attribute(gFaceIndexNames[2], indices[index + 2]);
+					writer.closeElement();
+				}
+				writer.closeElement();
+			}
+			writer.closeElement();
+		}
+		writer.closeElement();
 		return true;
 	}
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writeSubMeshNames (const String& subMeshNamesId,
-		TiXmlElement* root, 
+		XmlStreamWriter& writer,
 		const aiScene* scene,
 		HlmsEditorPluginData* data)
 	{
 		/*
 		if (scene->HasMeshes())
 		{
-			TiXmlElement* subMeshNamesNode = new TiXmlElement(subMeshNamesId);
-			root->LinkEndChild(subMeshNamesNode);
+			writer.openElement(subMeshNamesId);
+			writer.closeElement();
 		}
 		*/
 		return true;
@@ -191,7 +326,7 @@ namespace Ogre
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writeExtremes (const String& extremesId,
-		TiXmlElement* root, 
+		XmlStreamWriter& writer,
 		const aiScene* scene,
 		HlmsEditorPluginData* data)
 	{
@@ -200,7 +335,7 @@ namespace Ogre
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writePoses (const String& posesId,
-		TiXmlElement* root, 
+		XmlStreamWriter& writer,
 		const aiScene* scene,
 		HlmsEditorPluginData* data)
 	{
@@ -209,15 +344,15 @@ namespace Ogre
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writeAnimations (const String& animationsId,
-		TiXmlElement* root, 
+		XmlStreamWriter& writer,
 		const aiScene* scene,
 		HlmsEditorPluginData* data)
 	{
 		/*
 		if (scene->HasAnimations())
 		{
-			TiXmlElement* animationsNode = new TiXmlElement(animationsId);
-			root->LinkEndChild(animationsNode);
+			writer.openElement(animationsId);
+			writer.closeElement();
 		}
 		*/
 		return true;
@@ -225,67 +360,58 @@ namespace Ogre
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writeSubMesh(const String& submMeshId,
-		TiXmlElement* subMeshNode,
+		XmlStreamWriter& writer,
 		const aiMesh* subMesh,
 		HlmsEditorPluginData* data)
 	{
-		subMeshNode->SetAttribute("material", "BaseWhite");
-		subMeshNode->SetAttribute("usesharedvertices", "false");
-		subMeshNode->SetAttribute("use32bitindexes", "false");
-		subMeshNode->SetAttribute("operationtype", "triangle_list");
-		TiXmlElement* facesNode;
-		TiXmlElement* geometryNode;
-		TiXmlElement* vertexBufferNode;
-		TiXmlElement* boneAssignmentsNode;
-
-		// Faces
+		writer.attribute("material", "BaseWhite");
+		writer.attribute("usesharedvertices", "false");
+		// 16 bit indices whenever all vertices can be addressed with them, like AssImpMeshBuilder::packIndices
+		writer.attribute("use32bitindexes", subMesh->mNumVertices > 0xFFFF ? "true" : "false");
+		writer.attribute("operationtype", "triangle_list");
+
+		// Faces; the triangle check is done by startChunkWorkers
 		if (subMesh->HasFaces())
 		{
-			if (subMesh->mFaces->mNumIndices != 3)
-			{
-				data->mOutErrorText = "Error; only models with triangle lists are supported";
-				return false;
-			}
-
-			facesNode = new TiXmlElement("faces");
-			facesNode->SetAttribute("count", subMesh->mNumFaces);
-			subMeshNode->LinkEndChild(facesNode);
+			writer.openElement("faces");
+			writer.attribute("count", subMesh->mNumFaces);
 
 			// Write all faces
-			if (!writeFaces("face", facesNode, subMesh, data))
+			if (!writeChunks(writer, subMesh, true, data))
 				return false;
+			writer.closeElement();
 		}
 
 		// Geometry
 		if (subMesh->HasPositions())
 		{
-			geometryNode = new TiXmlElement("geometry");
-			geometryNode->SetAttribute("vertexcount", subMesh->mNumVertices);
-			subMeshNode->LinkEndChild(geometryNode);
-			vertexBufferNode = new TiXmlElement("vertexbuffer");
-			vertexBufferNode->SetAttribute("positions", "true");
-			geometryNode->LinkEndChild(vertexBufferNode);
+			writer.openElement("geometry");
+			writer.attribute("vertexcount", subMesh->mNumVertices);
+			writer.openElement("vertexbuffer");
+			writer.attribute("positions", "true");
 
 			if (subMesh->HasNormals())
-				vertexBufferNode->SetAttribute("normals", "true");
+				writer.attribute("normals", "true");
 			else
-				vertexBufferNode->SetAttribute("normals", "false");
+				writer.attribute("normals", "false");
 			
-			vertexBufferNode->SetAttribute("texture_coord_dimensions_0", "float2"); // TODO: Extend
+			writer.attribute("texture_coord_dimensions_0", "float2"); // TODO: Extend
 
 			if (subMesh->HasTangentsAndBitangents())
-				vertexBufferNode->SetAttribute("tangents", "true");
+				writer.attribute("tangents", "true");
 			else
-				vertexBufferNode->SetAttribute("tangents", "false");
+				writer.attribute("tangents", "false");
 
 			if (subMesh->HasTextureCoords(0))
 			{
-				vertexBufferNode->SetAttribute("texture_coords", "1"); // TODO: Extend with mulitple texture coordinate sets
+				writer.attribute("texture_coords", "1"); // TODO: Extend with mulitple texture coordinate sets
 			}
 			
 			// Write all vertices, normals and tex coords
-			if (!writeVertices("vertex", vertexBufferNode, subMesh, data))
+			if (!writeChunks(writer, subMesh, false, data))
 				return false;
+			writer.closeElement();
+			writer.closeElement();
 		}
 
 		// TODO
@@ -294,10 +420,10 @@ namespace Ogre
 		/*
 		if (subMesh->HasBones())
 		{
-			boneAssignmentsNode = new TiXmlElement("boneassignments");
-			subMeshNode->LinkEndChild(boneAssignmentsNode);
-			if (!writeVertexBoneAssignments("vertexboneassignment", boneAssignmentsNode, subMesh, data))
+			writer.openElement("boneassignments");
+			if (!writeVertexBoneAssignments("vertexboneassignment", writer, subMesh, data))
 				return false;
+			writer.closeElement();
 		}
 		*/
 
@@ -306,25 +432,29 @@ namespace Ogre
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writeFaces(const String& faceId,
-		TiXmlElement* facesNode,
+		XmlStreamWriter& writer,
 		const aiMesh* subMesh,
+		unsigned int firstFace,
+		unsigned int lastFace,
 		HlmsEditorPluginData* data)
 	{
-		unsigned int faceCount = 0;
+		unsigned int faceCount = firstFace;
 		aiFace* face;
-		TiXmlElement* faceNode;
-		while (faceCount < subMesh->mNumFaces)
+		while (faceCount < lastFace)
 		{
 			// Add 'x' number of face elements
 			face = &subMesh->mFaces[faceCount];
 			unsigned int indexCount = 0;
-			faceNode = new TiXmlElement("face");
-			facesNode->LinkEndChild(faceNode);
+			writer.openElement(faceId);
 			while (indexCount < face->mNumIndices)
 			{
-				faceNode->SetAttribute("v" + StringConverter::toString(indexCount + 1), face->mIndices[indexCount]);
+				if (indexCount < 3)
+					writer.attribute(gFaceIndexNames[indexCount], face->mIndices[indexCount]);
+				else
+					writer.attribute("v" + StringConverter::toString(indexCount + 1), face->mIndices[indexCount]);
 				++indexCount;
 			}
+			writer.closeElement();
 
 			++faceCount;
 		}
@@ -334,67 +464,65 @@ namespace Ogre
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writeVertices(const String& vertexBufferId,
-		TiXmlElement* vertexBufferNode,
+		XmlStreamWriter& writer,
 		const aiMesh* subMesh,
+		unsigned int firstVertex,
+		unsigned int lastVertex,
 		HlmsEditorPluginData* data)
 	{
-		unsigned int vertexCount = 0;
+		unsigned int vertexCount = firstVertex;
 		aiVector3D* vertex;
 		aiVector3D* normal;
 		aiVector3D* tangent;
 		aiVector3D* texCoord;
-		TiXmlElement* vertexNode;
-		TiXmlElement* positionNode;
-		TiXmlElement* normalNode;
-		TiXmlElement* tangentNode;
-		TiXmlElement* texCoordNode;
 
 		// Add 'x' number of vertex elements, normalsm texture coords and tangents
-		while (vertexCount < subMesh->mNumVertices)
+		while (vertexCount < lastVertex)
 		{
-			vertexNode = new TiXmlElement(vertexBufferId);
-			vertexBufferNode->LinkEndChild(vertexNode);
+			writer.openElement(vertexBufferId);
 
 			// Position
-			positionNode = new TiXmlElement("position");
+			writer.openElement("position");
 			vertex = &subMesh->mVertices[vertexCount];
-			positionNode->SetAttribute("x", StringConverter::toString(vertex->x));
-			positionNode->SetAttribute("y", StringConverter::toString(vertex->y));
-			positionNode->SetAttribute("z", StringConverter::toString(vertex->z));
-			vertexNode->LinkEndChild(positionNode);
+			writer.attribute("x", vertex->x);
+			writer.attribute("y", vertex->y);
+			writer.attribute("z", vertex->z);
+			writer.closeElement();
 
 			// Normal
 			if (subMesh->HasNormals())
 			{
-				normalNode = new TiXmlElement("normal");
+				writer.openElement("normal");
 				normal = &subMesh->mNormals[vertexCount];
-				normalNode->SetAttribute("x", StringConverter::toString(normal->x));
-				normalNode->SetAttribute("y", StringConverter::toString(normal->y));
-				normalNode->SetAttribute("z", StringConverter::toString(normal->z));
-				vertexNode->LinkEndChild(normalNode);
+				writer.attribute("x", normal->x);
+				writer.attribute("y", normal->y);
+				writer.attribute("z", normal->z);
+				writer.closeElement();
 			}
 
 			// Tangent
 			if (subMesh->HasTangentsAndBitangents())
 			{
-				tangentNode = new TiXmlElement("tangent");
+				writer.openElement("tangent");
 				tangent = &subMesh->mTangents[vertexCount];
-				tangentNode->SetAttribute("x", StringConverter::toString(tangent->x));
-				tangentNode->SetAttribute("y", StringConverter::toString(tangent->y));
-				tangentNode->SetAttribute("z", StringConverter::toString(tangent->z));
-				vertexNode->LinkEndChild(tangentNode);
+				writer.attribute("x", tangent->x);
+				writer.attribute("y", tangent->y);
+				writer.attribute("z", tangent->z);
+				writer.closeElement();
 			}
 
 			// Texture coordinates (TODO: Currently only one set)
 			if (subMesh->HasTextureCoords(0))
 			{
-				texCoordNode = new TiXmlElement("texcoord");
+				writer.openElement("texcoord");
 				texCoord = &subMesh->mTextureCoords[0][vertexCount];
-				texCoordNode->SetAttribute("u", StringConverter::toString(texCoord->x));
-				texCoordNode->SetAttribute("v", StringConverter::toString(texCoord->y));
-				vertexNode->LinkEndChild(texCoordNode);
+				writer.attribute("u", texCoord->x);
+				writer.attribute("v", texCoord->y);
+				writer.closeElement();
 			}
 
+			writer.closeElement();
+
 			++vertexCount;
 		}
 
@@ -403,12 +531,11 @@ namespace Ogre
 
 	//---------------------------------------------------------------------
 	bool XmlSerializer::writeVertexBoneAssignments(const String& vertexBoneAssignmentsId,
-		TiXmlElement* boneAssignmentsNode,
+		XmlStreamWriter& writer,
 		const aiMesh* subMesh,
 		HlmsEditorPluginData* data)
 	{
 		aiBone* bone;
-		TiXmlElement* vertexBoneAssignmentNode;
 		float weight;
 		struct BoneAssignmentStruct
 		{
@@ -451,11 +578,11 @@ namespace Ogre
 		while (it != itEnd)
 		{
 			boneAssignmentStruct = it->second;
-			vertexBoneAssignmentNode = new TiXmlElement(vertexBoneAssignmentsId);
-			boneAssignmentsNode->LinkEndChild(vertexBoneAssignmentNode);
-			vertexBoneAssignmentNode->SetAttribute("vertexindex", StringConverter::toString(boneAssignmentStruct.vertexIndex));
-			vertexBoneAssignmentNode->SetAttribute("boneindex", StringConverter::toString(boneAssignmentStruct.boneIndex));
-			vertexBoneAssignmentNode->SetAttribute("weight", StringConverter::toString(boneAssignmentStruct.weight));
+			writer.openElement(vertexBoneAssignmentsId);
+			writer.attribute("vertexindex", boneAssignmentStruct.vertexIndex);
+			writer.attribute("boneindex", boneAssignmentStruct.boneIndex);
+			writer.attribute("weight", boneAssignmentStruct.weight);
+			writer.closeElement();
 			++it;
 			++vertexIndex;
 		}
@@ -463,6 +590,157 @@ namespace Ogre
 		return true;
 	}
 
+	//---------------------------------------------------------------------
+	bool XmlSerializer::startChunkWorkers(const aiScene* scene, HlmsEditorPluginData* data)
+	{
+		stopChunkWorkers();
+
+		// Split the faces and vertices of all submeshes into chunks, in the order in which they are written
+		unsigned int meshCount = 0;
+		while (meshCount < scene->mNumMeshes)
+		{
+			const aiMesh* subMesh = scene->mMeshes[meshCount];
+			if (subMesh->HasFaces())
+			{
+				if (subMesh->mFaces->mNumIndices != 3)
+				{
+					data->mOutErrorText = "Error; only models with triangle lists are supported";
+					mChunks.clear();
+					return false;
+				}
+
+				addChunks(subMesh, true, subMesh->mNumFaces, gFacesPerChunk);
+			}
+
+			if (subMesh->HasPositions())
+				addChunks(subMesh, false, subMesh->mNumVertices, gVerticesPerChunk);
+
+			++meshCount;
+		}
+
+		unsigned int numWorkers = mMaxThreads > 0 ? mMaxThreads : std::thread::hardware_concurrency();
+		if (numWorkers == 0)
+			numWorkers = 1;
+		numWorkers = std::min(numWorkers, static_cast<unsigned int>(mChunks.size()));
+		mNextChunk = 0;
+		mWrittenChunks = 0;
+		mChunksAhead = numWorkers * gChunksAheadPerWorker;
+		mAbortChunks = false;
+		for (unsigned int i = 0; i < numWorkers; ++i)
+			mChunkWorkers.push_back(std::thread(&XmlSerializer::runChunkWorker, this, data));
+
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	void XmlSerializer::addChunks(const aiMesh* subMesh, bool faces, unsigned int count, unsigned int chunkSize)
+	{
+		unsigned int first = 0;
+		while (first < count)
+		{
+			XmlChunk chunk;
+			chunk.subMesh = subMesh;
+			chunk.faces = faces;
+			chunk.first = first;
+			chunk.last = std::min(count, first + chunkSize);
+			chunk.done = false;
+			mChunks.push_back(chunk);
+			first = chunk.last;
+		}
+	}
+
+	//---------------------------------------------------------------------
+	void XmlSerializer::stopChunkWorkers(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mChunkMutex);
+			mAbortChunks = true;
+		}
+		mChunkCondition.notify_all();
+
+		std::vector<std::thread>::iterator it = mChunkWorkers.begin();
+		std::vector<std::thread>::iterator itEnd = mChunkWorkers.end();
+		while (it != itEnd)
+		{
+			it->join();
+			++it;
+		}
+		mChunkWorkers.clear();
+		mChunks.clear();
+	}
+
+	//---------------------------------------------------------------------
+	void XmlSerializer::runChunkWorker(HlmsEditorPluginData* data)
+	{
+		XmlStreamWriter chunkWriter;
+		chunkWriter.setFloatPrecision(mFloatPrecision);
+		std::unique_lock<std::mutex> lock(mChunkMutex);
+		while (true)
+		{
+			// Don't run too far ahead of the writer, so memory use stays bounded
+			while (!mAbortChunks && mNextChunk < mChunks.size() && mNextChunk >= mWrittenChunks + mChunksAhead)
+				mChunkCondition.wait(lock);
+			if (mAbortChunks || mNextChunk >= mChunks.size())
+				return;
+
+			XmlChunk& chunk = mChunks[mNextChunk];
+			++mNextChunk;
+			lock.unlock();
+
+			if (chunk.faces)
+			{
+				AssImpImportProfiler::Scope scope(mImportProfiler, "writeFaces");
+				chunkWriter.openBuffer(gFaceDepth);
+				writeFaces("face", chunkWriter, chunk.subMesh, chunk.first, chunk.last, data);
+				scope.addBytes(chunkWriter.getBytesWritten());
+			}
+			else
+			{
+				AssImpImportProfiler::Scope scope(mImportProfiler, "writeVertices");
+				chunkWriter.openBuffer(gVertexDepth);
+				writeVertices("vertex", chunkWriter, chunk.subMesh, chunk.first, chunk.last, data);
+				scope.addBytes(chunkWriter.getBytesWritten());
+			}
+
+			lock.lock();
+			chunk.text.swap(chunkWriter.getBuffer());
+			chunk.done = true;
+			mChunkCondition.notify_all();
+		}
+	}
+
+	//---------------------------------------------------------------------
+	bool XmlSerializer::writeChunks(XmlStreamWriter& writer, const aiMesh* subMesh, bool faces, HlmsEditorPluginData* data)
+	{
+		// The chunks are written in the same order as they were created by startChunkWorkers
+		std::unique_lock<std::mutex> lock(mChunkMutex);
+		while (mWrittenChunks < mChunks.size() &&
+			mChunks[mWrittenChunks].subMesh == subMesh &&
+			mChunks[mWrittenChunks].faces == faces)
+		{
+			XmlChunk& chunk = mChunks[mWrittenChunks];
+			while (!chunk.done)
+				mChunkCondition.wait(lock);
+
+			String text;
+			text.swap(chunk.text);
+			lock.unlock();
+			writer.writeRaw(text);
+			lock.lock();
+			++mWrittenChunks;
+			mChunkCondition.notify_all();
+
+			if (mImportProgress)
+			{
+				mImportProgress->setProgress(static_cast<float>(mWrittenChunks) / static_cast<float>(mChunks.size()));
+				if (mImportProgress->checkCancelled(data))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
 	//---------------------------------------------------------------------
 	bool XmlSerializer::convertXmlFileToMesh(const String& xmlFileName, 
 		const String& meshFileName,
@@ -489,9 +767,26 @@ namespace Ogre
 
 		meshToolCmd += meshToolGenerateEdgeLists + meshToolGenerateTangents + meshToolOptimize;
 
+		if (mImportProgress && mImportProgress->checkCancelled(data))
+			return false;
+
 		std::string runOgreMeshTool = meshToolCmd + "\"" + xmlFileName + "\" \"" + meshFileName + "\"";
 		LogManager::getSingleton().logMessage("XmlSerializer::convertXmlFileToMesh executing: " + runOgreMeshTool + "...");
-		system(runOgreMeshTool.c_str());
+		AssImpImportProfiler::Scope scope(mImportProfiler, "OgreMeshTool");
+
+		// A mesh of an earlier import must not be mistaken for the output of this one
+		remove(meshFileName.c_str());
+		int exitStatus = system(runOgreMeshTool.c_str());
+		uint64 meshFileSize = AssImpImportProfiler::getFileSize(meshFileName);
+		if (exitStatus != 0 || meshFileSize == 0)
+		{
+			data->mOutErrorText = "OgreMeshTool could not convert " + xmlFileName + " (exit status " +
+				StringConverter::toString(exitStatus) + ")";
+			remove(meshFileName.c_str());
+			return false;
+		}
+
+		scope.addBytes(meshFileSize);
 		return true;
 	}
 }
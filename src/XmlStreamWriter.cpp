@@ -0,0 +1,246 @@
+/*
+  -----------------------------------------------------------------------------
+  This source file is part of OGRE
+  (Object-oriented Graphics Rendering Engine)
+  For the latest info, see http://www.ogre3d.org/
+
+Copyright (c) 2000-2014 Torus Knot Software Ltd
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+  -----------------------------------------------------------------------------
+*/
+
+#include "XML/tinyxml.h"
+#include "XmlStreamWriter.h"
+#include "NumberFormat.h"
+
+namespace Ogre
+{
+	// Size of the file buffer; this is the only memory needed to write the file
+	static const size_t gWriteBufferSize = 1024 * 1024;
+
+	//---------------------------------------------------------------------
+	XmlStreamWriter::XmlStreamWriter(void) :
+		mFile(0),
+		mError(false),
+		mStartTagOpen(false),
+		mFloatPrecision(NumberFormat::PRECISION_SHORTEST),
+		mBaseDepth(0),
+		mBytesWritten(0)
+	{
+	}
+
+	//---------------------------------------------------------------------
+	XmlStreamWriter::~XmlStreamWriter(void)
+	{
+		close();
+	}
+
+	//---------------------------------------------------------------------
+	bool XmlStreamWriter::open(const String& fileName)
+	{
+		close();
+		mError = false;
+		mStartTagOpen = false;
+		mBaseDepth = 0;
+		mBytesWritten = 0;
+		mElementStack.clear();
+		mText.clear();
+		mFile = fopen(fileName.c_str(), "w");
+		if (!mFile)
+			return false;
+
+		mBuffer.resize(gWriteBufferSize);
+		setvbuf(mFile, &mBuffer[0], _IOFBF, mBuffer.size());
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	bool XmlStreamWriter::close(void)
+	{
+		if (!mFile)
+			return !mError;
+
+		if (fclose(mFile) != 0)
+			mError = true;
+		mFile = 0;
+		return !mError;
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::openBuffer(size_t depth)
+	{
+		close();
+		mError = false;
+		mStartTagOpen = false;
+		mBaseDepth = depth;
+		mBytesWritten = 0;
+		mElementStack.clear();
+		mText.clear();
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::writeRaw(const String& text)
+	{
+		if (text.empty())
+			return;
+
+		if (mStartTagOpen)
+		{
+			write(">", 1);
+			mStartTagOpen = false;
+		}
+		write(text);
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::openElement(const String& name)
+	{
+		// The parent now has a child, so its start tag is completed with '>'
+		if (mStartTagOpen)
+			write(">");
+
+		// Each child starts on a new line; a root element is not preceded by a newline
+		if (!mElementStack.empty() || mBaseDepth > 0)
+			write("\n");
+
+		writeIndent(mBaseDepth + mElementStack.size());
+		write("<");
+		write(name);
+		mElementStack.push_back(name);
+		mStartTagOpen = true;
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::attribute(const String& name, const String& value)
+	{
+		String encodedName;
+		String encodedValue;
+		TiXmlBase::EncodeString(name, &encodedName);
+		TiXmlBase::EncodeString(value, &encodedValue);
+
+		// Same quoting as TiXmlAttribute::Print
+		write(" ");
+		write(encodedName);
+		if (value.find('\"') == String::npos)
+		{
+			write("=\"");
+			write(encodedValue);
+			write("\"");
+		}
+		else
+		{
+			write("='");
+			write(encodedValue);
+			write("'");
+		}
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::attribute(const String& name, int value)
+	{
+		char buffer[NumberFormat::BUFFER_SIZE];
+		size_t length = NumberFormat::formatInt(buffer, value);
+		writeNumberAttribute(name, buffer, length);
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::attribute(const String& name, unsigned int value)
+	{
+		char buffer[NumberFormat::BUFFER_SIZE];
+		size_t length = NumberFormat::formatUnsignedInt(buffer, value);
+		writeNumberAttribute(name, buffer, length);
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::attribute(const String& name, float value)
+	{
+		char buffer[NumberFormat::BUFFER_SIZE];
+		size_t length = NumberFormat::formatFloat(buffer, value, mFloatPrecision);
+		writeNumberAttribute(name, buffer, length);
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::writeNumberAttribute(const String& name, const char* value, size_t length)
+	{
+		write(" ", 1);
+		write(name);
+		write("=\"", 2);
+		write(value, length);
+		write("\"", 1);
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::closeElement(void)
+	{
+		if (mElementStack.empty())
+			return;
+
+		if (mStartTagOpen)
+		{
+			// Element without children
+			write(" />");
+		}
+		else
+		{
+			write("\n");
+			writeIndent(mBaseDepth + mElementStack.size() - 1);
+			write("</");
+			write(mElementStack.back());
+			write(">");
+		}
+
+		mElementStack.pop_back();
+		mStartTagOpen = false;
+
+		// A root element is followed by a newline (TiXmlDocument::Print)
+		if (mElementStack.empty() && mBaseDepth == 0)
+			write("\n");
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::write(const String& value)
+	{
+		write(value.c_str(), value.length());
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::write(const char* value, size_t length)
+	{
+		mBytesWritten += length;
+		if (!mFile)
+		{
+			mText.append(value, length);
+			return;
+		}
+
+		if (mError)
+			return;
+
+		if (fwrite(value, 1, length, mFile) != length)
+			mError = true;
+	}
+
+	//---------------------------------------------------------------------
+	void XmlStreamWriter::writeIndent(size_t depth)
+	{
+		for (size_t i = 0; i < depth; ++i)
+			write("    ");
+	}
+}